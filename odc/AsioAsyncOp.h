@@ -23,6 +23,7 @@
 #include <functional>
 #include <memory>
 #include <system_error>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
@@ -80,11 +81,12 @@ namespace odc::core
 
             boost::asio::dispatch(
                 GetEx2(),
-                [=, handler = std::move(fHandler)]() mutable
+                [ec, handler = std::move(fHandler), argsTuple = std::make_tuple(std::move(args)...)]() mutable
                 {
                     try
                     {
-                        handler(ec, args...);
+                        // the handler is called once, hand over the arguments instead of copying them
+                        std::apply([&](auto&... a) { handler(ec, std::move(a)...); }, argsTuple);
                     }
                     catch (const std::exception& e)
                     {
@@ -180,7 +182,7 @@ namespace odc::core
             // Allocator2, see
             // https://www.boost.org/doc/libs/1_70_0/doc/html/boost_asio/reference/asynchronous_operations.html#boost_asio.reference.asynchronous_operations.allocation_of_intermediate_storage
             using OpAllocator = typename std::allocator_traits<typename Op::Allocator2>::template rebind_alloc<Op>;
-            OpAllocator opAlloc;
+            OpAllocator opAlloc(boost::asio::get_associated_allocator(handler, alloc1));
 
             // Allocate memory
             auto mem(std::allocator_traits<OpAllocator>::allocate(opAlloc, 1));
@@ -191,7 +193,10 @@ namespace odc::core
             // Assign ownership to this object
             fImpl = ImplPtr(ptr,
                             [opAlloc](Impl* p) mutable
-                            { std::allocator_traits<OpAllocator>::deallocate(opAlloc, static_cast<Op*>(p), 1); });
+                            {
+                                static_cast<Op*>(p)->~Op();
+                                std::allocator_traits<OpAllocator>::deallocate(opAlloc, static_cast<Op*>(p), 1);
+                            });
         }
 
         /// Ctor with handler #2
@@ -220,23 +225,23 @@ namespace odc::core
                 throw RuntimeError("Async operation already completed");
             }
 
-            fImpl->Complete(ec, args...);
+            fImpl->Complete(ec, std::move(args)...);
             fImpl.reset(nullptr);
         }
 
         auto Complete(SignatureArgTypes... args) -> void
         {
-            Complete(std::error_code(), args...);
+            Complete(std::error_code(), std::move(args)...);
         }
 
         auto Cancel(SignatureArgTypes... args) -> void
         {
-            Complete(MakeErrorCode(ErrorCode::OperationCanceled), args...);
+            Complete(MakeErrorCode(ErrorCode::OperationCanceled), std::move(args)...);
         }
 
         auto Timeout(SignatureArgTypes... args) -> void
         {
-            Complete(MakeErrorCode(ErrorCode::OperationTimeout), args...);
+            Complete(MakeErrorCode(ErrorCode::OperationTimeout), std::move(args)...);
         }
     };
 
@@ -27,6 +27,12 @@ class CliController : public odc::core::CliControllerHelper<CliController>
     void setHistoryDir(const std::string& dir) { mCtrl.setHistoryDir(dir); }
     void setZoneCfgs(const std::vector<std::string>& zonesStr) { mCtrl.setZoneCfgs(zonesStr); }
     void setRMS(const std::string& rms) { mCtrl.setRMS(rms); }
+    void setFailFast(bool failFast) { mCtrl.setFailFast(failFast); }
+    void setQuorum(bool quorum) { mCtrl.setQuorum(quorum); }
+    void setSubmitConcurrency(size_t concurrency) { mCtrl.setSubmitConcurrency(concurrency); }
+    void setAgentPool(const std::vector<std::string>& groups) { mCtrl.setAgentPool(groups); }
+    void setSessionPoolSize(size_t size) { mCtrl.setSessionPoolSize(size); }
+    void setTopoScriptCache(const std::string& dir, size_t maxEntries, const std::vector<std::string>& envVars, const std::vector<std::string>& inputs) { mCtrl.setTopoScriptCache(dir, maxEntries, envVars, inputs); }
 
     void registerResourcePlugins(const core::PluginManager::PluginMap& pluginMap) { mCtrl.registerResourcePlugins(pluginMap); }
     void restore(const std::string& restoreId, const std::string& restoreDir) { mCtrl.restore(restoreId, restoreDir); }
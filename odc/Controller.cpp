@@ -17,17 +17,71 @@
 #include <dds/TopoCreator.h>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/asio/bind_executor.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/process.hpp>
 
 #include <algorithm>
 #include <filesystem>
+#include <future>
 
 using namespace odc;
 using namespace odc::core;
 using namespace std;
 namespace bfs = boost::filesystem;
 
+Controller::~Controller()
+{
+    // The completions of asynchronous requests run on mAsyncPool and use their session (and its topology). Cancel the
+    // in-flight state changes and wait for their completions while the sessions still exist. No new state changes are
+    // started from now on, the cancellation is repeated for those that were just being initiated.
+    {
+        lock_guard<mutex> lock(mAsyncMtx);
+        mShuttingDown = true;
+    }
+    while (true) {
+        {
+            lock_guard<mutex> lock(mSessionsMtx);
+            for (auto& [partitionID, session] : mSessions) {
+                if (session->mTopology != nullptr) {
+                    try {
+                        session->mTopology->CancelChangeStates();
+                    } catch (exception& e) {
+                        OLOG(warning, partitionID, 0) << "Failed to cancel the pending state changes: " << e.what();
+                    }
+                }
+            }
+        }
+        unique_lock<mutex> lock(mAsyncMtx);
+        if (mAsyncCv.wait_for(lock, chrono::milliseconds(100), [&]() { return mNumAsyncChangeStates == 0; })) {
+            break;
+        }
+    }
+    mAsyncPool.join();
+}
+
+void Controller::cancelChangeStates(const CommonParams& common, Session& session)
+{
+    {
+        lock_guard<mutex> lock(mAsyncMtx);
+        session.mClosing = true;
+    }
+    // repeated for the state changes started by a completion (e.g. the second stage of Reset)
+    while (true) {
+        if (session.mTopology != nullptr) {
+            try {
+                session.mTopology->CancelChangeStates();
+            } catch (exception& e) {
+                OLOG(warning, common) << "Failed to cancel the pending state changes: " << e.what();
+            }
+        }
+        unique_lock<mutex> lock(mAsyncMtx);
+        if (mAsyncCv.wait_for(lock, chrono::milliseconds(100), [&]() { return session.mNumAsyncChangeStates == 0; })) {
+            return;
+        }
+    }
+}
+
 RequestResult Controller::execInitialize(const CommonParams& common, const InitializeParams& params)
 {
     Error error;
@@ -62,9 +116,13 @@ RequestResult Controller::execSubmit(const CommonParams& common, const SubmitPar
 
     auto hosts = submit(common, session, error, params.mPlugin, params.mResources, false);
 
+    string msg{ "Submit done" };
+    if (session.mNumPoolAgentsUsed > 0) {
+        msg += toString(". Using ", session.mNumPoolAgentsUsed, " agents of the agent pool");
+    }
     string sidStr{ to_string(session.mDDSSession.getSessionID()) };
     StatusCode status{ error.mCode ? StatusCode::error : StatusCode::ok };
-    return RequestResult(status, "Submit done", common.mTimer.duration(), error, common.mPartitionID, common.mRunNr, sidStr, AggregatedState::Undefined, hosts);
+    return RequestResult(status, msg, common.mTimer.duration(), error, common.mPartitionID, common.mRunNr, sidStr, AggregatedState::Undefined, hosts);
 }
 
 unordered_set<string> Controller::submit(const CommonParams& common, Session& session, Error& error, const string& plugin, const string& res, bool extractResources)
@@ -99,21 +157,20 @@ unordered_set<string> Controller::submit(const CommonParams& common, Session& se
     size_t expectedNumSlots = session.mTotalSlots;
 
     if (!error.mCode) {
-        OLOG(info, common) << "Preparing to submit " << ddsParams.size() << " configurations:";
-        for (unsigned int i = 0; i < ddsParams.size(); ++i) {
-            OLOG(info, common) << "  [" << i + 1 << "/" << ddsParams.size() << "]: " << ddsParams.at(i);
+        // ddsParams keep the requested number of agents, for the accounting and the recovery below
+        vector<DDSSubmitParams> submitParams = ddsParams;
+        if (!session.mWarmAgents.empty()) {
+            assignWarmAgents(common, session, submitParams);
         }
 
-        for (unsigned int i = 0; i < ddsParams.size(); ++i) {
-            OLOG(info, common) << "Submitting [" << i + 1 << "/" << ddsParams.size() << "]: " << ddsParams.at(i);
-            if (submitDDSAgents(common, session, error, ddsParams.at(i))) {
-                expectedNumSlots += ddsParams.at(i).mNumAgents * ddsParams.at(i).mNumSlots;
-            } else {
-                OLOG(error, common) << "Submission failed";
-                break;
-            }
+        OLOG(info, common) << "Preparing to submit " << submitParams.size() << " configurations:";
+        for (unsigned int i = 0; i < submitParams.size(); ++i) {
+            OLOG(info, common) << "  [" << i + 1 << "/" << submitParams.size() << "]: " << submitParams.at(i);
         }
-        if (!error.mCode) {
+
+        if (!submitDDSAgents(common, session, error, submitParams, expectedNumSlots)) {
+            OLOG(error, common) << "Submission failed";
+        } else {
             OLOG(info, common) << "Waiting for " << expectedNumSlots << " slots...";
             if (waitForNumActiveSlots(common, session, error, expectedNumSlots)) {
                 session.mTotalSlots = expectedNumSlots;
@@ -260,7 +317,7 @@ RequestResult Controller::execActivate(const CommonParams& common, const Activat
 
     try {
         session.mTopoFilePath = topoFilepath(common, params.mTopoFile, params.mTopoContent, params.mTopoScript);
-        extractRequirements(common, session);
+        loadTopology(common, session);
     } catch (exception& e) {
         fillAndLogFatalError(common, error, ErrorCode::TopologyFailed, e.what());
     }
@@ -275,10 +332,17 @@ RequestResult Controller::execActivate(const CommonParams& common, const Activat
 
 void Controller::activate(const CommonParams& common, Session& session, Error& error)
 {
-    activateDDSTopology(common, session, error, dds::tools_api::STopologyRequest::request_t::EUpdateType::ACTIVATE)
-        && createDDSTopology(common, session, error)
-        && createTopology(common, session, error)
-        && waitForState(common, session, error, "", DeviceState::Idle);
+    // The topology is created before the activation: state tracking and the state change subscription of each device
+    // start as soon as DDS reports it activated, overlapping with the activation of the remaining devices
+    if (!(createDDSTopology(common, session, error) && createTopology(common, session, error, true))) {
+        return;
+    }
+    if (!activateDDSTopology(common, session, error, dds::tools_api::STopologyRequest::request_t::EUpdateType::ACTIVATE)) {
+        resetTopology(session);
+        return;
+    }
+    session.mTopology->FinishActivation();
+    waitForState(common, session, error, "", DeviceState::Idle);
 }
 
 RequestResult Controller::execRun(const CommonParams& common, const RunParams& params)
@@ -289,46 +353,84 @@ RequestResult Controller::execRun(const CommonParams& common, const RunParams& p
 
     if (!session.mRunAttempted) {
         session.mRunAttempted = true;
-
-        // Create new DDS session
-        // Shutdown DDS session if it is running already
-        shutdownDDSSession(common, session, error)
-            && createDDSSession(common, session, error);
+        // duration of the stages in ms, -1 if not reached
+        int64_t sessionMs = -1;
+        int64_t topologyMs = -1;
+        int64_t submitMs = -1;
+        int64_t activateMs = -1;
+
+        auto prepareTopology = [&]() {
+            Timer timer;
+            string topoFilePath = topoFilepath(common, params.mTopoFile, params.mTopoContent, params.mTopoScript);
+            ParsedTopologyPtr parsed = parseTopology(common, topoFilePath);
+            topologyMs = timer.duration();
+            return make_pair(move(topoFilePath), move(parsed));
+        };
+        // Generating (script) and parsing the topology does not depend on the DDS session: run it while the session is
+        // (re)started. A script cannot be canceled: if the session fails, the script still runs to its end and its output
+        // is discarded.
+        auto topoFuture = async(launch::async, prepareTopology);
+
+        {
+            Timer timer;
+            // Create new DDS session
+            // Shutdown DDS session if it is running already
+            shutdownDDSSession(common, session, error)
+                && createDDSSession(common, session, error);
+            sessionMs = timer.duration();
+        }
 
         updateRestore();
 
-        if (!error.mCode) {
-            try {
-                session.mTopoFilePath = topoFilepath(common, params.mTopoFile, params.mTopoContent, params.mTopoScript);
-                extractRequirements(common, session);
-            } catch (exception& e) {
+        try {
+            auto [topoFilePath, parsed] = topoFuture.get();
+            if (!error.mCode) {
+                session.mTopoFilePath = move(topoFilePath);
+                applyRequirements(session, parsed->mRequirements);
+                logRequirements(common, session);
+            } else {
+                OLOG(info, common) << "Discarding the topology " << quoted(topoFilePath) << ", the DDS session could not be started";
+            }
+        } catch (exception& e) {
+            if (!error.mCode) {
                 fillAndLogFatalError(common, error, ErrorCode::TopologyFailed, toString("Incorrect topology provided: ", e.what()));
             }
+        }
 
-            if (!error.mCode) {
-                if (!session.mDDSSession.IsRunning()) {
-                    fillAndLogError(common, error, ErrorCode::DDSSubmitAgentsFailed, "DDS session is not running. Use Init or Run to start the session.");
-                }
+        if (!error.mCode) {
+            if (!session.mDDSSession.IsRunning()) {
+                fillAndLogError(common, error, ErrorCode::DDSSubmitAgentsFailed, "DDS session is not running. Use Init or Run to start the session.");
+            }
 
-                hosts = submit(common, session, error, params.mPlugin, params.mResources, params.mExtractTopoResources);
+            Timer submitTimer;
+            hosts = submit(common, session, error, params.mPlugin, params.mResources, params.mExtractTopoResources);
+            submitMs = submitTimer.duration();
 
-                if (!session.mDDSSession.IsRunning()) {
-                    fillAndLogError(common, error, ErrorCode::DDSActivateTopologyFailed, "DDS session is not running. Use Init or Run to start the session.");
-                }
+            if (!session.mDDSSession.IsRunning()) {
+                fillAndLogError(common, error, ErrorCode::DDSActivateTopologyFailed, "DDS session is not running. Use Init or Run to start the session.");
+            }
 
-                if (!error.mCode) {
-                    activate(common, session, error);
-                }
+            if (!error.mCode) {
+                Timer activateTimer;
+                activate(common, session, error);
+                activateMs = activateTimer.duration();
             }
         }
+
+        OLOG(info, common) << "Run stage durations: session: " << sessionMs << " ms, topology (concurrent with session): " << topologyMs
+                           << " ms, submit: " << submitMs << " ms, activate: " << activateMs << " ms, total: " << common.mTimer.duration() << " ms";
     } else {
         error = Error(MakeErrorCode(ErrorCode::RequestNotSupported), "Repeated Run request is not supported. Shutdown this partition to retry.");
     }
 
     TopologyState topologyState(error.mCode ? AggregatedState::Undefined : AggregatedState::Idle);
+    string msg{ "Run done" };
+    if (session.mNumPoolAgentsUsed > 0) {
+        msg += toString(". Using ", session.mNumPoolAgentsUsed, " agents of the agent pool");
+    }
     string sidStr{ to_string(session.mDDSSession.getSessionID()) };
     StatusCode status{ error.mCode ? StatusCode::error : StatusCode::ok };
-    return RequestResult(status, "Run done", common.mTimer.duration(), error, common.mPartitionID, common.mRunNr, sidStr, topologyState, hosts);
+    return RequestResult(status, msg, common.mTimer.duration(), error, common.mPartitionID, common.mRunNr, sidStr, topologyState, hosts);
 }
 
 RequestResult Controller::execUpdate(const CommonParams& common, const UpdateParams& params)
@@ -337,22 +439,19 @@ RequestResult Controller::execUpdate(const CommonParams& common, const UpdatePar
     auto& session = acquireSession(common);
 
     TopologyState topologyState;
+    ParsedTopologyPtr parsed;
 
     try {
         session.mTopoFilePath = topoFilepath(common, params.mTopoFile, params.mTopoContent, params.mTopoScript);
-        extractRequirements(common, session);
+        parsed = loadTopology(common, session);
     } catch (exception& e) {
         fillAndLogFatalError(common, error, ErrorCode::TopologyFailed, toString("Incorrect topology provided: ", e.what()));
     }
 
-    if (!error.mCode) {
-        changeStateReset(common, session, error, "", topologyState)
-            && resetTopology(session)
-            && activateDDSTopology(common, session, error, dds::tools_api::STopologyRequest::request_t::EUpdateType::UPDATE)
-            && createDDSTopology(common, session, error)
-            && createTopology(common, session, error)
-            && waitForState(common, session, error, "", DeviceState::Idle)
-            && changeStateConfigure(common, session, error, "", topologyState);
+    if (!error.mCode && session.mTopology != nullptr && session.mDDSTopo != nullptr) {
+        updateTopologyInPlace(common, session, error, parsed->mDDSTopo, topologyState);
+    } else if (!error.mCode) {
+        updateTopology(common, session, error, topologyState);
     }
     return createRequestResult(common, session, error, "Update done", common.mTimer.duration(), std::move(topologyState));
 }
@@ -363,17 +462,23 @@ RequestResult Controller::execShutdown(const CommonParams& common)
 
     // grab the session id before shutting down the session, to return it in the reply
     string ddsSessionId;
+    string msg{ "Shutdown done" };
     {
         auto& session = acquireSession(common);
         ddsSessionId = to_string(session.mDDSSession.getSessionID());
-        shutdownDDSSession(common, session, error);
+        cancelChangeStates(common, session);
+        if (reclaimDDSSession(common, session)) {
+            msg += ". DDS session given back to the session pool";
+        } else {
+            shutdownDDSSession(common, session, error);
+        }
     }
 
     removeSession(common);
     updateRestore();
 
     StatusCode status = error.mCode ? StatusCode::error : StatusCode::ok;
-    return RequestResult(status, "Shutdown done", common.mTimer.duration(), error, common.mPartitionID, common.mRunNr, ddsSessionId, TopologyState(), {});
+    return RequestResult(status, msg, common.mTimer.duration(), error, common.mPartitionID, common.mRunNr, ddsSessionId, TopologyState(), {});
 }
 
 RequestResult Controller::execSetProperties(const CommonParams& common, const SetPropertiesParams& params)
@@ -398,59 +503,97 @@ RequestResult Controller::execGetState(const CommonParams& common, const DeviceP
 
 RequestResult Controller::execConfigure(const CommonParams& common, const DeviceParams& params)
 {
-    Error error;
-    auto& session = acquireSession(common);
+    return waitForRequest([&](RequestHandler handler) { startConfigure(common, params, move(handler)); });
+}
+
+RequestResult Controller::execStart(const CommonParams& common, const DeviceParams& params)
+{
+    return waitForRequest([&](RequestHandler handler) { startStart(common, params, move(handler)); });
+}
+
+RequestResult Controller::execStop(const CommonParams& common, const DeviceParams& params)
+{
+    return waitForRequest([&](RequestHandler handler) { startStop(common, params, move(handler)); });
+}
+
+RequestResult Controller::execReset(const CommonParams& common, const DeviceParams& params)
+{
+    return waitForRequest([&](RequestHandler handler) { startReset(common, params, move(handler)); });
+}
+
+RequestResult Controller::execTerminate(const CommonParams& common, const DeviceParams& params)
+{
+    return waitForRequest([&](RequestHandler handler) { startTerminate(common, params, move(handler)); });
+}
+
+void Controller::startConfigure(const CommonParams& common, const DeviceParams& params, RequestHandler handler)
+{
+    // held by the completions, the session outlives a concurrent Shutdown
+    auto session = acquireSessionPtr(common);
 
     TopologyState topologyState(AggregatedState::Undefined, params.mDetailed ? std::make_optional<DetailedState>() : std::nullopt);
-    changeStateConfigure(common, session, error, params.mPath, topologyState);
-    return createRequestResult(common, session, error, "Configure done", common.mTimer.duration(), std::move(topologyState));
+    asyncChangeState(common, session, params.mPath, configureTransitions(), move(topologyState), [this, common, session, handler](Error error, TopologyState state) {
+        handler(createRequestResult(common, *session, error, "Configure done", common.mTimer.duration(), move(state)));
+    });
 }
 
-RequestResult Controller::execStart(const CommonParams& common, const DeviceParams& params)
+void Controller::startStart(const CommonParams& common, const DeviceParams& params, RequestHandler handler)
 {
-    Error error;
-    auto& session = acquireSession(common);
+    auto session = acquireSessionPtr(common);
 
     // update run number
-    session.mLastRunNr.store(common.mRunNr);
+    session->mLastRunNr.store(common.mRunNr);
 
     TopologyState topologyState(AggregatedState::Undefined, params.mDetailed ? std::make_optional<DetailedState>() : std::nullopt);
-    changeState(common, session, error, params.mPath, TopoTransition::Run, topologyState);
-    return createRequestResult(common, session, error, "Start done", common.mTimer.duration(), std::move(topologyState));
+    asyncChangeState(common, session, params.mPath, { TopoTransition::Run }, move(topologyState), [this, common, session, handler](Error error, TopologyState state) {
+        handler(createRequestResult(common, *session, error, "Start done", common.mTimer.duration(), move(state)));
+    });
 }
 
-RequestResult Controller::execStop(const CommonParams& common, const DeviceParams& params)
+void Controller::startStop(const CommonParams& common, const DeviceParams& params, RequestHandler handler)
 {
-    Error error;
-    auto& session = acquireSession(common);
+    auto session = acquireSessionPtr(common);
 
     TopologyState topologyState(AggregatedState::Undefined, params.mDetailed ? std::make_optional<DetailedState>() : std::nullopt);
-    changeState(common, session, error, params.mPath, TopoTransition::Stop, topologyState);
-
-    // reset the run number, which is valid only for the running state
-    session.mLastRunNr.store(0);
+    asyncChangeState(common, session, params.mPath, { TopoTransition::Stop }, move(topologyState), [this, common, session, handler](Error error, TopologyState state) {
+        // reset the run number, which is valid only for the running state
+        session->mLastRunNr.store(0);
 
-    return createRequestResult(common, session, error, "Stop done", common.mTimer.duration(), std::move(topologyState));
+        handler(createRequestResult(common, *session, error, "Stop done", common.mTimer.duration(), move(state)));
+    });
 }
 
-RequestResult Controller::execReset(const CommonParams& common, const DeviceParams& params)
+void Controller::startReset(const CommonParams& common, const DeviceParams& params, RequestHandler handler)
 {
-    Error error;
-    auto& session = acquireSession(common);
+    auto session = acquireSessionPtr(common);
 
     TopologyState topologyState(AggregatedState::Undefined, params.mDetailed ? std::make_optional<DetailedState>() : std::nullopt);
-    changeStateReset(common, session, error, params.mPath, topologyState);
-    return createRequestResult(common, session, error, "Reset done", common.mTimer.duration(), std::move(topologyState));
+    asyncChangeState(common, session, params.mPath, { TopoTransition::ResetTask }, move(topologyState), [this, common, path = params.mPath, session, handler](Error error, TopologyState state) {
+        if (error.mCode) {
+            handler(createRequestResult(common, *session, error, "Reset done", common.mTimer.duration(), move(state)));
+            return;
+        }
+        asyncChangeState(common, session, path, { TopoTransition::ResetDevice }, move(state), [this, common, session, handler](Error error, TopologyState state) {
+            handler(createRequestResult(common, *session, error, "Reset done", common.mTimer.duration(), move(state)));
+        });
+    });
 }
 
-RequestResult Controller::execTerminate(const CommonParams& common, const DeviceParams& params)
+void Controller::startTerminate(const CommonParams& common, const DeviceParams& params, RequestHandler handler)
 {
-    Error error;
-    auto& session = acquireSession(common);
+    auto session = acquireSessionPtr(common);
 
     TopologyState topologyState(AggregatedState::Undefined, params.mDetailed ? std::make_optional<DetailedState>() : std::nullopt);
-    changeState(common, session, error, params.mPath, TopoTransition::End, topologyState);
-    return createRequestResult(common, session, error, "Terminate done", common.mTimer.duration(), std::move(topologyState));
+    asyncChangeState(common, session, params.mPath, { TopoTransition::End }, move(topologyState), [this, common, session, handler](Error error, TopologyState state) {
+        handler(createRequestResult(common, *session, error, "Terminate done", common.mTimer.duration(), move(state)));
+    });
+}
+
+RequestResult Controller::waitForRequest(const function<void(RequestHandler)>& start)
+{
+    promise<RequestResult> result;
+    start([&result](RequestResult r) { result.set_value(move(r)); });
+    return result.get_future().get();
 }
 
 StatusRequestResult Controller::execStatus(const StatusParams& params)
@@ -474,7 +617,7 @@ StatusRequestResult Controller::execStatus(const StatusParams& params)
             try {
                 status.mAggregatedState = (info->mTopology != nullptr && info->mDDSTopo != nullptr)
                 ?
-                aggregateStateForPath(info->mDDSTopo.get(), info->mTopology->GetCurrentState(), "")
+                info->mTopology->AggregateState()
                 :
                 AggregatedState::Undefined;
             } catch (exception& e) {
@@ -508,6 +651,9 @@ void Controller::updateRestore()
             OLOG(warning, info->mPartitionID, 0) << "Failed to get session ID or session status: " << e.what();
         }
     }
+    if (mSessionPool) {
+        data.mPooledSessions = mSessionPool->ids();
+    }
 
     // Writing the file is locked by mSessionsMtx
     // This is done in order to prevent write failure in case of a parallel execution.
@@ -552,6 +698,33 @@ RequestResult Controller::createRequestResult(const CommonParams& common, const
 
 bool Controller::createDDSSession(const CommonParams& common, Session& session, Error& error)
 {
+    if (mSessionPool) {
+        // a session still being warmed up is usually ready before a new one, wait for it up to half of the request timeout
+        const auto maxWait = chrono::duration_cast<chrono::milliseconds>(requestTimeout(common)) / 2;
+        if (auto pooledID = mSessionPool->take(maxWait); pooledID) {
+            try {
+                session.mDDSSession.attach(*pooledID);
+                if (session.mDDSSession.IsRunning()) {
+                    OLOG(info, common) << "DDS session taken from the session pool, session ID: " << *pooledID << " (" << mSessionPool->numIdle() << " idle sessions left)";
+                    updateHistory(common, *pooledID);
+                    session.mWarmAgents = mAgentPool;
+                    session.mTotalSlots = 0;
+                    for (const auto& p : mAgentPool) {
+                        session.mTotalSlots += p.mNumAgents * p.mNumSlots;
+                    }
+                    return true;
+                }
+                OLOG(warning, common) << "Pooled DDS session " << *pooledID << " is not running anymore, creating a new one";
+            } catch (exception& e) {
+                OLOG(warning, common) << "Failed to attach to pooled DDS session " << *pooledID << ", creating a new one: " << e.what();
+                // the commander may still be running, the pool does not track the session anymore
+                DDSSessionPool::shutdownSession(*pooledID);
+            }
+        } else {
+            OLOG(info, common) << "DDS session pool is empty, creating a new session";
+        }
+    }
+
     try {
         boost::uuids::uuid sessionID = session.mDDSSession.create();
         OLOG(info, common) << "DDS session created with session ID: " << to_string(sessionID);
@@ -563,6 +736,98 @@ bool Controller::createDDSSession(const CommonParams& common, Session& session,
     return true;
 }
 
+void Controller::warmUpDDSSession(const string& sessionID)
+{
+    const CommonParams common("odc-agent-pool", 0, 0);
+    Session session;
+    session.mPartitionID = common.mPartitionID;
+    session.mDDSSession.attach(sessionID);
+
+    Error error;
+    size_t numSlots = 0;
+    const bool success = submitDDSAgents(common, session, error, mAgentPool, numSlots)
+        && waitForNumActiveSlots(common, session, error, numSlots);
+    session.mDDSSession.detach();
+    if (!success) {
+        throw runtime_error(toString("Failed to start the agents of the agent pool: ", error.mDetails));
+    }
+    OLOG(info, common) << "Agent pool: " << numSlots << " slots active in DDS session " << sessionID;
+}
+
+void Controller::assignWarmAgents(const CommonParams& common, Session& session, vector<DDSSubmitParams>& params)
+{
+    for (auto& p : params) {
+        for (auto& warm : session.mWarmAgents) {
+            if (p.mNumAgents == 0) {
+                break;
+            }
+            if (warm.mNumAgents == 0 || warm.mAgentGroup != p.mAgentGroup || warm.mZone != p.mZone || warm.mNumSlots != p.mNumSlots
+                || (p.mNumCores != 0 && warm.mNumCores != p.mNumCores)) {
+                continue;
+            }
+            const uint32_t n = min(p.mNumAgents, warm.mNumAgents);
+            p.mNumAgents -= n;
+            p.mMinAgents = p.mMinAgents > n ? p.mMinAgents - n : 0;
+            warm.mNumAgents -= n;
+            session.mNumPoolAgentsUsed += n;
+            OLOG(info, common) << "Using " << n << " agents of the agent pool for group " << quoted(p.mAgentGroup) << " in zone " << quoted(p.mZone);
+        }
+    }
+    auto assigned = [](const DDSSubmitParams& p) { return p.mNumAgents == 0; };
+    params.erase(remove_if(params.begin(), params.end(), assigned), params.end());
+    session.mWarmAgents.erase(remove_if(session.mWarmAgents.begin(), session.mWarmAgents.end(), assigned), session.mWarmAgents.end());
+}
+
+bool Controller::reclaimDDSSession(const CommonParams& common, Session& session)
+{
+    if (!mSessionPool || mAgentPool.empty()) {
+        return false;
+    }
+
+    try {
+        if (!session.mDDSSession.IsRunning()) {
+            return false;
+        }
+        // agents the partition submitted itself, or lost ones, make the session different from a warmed up one
+        map<string, uint32_t> expected;
+        for (const auto& p : mAgentPool) {
+            expected[p.mAgentGroup] += p.mNumAgents;
+        }
+        map<string, uint32_t> running;
+        for (const auto& ai : getAgentInfo(common, session)) {
+            running[ai.m_groupName]++;
+        }
+        if (running != expected) {
+            OLOG(info, common) << "DDS session does not run exactly the agents of the agent pool, shutting it down";
+            return false;
+        }
+
+        session.mTopology.reset();
+        if (!session.mTopoFilePath.empty()) {
+            Error error;
+            if (!activateDDSTopology(common, session, error, dds::tools_api::STopologyRequest::request_t::EUpdateType::STOP)) {
+                return false;
+            }
+        }
+        if (session.mDDSOnTaskDoneRequest) {
+            session.mDDSOnTaskDoneRequest->unsubscribeResponseCallback();
+        }
+
+        const string sessionID = to_string(session.mDDSSession.getSessionID());
+        session.mDDSSession.detach();
+        if (!mSessionPool->giveBack(sessionID)) {
+            // the pool is being destroyed
+            session.mDDSSession.attach(sessionID);
+            return false;
+        }
+        OLOG(info, common) << "DDS session " << sessionID << " with its agents given back to the session pool";
+        return true;
+    } catch (exception& e) {
+        OLOG(warning, common) << "Failed to give the DDS session back to the session pool: " << e.what();
+        return false;
+    }
+}
+
 bool Controller::attachToDDSSession(const CommonParams& common, Session& session, Error& error, const string& sessionID)
 {
     try {
@@ -587,6 +852,7 @@ bool Controller::shutdownDDSSession(const CommonParams& common, Session& session
         session.mAgentGroupInfo.clear();
         session.mTopoFilePath.clear();
         session.mExpendableTasks.clear();
+        session.mWarmAgents.clear();
 
         if (session.mDDSSession.getSessionID() != boost::uuids::nil_uuid()) {
             if (session.mDDSOnTaskDoneRequest) {
@@ -628,68 +894,133 @@ std::string Controller::getActiveDDSTopology(const CommonParams& common, Session
     }
 }
 
-bool Controller::submitDDSAgents(const CommonParams& common, Session& session, Error& error, const DDSSubmitParams& params)
+bool Controller::submitDDSAgents(const CommonParams& common, Session& session, Error& error, const vector<DDSSubmitParams>& params, size_t& numSlots)
 {
-    bool success = true;
     using namespace dds::tools_api;
 
-    SSubmitRequest::request_t requestInfo;
-    requestInfo.m_submissionTag = common.mPartitionID;
-    requestInfo.m_rms = params.mRMS;
-    requestInfo.m_instances = params.mNumAgents;
-    requestInfo.m_minInstances = params.mMinAgents;
-    requestInfo.m_slots = params.mNumSlots;
-    requestInfo.m_config = params.mConfigFile;
-    requestInfo.m_envCfgFilePath = params.mEnvFile;
-    requestInfo.m_groupName = params.mAgentGroup;
-
-    // DDS does not support ncores parameter directly, set it here through additional config in case of Slurm
-    if (params.mRMS == "slurm" && params.mNumCores > 0) {
-        // the following disables `#SBATCH --cpus-per-task=%DDS_NSLOTS%` of DDS for Slurm
-        requestInfo.setFlag(SSubmitRequestData::ESubmitRequestFlags::enable_overbooking, true);
+    // progress of all submissions, shared with the DDS callbacks (which may still arrive after a timeout)
+    struct Submissions
+    {
+        mutex mtx;
+        condition_variable cv;
+        size_t numDone = 0;
+        bool failed = false;
+        vector<bool> done;
+        vector<string> errors;
+    };
+    auto subs = make_shared<Submissions>();
+    subs->done.assign(params.size(), false);
+    subs->errors.resize(params.size());
+    vector<SSubmitRequest::ptr_t> requests(params.size());
+
+    auto send = [&](size_t i) {
+        const DDSSubmitParams& p = params.at(i);
+
+        SSubmitRequest::request_t requestInfo;
+        requestInfo.m_submissionTag = common.mPartitionID;
+        requestInfo.m_rms = p.mRMS;
+        requestInfo.m_instances = p.mNumAgents;
+        requestInfo.m_minInstances = p.mMinAgents;
+        requestInfo.m_slots = p.mNumSlots;
+        requestInfo.m_config = p.mConfigFile;
+        requestInfo.m_envCfgFilePath = p.mEnvFile;
+        requestInfo.m_groupName = p.mAgentGroup;
+
+        // DDS does not support ncores parameter directly, set it here through additional config in case of Slurm
+        if (p.mRMS == "slurm" && p.mNumCores > 0) {
+            // the following disables `#SBATCH --cpus-per-task=%DDS_NSLOTS%` of DDS for Slurm
+            requestInfo.setFlag(SSubmitRequestData::ESubmitRequestFlags::enable_overbooking, true);
+
+            requestInfo.m_inlineConfig = string("#SBATCH --cpus-per-task=" + to_string(p.mNumCores));
+        }
 
-        requestInfo.m_inlineConfig = string("#SBATCH --cpus-per-task=" + to_string(params.mNumCores));
-    }
+        OLOG(info, common) << "Submitting [" << i + 1 << "/" << params.size() << "]: " << requestInfo;
 
-    OLOG(info, common) << "Submitting: " << requestInfo;
+        SSubmitRequest::ptr_t requestPtr = SSubmitRequest::makeRequest(requestInfo);
 
-    condition_variable cv;
+        requestPtr->setMessageCallback([subs, i, common](const SMessageResponseData& msg) {
+            if (msg.m_severity == dds::intercom_api::EMsgSeverity::error) {
+                OLOG(error, common) << "...Submit [" << i + 1 << "/" << subs->done.size() << "]: " << msg.m_msg;
+                lock_guard<mutex> lk(subs->mtx);
+                subs->failed = true;
+                subs->errors.at(i) += (subs->errors.at(i).empty() ? "" : "; ") + msg.m_msg;
+            } else {
+                OLOG(info, common) << "...Submit [" << i + 1 << "/" << subs->done.size() << "]: " << msg.m_msg;
+            }
+        });
 
-    SSubmitRequest::ptr_t requestPtr = SSubmitRequest::makeRequest(requestInfo);
+        // the session may be gone when a late callback arrives, only shared state is captured
+        requestPtr->setDoneCallback([subs, i, agentEvents = session.agentEvents()]() {
+            {
+                lock_guard<mutex> lk(subs->mtx);
+                subs->done.at(i) = true;
+                ++subs->numDone;
+            }
+            subs->cv.notify_all();
+            agentEvents->notify();
+        });
 
-    requestPtr->setMessageCallback([&success, &error, &common, this](const SMessageResponseData& msg) {
-        if (msg.m_severity == dds::intercom_api::EMsgSeverity::error) {
-            success = false;
-            fillAndLogError(common, error, ErrorCode::DDSSubmitAgentsFailed, toString("Submit error: ", msg.m_msg));
-        } else {
-            OLOG(info, common) << "...Submit: " << msg.m_msg;
+        requests.at(i) = requestPtr;
+        session.mDDSSession.sendRequest<SSubmitRequest>(requestPtr);
+    };
+
+    // Submit independent agent groups concurrently, at most mSubmitConcurrency at a time.
+    // No further submissions are started after one failed.
+    const auto deadline = chrono::steady_clock::now() + requestTimeout(common);
+    bool timedOut = false;
+    size_t next = 0;
+    unique_lock<mutex> lk(subs->mtx);
+    while (true) {
+        while (next < params.size() && next - subs->numDone < mSubmitConcurrency && !subs->failed) {
+            const size_t i = next++;
+            lk.unlock();
+            send(i);
+            lk.lock();
         }
-    });
-
-    requestPtr->setDoneCallback([&cv, &common]() {
-        // OLOG(info, common) << "Agent submission done";
-        cv.notify_all();
-    });
-
-    session.mDDSSession.sendRequest<SSubmitRequest>(requestPtr);
+        if (subs->numDone == next) {
+            break;
+        }
+        const size_t numDone = subs->numDone;
+        if (!subs->cv.wait_until(lk, deadline, [&]() { return subs->numDone != numDone; })) {
+            timedOut = true;
+            break;
+        }
+    }
 
-    mutex mtx;
-    unique_lock<mutex> lock(mtx);
-    cv_status waitStatus = cv.wait_for(lock, requestTimeout(common));
+    string errors;
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (!subs->errors.at(i).empty()) {
+            errors += toString(errors.empty() ? "" : "; ", "[", i + 1, "/", params.size(), "] group ", quoted(params.at(i).mAgentGroup), ": ", subs->errors.at(i));
+        } else if (subs->done.at(i)) {
+            numSlots += params.at(i).mNumAgents * params.at(i).mNumSlots;
+        }
+    }
+    const size_t numPending = next - subs->numDone;
+    const size_t numSkipped = params.size() - next;
+    lk.unlock();
 
-    if (waitStatus == cv_status::timeout) {
-        success = false;
-        fillAndLogError(common, error, ErrorCode::RequestTimeout, "Timed out waiting for agent submission");
-    } else {
-        // OLOG(info, common) << "Agent submission done successfully";
+    if (!errors.empty()) {
+        fillAndLogError(common, error, ErrorCode::DDSSubmitAgentsFailed, toString("Submit error: ", errors, (numSkipped > 0 ? toString(" (", numSkipped, " submissions skipped)") : "")));
+        return false;
     }
-    return success;
+    if (timedOut) {
+        for (size_t i = 0; i < next; ++i) {
+            requests.at(i)->unsubscribeResponseCallback();
+        }
+        fillAndLogError(common, error, ErrorCode::RequestTimeout, toString("Timed out waiting for agent submission (", numPending, " of ", params.size(), " submissions pending)"));
+        return false;
+    }
+    return true;
 }
 
 bool Controller::waitForNumActiveSlots(const CommonParams& common, Session& session, Error& error, size_t numSlots)
 {
     try {
-        session.mDDSSession.waitForNumSlots<dds::tools_api::CSession::EAgentState::active>(numSlots, requestTimeout(common));
+        uint32_t currentSlots = 0;
+        if (!waitForNumSlots(common, session, [numSlots](uint32_t n) { return n >= numSlots; }, currentSlots)) {
+            fillAndLogError(common, error, ErrorCode::RequestTimeout, toString("Timeout waiting for DDS slots: ", currentSlots, " of ", numSlots, " active"));
+            return false;
+        }
     } catch (exception& e) {
         fillAndLogError(common, error, ErrorCode::RequestTimeout, toString("Timeout waiting for DDS slots: ", e.what()));
         return false;
@@ -697,6 +1028,28 @@ bool Controller::waitForNumActiveSlots(const CommonParams& common, Session& sess
     return true;
 }
 
+bool Controller::waitForNumSlots(const CommonParams& common, Session& session, const function<bool(uint32_t)>& reached, uint32_t& currentSlots)
+{
+    // DDS has no notification on agent (dis)connection: the slot count is requested again as soon as the session
+    // signals an agent event, otherwise with a backoff capped at 100 ms, so that the wait ends at most 100 ms after the
+    // condition holds
+    const auto deadline = chrono::steady_clock::now() + requestTimeout(common);
+    auto backoff = chrono::milliseconds(25);
+    uint64_t events = session.numAgentEvents();
+    while (true) {
+        currentSlots = getNumSlots(common, session);
+        if (reached(currentSlots)) {
+            return true;
+        }
+        const auto now = chrono::steady_clock::now();
+        if (now >= deadline || !session.mDDSSession.IsRunning()) {
+            return false;
+        }
+        events = session.waitForAgentEvent(events, min(deadline, now + backoff));
+        backoff = min(backoff * 2, chrono::milliseconds(100));
+    }
+}
+
 bool Controller::activateDDSTopology(const CommonParams& common, Session& session, Error& error, dds::tools_api::STopologyRequest::request_t::EUpdateType updateType)
 {
     bool success = true;
@@ -731,6 +1084,11 @@ bool Controller::activateDDSTopology(const CommonParams& common, Session& sessio
 
         // We are not interested in stopped tasks
         if (res.m_activated) {
+            // topology created before the activation, see activate()
+            if (session.mTopology) {
+                session.mTopology->OnTaskActivated(res.m_taskID);
+            }
+
             TaskDetails task{res.m_agentID, res.m_slotID, res.m_taskID, res.m_collectionID, res.m_path, res.m_host, res.m_wrkDir};
             session.addTaskDetails(move(task));
 
@@ -757,6 +1115,8 @@ bool Controller::activateDDSTopology(const CommonParams& common, Session& sessio
         success = false;
         fillAndLogError(common, error, ErrorCode::RequestTimeout, "Timed out waiting for topology activation");
         OLOG(error, common) << error;
+        // late responses must not reach a topology that is about to be reset
+        requestPtr->unsubscribeResponseCallback();
     }
 
     // session.debug();
@@ -767,17 +1127,49 @@ bool Controller::activateDDSTopology(const CommonParams& common, Session& sessio
 
 void Controller::extractRequirements(const CommonParams& common, Session& session)
 {
-    using namespace dds::topology_api;
+    dds::topology_api::CTopology ddsTopo(session.mTopoFilePath);
+    TopologyRequirements reqs;
+    OLOG(info, common) << "Extracting requirements from " << std::quoted(session.mTopoFilePath) << "...";
+    extractRequirements(common, ddsTopo, reqs);
+    applyRequirements(session, reqs);
+    logRequirements(common, session);
+}
+
+ParsedTopologyPtr Controller::loadTopology(const CommonParams& common, Session& session)
+{
+    auto parsed = parseTopology(common, session.mTopoFilePath);
+    applyRequirements(session, parsed->mRequirements);
+    logRequirements(common, session);
+    return parsed;
+}
 
-    CTopology ddsTopo(session.mTopoFilePath);
+ParsedTopologyPtr Controller::parseTopology(const CommonParams& common, const string& topoFilePath)
+{
+    bool cached = false;
+    auto parsed = mTopoCache.get(topoFilePath, [&](const string& path, ParsedTopology& p) {
+        OLOG(info, common) << "Parsing topology and extracting requirements from " << std::quoted(path) << "...";
+        p.mDDSTopo = make_shared<dds::topology_api::CTopology>(path);
+        extractRequirements(common, *(p.mDDSTopo), p.mRequirements);
+    }, cached);
+    if (cached) {
+        OLOG(info, common) << "Using cached topology and requirements for " << std::quoted(topoFilePath);
+    }
+    return parsed;
+}
 
-    session.mNinfo.clear();
-    session.mZoneInfo.clear();
-    session.mStandaloneTasks.clear();
-    session.mCollections.clear();
-    session.mAgentGroupInfo.clear();
+void Controller::applyRequirements(Session& session, const TopologyRequirements& reqs)
+{
+    session.mNinfo = reqs.mNinfo;
+    session.mZoneInfo = reqs.mZoneInfo;
+    session.mStandaloneTasks = reqs.mStandaloneTasks;
+    session.mCollections = reqs.mCollections;
+    session.mAgentGroupInfo = reqs.mAgentGroupInfo;
+    session.mExpendableTasks = reqs.mExpendableTasks;
+}
 
-    OLOG(info, common) << "Extracting requirements from " << std::quoted(session.mTopoFilePath) << "...";
+void Controller::extractRequirements(const CommonParams& common, dds::topology_api::CTopology& ddsTopo, TopologyRequirements& reqs)
+{
+    using namespace dds::topology_api;
 
     auto taskIt = ddsTopo.getRuntimeTaskIterator();
 
@@ -791,7 +1183,7 @@ void Controller::extractRequirements(const CommonParams& common, Session& sessio
                 if (strStartsWith(tr->getName(), "odc_expendable_")) {
                     if (tr->getValue() == "true") {
                         OLOG(debug, common) << "  Task '" << topoTask.getName() << "' (" << task.m_taskId << "), path: " << topoTask.getPath() << " [" << task.m_taskPath << "] is expendable";
-                        session.mExpendableTasks.emplace(task.m_taskId);
+                        reqs.mExpendableTasks.emplace(task.m_taskId);
                     } else if (tr->getValue() == "false") {
                         OLOG(debug, common) << "  Task '" << topoTask.getName() << "' (" << task.m_taskId << "), path: " << topoTask.getPath() << " [" << task.m_taskPath << "] is not expendable";
                     } else {
@@ -832,7 +1224,7 @@ void Controller::extractRequirements(const CommonParams& common, Session& sessio
             }
         }
 
-        session.mStandaloneTasks.emplace_back(TaskInfo{ t->getName(), zone, agentGroup, topoParent, n });
+        reqs.mStandaloneTasks.emplace_back(TaskInfo{ t->getName(), zone, agentGroup, topoParent, n });
     }
 
     auto collections = ddsTopo.getMainGroup()->getElementsByType(CTopoBase::EType::COLLECTION);
@@ -892,11 +1284,11 @@ void Controller::extractRequirements(const CommonParams& common, Session& sessio
         }
 
         // TODO: should n_current be set to 0 and increased as collections are launched instead?
-        session.mCollections[c->getName()] = CollectionInfo{c->getName(), zone, agentGroup, topoParent, topoPath, n, n, nmin, nCores, numTasks, numTasksTotal};
+        reqs.mCollections[c->getName()] = CollectionInfo{c->getName(), zone, agentGroup, topoParent, topoPath, n, n, nmin, nCores, numTasks, numTasksTotal};
 
-        auto agiIt = session.mAgentGroupInfo.find(agentGroup);
-        if (agiIt == session.mAgentGroupInfo.end()) {
-            session.mAgentGroupInfo.emplace(agentGroup, AgentGroupInfo{ agentGroup, zone, n, nmin, numTasks, nCores });
+        auto agiIt = reqs.mAgentGroupInfo.find(agentGroup);
+        if (agiIt == reqs.mAgentGroupInfo.end()) {
+            reqs.mAgentGroupInfo.emplace(agentGroup, AgentGroupInfo{ agentGroup, zone, n, nmin, numTasks, nCores });
         } else {
             agiIt->second.numAgents += n;
             agiIt->second.numSlots += numTasks;
@@ -906,24 +1298,27 @@ void Controller::extractRequirements(const CommonParams& common, Session& sessio
         }
 
         if (!agentGroup.empty()) {
-            auto nIt = session.mNinfo.find(c->getName());
-            if (nIt == session.mNinfo.end()) {
-                session.mNinfo.try_emplace(c->getName(), CollectionNInfo{ n, n, nmin, agentGroup });
+            auto nIt = reqs.mNinfo.find(c->getName());
+            if (nIt == reqs.mNinfo.end()) {
+                reqs.mNinfo.try_emplace(c->getName(), CollectionNInfo{ n, n, nmin, agentGroup });
             } else {
                 // OLOG(info, common) << "collection " << c->getName() << " is already in the mNinfo";
             }
         }
 
         if (!agentGroup.empty() && !zone.empty()) {
-            auto ziIt = session.mZoneInfo.find(zone);
-            if (ziIt == session.mZoneInfo.end()) {
-                session.mZoneInfo.try_emplace(zone, std::vector<ZoneGroup>{ ZoneGroup{n, nCores, agentGroup} });
+            auto ziIt = reqs.mZoneInfo.find(zone);
+            if (ziIt == reqs.mZoneInfo.end()) {
+                reqs.mZoneInfo.try_emplace(zone, std::vector<ZoneGroup>{ ZoneGroup{n, nCores, agentGroup} });
             } else {
                 ziIt->second.emplace_back(ZoneGroup{n, nCores, agentGroup});
             }
         }
     }
+}
 
+void Controller::logRequirements(const CommonParams& common, const Session& session)
+{
     if (!session.mZoneInfo.empty()) {
         OLOG(info, common) << "Zones from the topology:";
         for (const auto& z : session.mZoneInfo) {
@@ -965,8 +1360,12 @@ bool Controller::createDDSTopology(const CommonParams& common, Session& session,
 {
     using namespace dds::topology_api;
     try {
-        session.mDDSTopo = make_unique<CTopology>(session.mTopoFilePath);
-        OLOG(info, common) << "DDS CTopology for " << quoted(session.mTopoFilePath) << " created successfully";
+        bool cached = false;
+        session.mDDSTopo = mTopoCache.get(session.mTopoFilePath, [&](const string& topoFilePath, ParsedTopology& p) {
+            p.mDDSTopo = make_shared<CTopology>(topoFilePath);
+            extractRequirements(common, *(p.mDDSTopo), p.mRequirements);
+        }, cached)->mDDSTopo;
+        OLOG(info, common) << "DDS CTopology for " << quoted(session.mTopoFilePath) << (cached ? " taken from the topology cache" : " created successfully");
     } catch (exception& e) {
         fillAndLogError(common, error, ErrorCode::DDSCreateTopologyFailed, toString("Failed to initialize DDS topology: ", e.what()));
         return false;
@@ -980,7 +1379,7 @@ bool Controller::resetTopology(Session& session)
     return true;
 }
 
-bool Controller::createTopology(const CommonParams& common, Session& session, Error& error)
+bool Controller::createTopology(const CommonParams& common, Session& session, Error& error, bool subscribeOnActivation)
 {
     try {
         session.mTopology = make_unique<Topology>(
@@ -990,7 +1389,12 @@ bool Controller::createTopology(const CommonParams& common, Session& session, Er
             session.mCollections,
             common.mPartitionID,
             session.mLastRunNr,
-            false);
+            false,
+            TopoSerialization::Mutex,
+            subscribeOnActivation);
+        session.mTopology->SetFailFast(mFailFast);
+        session.mTopology->SetQuorum(mQuorum);
+        session.mTopology->SetRequestIdGenerator(mRequestIds);
     } catch (exception& e) {
         session.mTopology = nullptr;
         fillAndLogError(common, error, ErrorCode::FairMQCreateTopologyFailed, toString("Failed to initialize FairMQ topology: ", e.what()));
@@ -998,30 +1402,161 @@ bool Controller::createTopology(const CommonParams& common, Session& session, Er
     return session.mTopology != nullptr;
 }
 
+bool Controller::updateTopology(const CommonParams& common, Session& session, Error& error, TopologyState& topologyState)
+{
+    return changeStateReset(common, session, error, "", topologyState)
+        && resetTopology(session)
+        && activateDDSTopology(common, session, error, dds::tools_api::STopologyRequest::request_t::EUpdateType::UPDATE)
+        && createDDSTopology(common, session, error)
+        && createTopology(common, session, error)
+        && waitForState(common, session, error, "", DeviceState::Idle)
+        && changeStateConfigure(common, session, error, "", topologyState);
+}
+
+bool Controller::updateTopologyInPlace(const CommonParams& common, Session& session, Error& error, shared_ptr<dds::topology_api::CTopology> ddsTopo, TopologyState& topologyState)
+{
+    const TopoDiff diff = session.mTopology->Diff(*ddsTopo);
+    if (Topology::ReconnectsToAdded(*ddsTopo, diff.added)) {
+        OLOG(info, common) << "Updating the whole topology: devices of the running topology connect to channels of the " << diff.added.size() << " added tasks";
+        return updateTopology(common, session, error, topologyState);
+    }
+    OLOG(info, common) << "Updating the topology in place: " << diff.removed.size() << " tasks removed, " << diff.added.size() << " tasks added";
+
+    // the removed devices are stopped by DDS during the update, they have to leave the Ready state first
+    if (!diff.removed.empty() && !changeStateReset(common, session, error, Topology::SelectionPattern(*(session.mDDSTopo), diff.removed), topologyState)) {
+        return false;
+    }
+
+    try {
+        session.mTopology->ApplyUpdate(*ddsTopo, session.mExpendableTasks);
+    } catch (exception& e) {
+        fillAndLogError(common, error, ErrorCode::FairMQCreateTopologyFailed, toString("Failed to update FairMQ topology: ", e.what()));
+        return false;
+    }
+    session.mDDSTopo = ddsTopo;
+
+    if (!activateDDSTopology(common, session, error, dds::tools_api::STopologyRequest::request_t::EUpdateType::UPDATE)) {
+        resetTopology(session);
+        return false;
+    }
+    session.mTopology->FinishActivation();
+
+    if (diff.added.empty()) {
+        return getState(common, session, error, "", topologyState);
+    }
+    const string addedPath = Topology::SelectionPattern(*ddsTopo, diff.added);
+    return waitForState(common, session, error, addedPath, DeviceState::Idle)
+        && changeStateConfigure(common, session, error, addedPath, topologyState);
+}
+
 bool Controller::changeState(const CommonParams& common, Session& session, Error& error, const string& path, TopoTransition transition, TopologyState& topologyState)
+{
+    return changeState(common, session, error, path, vector<TopoTransition>{ transition }, topologyState);
+}
+
+bool Controller::changeState(const CommonParams& common, Session& session, Error& error, const string& path, const vector<TopoTransition>& transitions, TopologyState& topologyState)
+{
+    string transition;
+    DeviceState expState = DeviceState::Undefined;
+    if (!prepareChangeState(common, session, error, path, transitions, transition, expState)) {
+        return false;
+    }
+
+    try {
+        auto [errorCode, snapshot] = session.mTopology->ChangeState(transitions, path, requestTimeout(common));
+        return completeChangeState(common, session, error, transition, expState, errorCode, snapshot, topologyState);
+    } catch (exception& e) {
+        stateSummaryOnFailure(common, session, session.mTopology->GetStateSnapshot()->state, expState);
+        fillAndLogFatalError(common, error, ErrorCode::FairMQChangeStateFailed, toString("Change state failed: ", e.what()));
+        return false;
+    }
+}
+
+void Controller::asyncChangeState(const CommonParams& common, shared_ptr<Session> sessionPtr, const string& path, const vector<TopoTransition>& transitions, TopologyState topologyState, ChangeStateHandler done)
+{
+    Session& session = *sessionPtr;
+    Error error;
+    string transition;
+    DeviceState expState = DeviceState::Undefined;
+    if (!prepareChangeState(common, session, error, path, transitions, transition, expState)) {
+        done(error, move(topologyState));
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mAsyncMtx);
+        if (mShuttingDown || session.mClosing) {
+            fillAndLogError(common, error, ErrorCode::OperationCanceled, "Change state canceled, the session is shutting down");
+            done(error, move(topologyState));
+            return;
+        }
+        ++mNumAsyncChangeStates;
+        ++session.mNumAsyncChangeStates;
+    }
+    auto finished = [this, &session]() {
+        {
+            lock_guard<mutex> lock(mAsyncMtx);
+            --mNumAsyncChangeStates;
+            --session.mNumAsyncChangeStates;
+        }
+        mAsyncCv.notify_all();
+    };
+
+    auto state = make_shared<TopologyState>(move(topologyState));
+    try {
+        // the completion is moved off the topology (which may complete the operation while holding its lock)
+        session.mTopology->AsyncChangeState(transitions, path, requestTimeout(common),
+            boost::asio::bind_executor(mAsyncPool, [this, common, sessionPtr, transition, expState, state, done, finished](error_code errorCode, TopoStateSnapshotPtr snapshot) {
+                Error error;
+                // must not escape onto mAsyncPool
+                try {
+                    completeChangeState(common, *sessionPtr, error, transition, expState, errorCode, snapshot, *state);
+                    done(error, move(*state));
+                } catch (exception& e) {
+                    OLOG(error, common) << "Exception in the completion of " << transition << ": " << e.what();
+                }
+                finished();
+            }));
+    } catch (exception& e) {
+        stateSummaryOnFailure(common, session, session.mTopology->GetStateSnapshot()->state, expState);
+        fillAndLogFatalError(common, error, ErrorCode::FairMQChangeStateFailed, toString("Change state failed: ", e.what()));
+        done(error, move(*state));
+        finished();
+    }
+}
+
+bool Controller::prepareChangeState(const CommonParams& common, Session& session, Error& error, const string& path, const vector<TopoTransition>& transitions, string& transition, DeviceState& expState)
 {
     if (session.mTopology == nullptr) {
         fillAndLogError(common, error, ErrorCode::FairMQChangeStateFailed, "FairMQ topology is not initialized");
         return false;
     }
 
-    OLOG(info, common) << "Requesting transition " << toString(transition) << " for path " << quoted(path);
-
-    auto it = gExpectedState.find(transition);
-    DeviceState expState{ it != gExpectedState.end() ? it->second : DeviceState::Undefined };
-    if (expState == DeviceState::Undefined) {
-        fillAndLogError(common, error, ErrorCode::FairMQChangeStateFailed, toString("Unexpected FairMQ transition ", transition));
+    for (const auto t : transitions) {
+        transition += (transition.empty() ? "" : "->") + toString(t);
+        auto it = gExpectedState.find(t);
+        expState = it != gExpectedState.end() ? it->second : DeviceState::Undefined;
+        if (expState == DeviceState::Undefined) {
+            fillAndLogError(common, error, ErrorCode::FairMQChangeStateFailed, toString("Unexpected FairMQ transition ", t));
+            return false;
+        }
+    }
+    if (transitions.empty()) {
+        fillAndLogError(common, error, ErrorCode::FairMQChangeStateFailed, "No FairMQ transition requested");
         return false;
     }
 
-    bool success = true;
+    OLOG(info, common) << "Requesting transition " << transition << " for path " << quoted(path);
+    return true;
+}
 
-    try {
-        auto [errorCode, topoState] = session.mTopology->ChangeState(transition, path, requestTimeout(common));
+bool Controller::completeChangeState(const CommonParams& common, Session& session, Error& error, const string& transition, DeviceState expState, error_code errorCode, TopoStateSnapshotPtr snapshot, TopologyState& topologyState)
+{
+    bool success = !errorCode;
 
-        success = !errorCode;
+    try {
         if (!success) {
-            stateSummaryOnFailure(common, session, session.mTopology->GetCurrentState(), expState);
+            stateSummaryOnFailure(common, session, snapshot->state, expState);
             switch (static_cast<ErrorCode>(errorCode.value())) {
                 case ErrorCode::OperationTimeout:
                     fillAndLogFatalError(common, error, ErrorCode::RequestTimeout, toString("Timed out waiting for ", transition, " transition"));
@@ -1033,17 +1568,18 @@ bool Controller::changeState(const CommonParams& common, Session& session, Error
         }
 
         if (topologyState.detailed.has_value()) {
-            session.fillDetailedState(topoState, topologyState.detailed.value());
+            session.fillDetailedState(snapshot->state, topologyState.detailed.value());
         }
 
-        topologyState.aggregated = AggregateState(topoState);
+        const TopoStateCounts counts = session.mTopology->GetStateCounts();
+        topologyState.aggregated = counts.aggregated;
         if (success) {
             OLOG(info, common) << "State changed to " << topologyState.aggregated << " via " << transition << " transition";
         }
 
-        printStateStats(common, topoState);
+        printStateStats(common, counts);
     } catch (exception& e) {
-        stateSummaryOnFailure(common, session, session.mTopology->GetCurrentState(), expState);
+        stateSummaryOnFailure(common, session, session.mTopology->GetStateSnapshot()->state, expState);
         fillAndLogFatalError(common, error, ErrorCode::FairMQChangeStateFailed, toString("Change state failed: ", e.what()));
         success = false;
     }
@@ -1067,7 +1603,7 @@ bool Controller::waitForState(const CommonParams& common, Session& session, Erro
 
         success = !errorCode;
         if (!success) {
-            stateSummaryOnFailure(common, session, session.mTopology->GetCurrentState(), expState);
+            stateSummaryOnFailure(common, session, session.mTopology->GetStateSnapshot()->state, expState);
             switch (static_cast<ErrorCode>(errorCode.value())) {
                 case ErrorCode::OperationTimeout:
                     fillAndLogError(common, error, ErrorCode::RequestTimeout, toString("Timed out waiting for ", expState, " state"));
@@ -1080,7 +1616,7 @@ bool Controller::waitForState(const CommonParams& common, Session& session, Erro
             OLOG(info, common) << "Topology state is now " << expState;
         }
     } catch (exception& e) {
-        stateSummaryOnFailure(common, session, session.mTopology->GetCurrentState(), expState);
+        stateSummaryOnFailure(common, session, session.mTopology->GetStateSnapshot()->state, expState);
         fillAndLogError(common, error, ErrorCode::FairMQChangeStateFailed, toString("Wait for state failed: ", e.what()));
         success = false;
     }
@@ -1090,11 +1626,7 @@ bool Controller::waitForState(const CommonParams& common, Session& session, Erro
 
 bool Controller::changeStateConfigure(const CommonParams& common, Session& session, Error& error, const string& path, TopologyState& topologyState)
 {
-    return changeState(common, session, error, path, TopoTransition::InitDevice,   topologyState)
-        && changeState(common, session, error, path, TopoTransition::CompleteInit, topologyState)
-        && changeState(common, session, error, path, TopoTransition::Bind,         topologyState)
-        && changeState(common, session, error, path, TopoTransition::Connect,      topologyState)
-        && changeState(common, session, error, path, TopoTransition::InitTask,     topologyState);
+    return changeState(common, session, error, path, configureTransitions(), topologyState);
 }
 
 bool Controller::changeStateReset(const CommonParams& common, Session& session, Error& error, const string& path, TopologyState& topologyState)
@@ -1112,19 +1644,19 @@ bool Controller::getState(const CommonParams& common, Session& session, Error& e
     }
 
     bool success = true;
-    auto const topoState = session.mTopology->GetCurrentState();
+    const TopoStateSnapshotPtr snapshot = session.mTopology->GetStateSnapshot();
 
     try {
-        topologyState.aggregated = aggregateStateForPath(session.mDDSTopo.get(), topoState, path);
+        topologyState.aggregated = aggregateStateForPath(*(session.mTopology), snapshot->state, path);
     } catch (exception& e) {
         success = false;
         fillAndLogError(common, error, ErrorCode::FairMQGetStateFailed, toString("Get state failed: ", e.what()));
     }
     if (topologyState.detailed.has_value()) {
-        session.fillDetailedState(topoState, topologyState.detailed.value());
+        session.fillDetailedState(snapshot->state, topologyState.detailed.value());
     }
 
-    printStateStats(common, topoState);
+    printStateStats(common, session.mTopology->GetStateCounts());
 
     return success;
 }
@@ -1157,7 +1689,7 @@ bool Controller::setProperties(const CommonParams& common, Session& session, Err
             }
         }
 
-        topologyState.aggregated = AggregateState(session.mTopology->GetCurrentState());
+        topologyState.aggregated = session.mTopology->AggregateState();
     } catch (exception& e) {
         fillAndLogError(common, error, ErrorCode::FairMQSetPropertiesFailed, toString("Set properties failed: ", e.what()));
     }
@@ -1165,59 +1697,26 @@ bool Controller::setProperties(const CommonParams& common, Session& session, Err
     return !error.mCode;
 }
 
-AggregatedState Controller::aggregateStateForPath(const dds::topology_api::CTopology* ddsTopo, const TopoState& topoState, const string& path)
+AggregatedState Controller::aggregateStateForPath(const Topology& topo, const TopoState& topoState, const string& path)
 {
     if (path.empty()) {
         return AggregateState(topoState);
     }
 
-    if (ddsTopo == nullptr) {
-        throw runtime_error("DDS topology is not initialized");
+    // A single task path or a pattern matching multiple tasks, resolved (and cached) by the topology path index
+    const TopoPathSelectionPtr selection = topo.GetPathSelection(path);
+    if (selection->empty()) {
+        throw runtime_error("No tasks found matching the path " + path);
     }
 
-    try {
-        // Check if path points to a single task
-        // If task is found than return it's state as an aggregated topology state
-
-        // Throws if task not found for path
-        const auto& task{ ddsTopo->getRuntimeTask(path) };
-        auto it{ find_if(topoState.cbegin(), topoState.cend(), [&](const TopoState::value_type& v) { return v.taskId == task.m_taskId; }) };
-        if (it != topoState.cend())
-            return static_cast<AggregatedState>(it->state);
-
-        throw runtime_error("Device not found for path " + path);
-    } catch (exception& /* e */) {
-        // In case of exception check that path contains multiple tasks
-
-        // Collect all task IDs to a set for fast search
-        set<dds::topology_api::Id_t> taskIds;
-        auto it{ ddsTopo->getRuntimeTaskIteratorMatchingPath(path) };
-        for_each(it.first, it.second, [&](const dds::topology_api::STopoRuntimeTask::FilterIterator_t::value_type& v) {
-            taskIds.insert(v.second.m_taskId);
-        });
-
-        if (taskIds.empty()) {
-            throw runtime_error("No tasks found matching the path " + path);
-        }
-
-        // Find a state of a first task
-        auto firstIt{ find_if(topoState.cbegin(), topoState.cend(), [&](const TopoState::value_type& v) {
-            return v.taskId == *(taskIds.begin());
-        }) };
-        if (firstIt == topoState.cend()) {
-            throw runtime_error("No states found for path " + path);
-        }
-
-        // Check that all selected devices have the same state
-        AggregatedState first{ static_cast<AggregatedState>(firstIt->state) };
-        if (all_of(topoState.cbegin(), topoState.cend(), [&](const TopoState::value_type& v) {
-                return (taskIds.count(v.taskId) > 0) ? v.state == first : true;
-            })) {
-            return first;
+    // The state snapshot is ordered by the same task indices as the selection
+    const DeviceState first = topoState.at(selection->front()).state;
+    for (const int index : *selection) {
+        if (topoState.at(index).state != first) {
+            return AggregatedState::Mixed;
         }
-
-        return AggregatedState::Mixed;
     }
+    return static_cast<AggregatedState>(first);
 }
 
 void Controller::fillAndLogError(const CommonParams& common, Error& error, ErrorCode errorCode, const string& msg)
@@ -1244,18 +1743,23 @@ void Controller::logFatalLineByLine(const CommonParams& common, const string& ms
 }
 
 Session& Controller::acquireSession(const CommonParams& common)
+{
+    return *acquireSessionPtr(common);
+}
+
+shared_ptr<Session> Controller::acquireSessionPtr(const CommonParams& common)
 {
     lock_guard<mutex> lock(mSessionsMtx);
     auto it = mSessions.find(common.mPartitionID);
     if (it == mSessions.end()) {
-        auto newSession = make_unique<Session>();
+        auto newSession = make_shared<Session>();
         newSession->mPartitionID = common.mPartitionID;
         auto ret = mSessions.emplace(common.mPartitionID, move(newSession));
         // OLOG(debug, common) << "Created session for partition ID " << quoted(common.mPartitionID);
-        return *(ret.first->second);
+        return ret.first->second;
     }
     // OLOG(debug, common) << "Found session for partition ID " << quoted(common.mPartitionID);
-    return *(it->second);
+    return it->second;
 }
 
 void Controller::removeSession(const CommonParams& common)
@@ -1327,7 +1831,7 @@ void Controller::stateSummaryOnFailure(const CommonParams& common, Session& sess
 void Controller::ShutdownDDSAgent(const CommonParams& common, Session& session, uint64_t agentID)
 {
     try {
-        size_t currentSlotCount = session.mTotalSlots;
+        uint32_t currentSlotCount = session.mTotalSlots;
         size_t numSlotsToRemove = session.mAgentSlots.at(agentID);
         size_t expectedNumSlots = session.mTotalSlots - numSlotsToRemove;
         OLOG(info, common) << "Current number of slots: " << session.mTotalSlots << ", expecting to reduce to " << expectedNumSlots;
@@ -1339,22 +1843,8 @@ void Controller::ShutdownDDSAgent(const CommonParams& common, Session& session,
         agentCmd.m_arg1 = agentID;
         session.mDDSSession.syncSendRequest<SAgentCommandRequest>(agentCmd, requestTimeout(common));
 
-        // TODO: notification on agent shutdown in development in DDS
-        currentSlotCount = getNumSlots(common, session);
-        OLOG(info, common) << "Current number of slots: " << currentSlotCount;
-
-        if (currentSlotCount != expectedNumSlots) {
-            int64_t secondsLeft = requestTimeout(common).count();
-            if (secondsLeft > 0) {
-                int64_t maxAttempts = (secondsLeft * 1000) / 50;
-                while (currentSlotCount != expectedNumSlots && maxAttempts > 0) {
-                    this_thread::sleep_for(chrono::milliseconds(50));
-                    currentSlotCount = getNumSlots(common, session);
-                    // OLOG(info, common) << "Current number of slots: " << currentSlotCount;
-                    --maxAttempts;
-                }
-            }
-        }
+        // TODO: notification on agent shutdown in development in DDS, until then waitForNumSlots() polls
+        waitForNumSlots(common, session, [expectedNumSlots](uint32_t n) { return n == expectedNumSlots; }, currentSlotCount);
         if (currentSlotCount != expectedNumSlots) {
             OLOG(warning, common) << "Could not reduce the number of slots to " << expectedNumSlots << ", current count is: " << currentSlotCount;
         } else {
@@ -1396,29 +1886,40 @@ string Controller::topoFilepath(const CommonParams& common, const string& topolo
 
     // Execute topology script if needed
     if (!topologyScript.empty()) {
-        string out;
-        string err;
-        int exitCode = EXIT_SUCCESS;
-        OLOG(info, common) << "Executing topology generation script: " << topologyScript;
-        std::vector<std::pair<std::string, std::string>> extraEnv;
-        extraEnv.emplace_back(std::make_pair("ODC_TOPO_GEN_CMD", topologyScript));
-        execute(topologyScript, requestTimeout(common), &out, &err, &exitCode, extraEnv);
-
-        const size_t shortSize = 75;
-        string shortSuffix;
-        string shortOut = out.substr(0, shortSize);
-        if (out.length() > shortSize) {
-            shortSuffix = " [...]";
-        }
+        auto runScript = [&]() {
+            string out;
+            string err;
+            int exitCode = EXIT_SUCCESS;
+            OLOG(info, common) << "Executing topology generation script: " << topologyScript;
+            std::vector<std::pair<std::string, std::string>> extraEnv;
+            extraEnv.emplace_back(std::make_pair("ODC_TOPO_GEN_CMD", topologyScript));
+            execute(topologyScript, requestTimeout(common), &out, &err, &exitCode, extraEnv);
+
+            const size_t shortSize = 75;
+            string shortSuffix;
+            string shortOut = out.substr(0, shortSize);
+            if (out.length() > shortSize) {
+                shortSuffix = " [...]";
+            }
 
-        if (exitCode != EXIT_SUCCESS) {
-            logFatalLineByLine(common, toString("Topology generation script failed with exit code: ", exitCode, ", stderr:\n", quoted(err), ",\nstdout:\n", quoted(shortOut), shortSuffix));
-            throw runtime_error(toString("Topology generation script failed with exit code: ", exitCode, ", stderr: ", quoted(err)));
-        }
+            if (exitCode != EXIT_SUCCESS) {
+                logFatalLineByLine(common, toString("Topology generation script failed with exit code: ", exitCode, ", stderr:\n", quoted(err), ",\nstdout:\n", quoted(shortOut), shortSuffix));
+                throw runtime_error(toString("Topology generation script failed with exit code: ", exitCode, ", stderr: ", quoted(err)));
+            }
 
-        OLOG(info, common) << "Topology generation script successfull. stderr: " << quoted(err) << ", stdout: " << quoted(shortOut) << shortSuffix;
+            OLOG(info, common) << "Topology generation script successfull. stderr: " << quoted(err) << ", stdout: " << quoted(shortOut) << shortSuffix;
+            return out;
+        };
 
-        content = out;
+        if (mTopoScriptCache) {
+            bool hit = false;
+            content = mTopoScriptCache->get(topologyScript, runScript, hit);
+            const auto stats = mTopoScriptCache->getStats();
+            OLOG(info, common) << "Topology script cache " << (hit ? "hit" : "miss") << " for " << quoted(topologyScript)
+                               << " (hits: " << stats.hits << ", misses: " << stats.misses << ", evictions: " << stats.evictions << ")";
+        } else {
+            content = runScript();
+        }
     }
 
     // Create temp topology file with `content`
@@ -1434,6 +1935,16 @@ string Controller::topoFilepath(const CommonParams& common, const string& topolo
     return filepath.string();
 }
 
+void Controller::setTopoScriptCache(const string& dir, size_t maxEntries, const vector<string>& envVars, const vector<string>& inputs)
+{
+    if (dir.empty()) {
+        mTopoScriptCache.reset();
+        return;
+    }
+    mTopoScriptCache = make_unique<TopologyScriptCache>(dir, maxEntries, envVars, inputs);
+    OLOG(info) << "Caching the output of topology generation scripts in " << quoted(dir) << " (max. " << maxEntries << " entries)";
+}
+
 void Controller::registerResourcePlugins(const DDSSubmit::PluginMap& pluginMap)
 {
     for (const auto& v : pluginMap) {
@@ -1448,6 +1959,17 @@ void Controller::restore(const string& id, const string& dir)
 
     OLOG(info) << "Restoring sessions for " << quoted(id);
     auto data{ RestoreFile(id, dir).read() };
+    // idle sessions of the session pool before the restart, adopted first so that the restore file keeps them
+    if (!data.mPooledSessions.empty()) {
+        if (mSessionPool) {
+            OLOG(info) << "Handing " << data.mPooledSessions.size() << " pooled DDS sessions over to the session pool";
+            mSessionPool->adopt(data.mPooledSessions);
+        } else {
+            for (const auto& pooledID : data.mPooledSessions) {
+                DDSSessionPool::shutdownSession(pooledID);
+            }
+        }
+    }
     for (const auto& v : data.mPartitions) {
         OLOG(info, v.mPartitionID, 0) << "Restoring (" << quoted(v.mPartitionID) << "/" << quoted(v.mDDSSessionId) << ")";
         auto result{ execInitialize(CommonParams(v.mPartitionID, 0, 0), InitializeParams(v.mDDSSessionId)) };
@@ -1459,6 +1981,45 @@ void Controller::restore(const string& id, const string& dir)
     }
 }
 
+void Controller::setSessionPoolSize(size_t size)
+{
+    mSessionPool.reset();
+    if (size > 0) {
+        OLOG(info) << "Keeping " << size << " idle DDS sessions in the session pool";
+        DDSSessionPool::WarmUp warmUp;
+        if (!mAgentPool.empty()) {
+            warmUp = [this](const string& sessionID) { warmUpDDSSession(sessionID); };
+        }
+        mSessionPool = make_unique<DDSSessionPool>(size, move(warmUp), [this]() { updateRestore(); });
+    } else if (!mAgentPool.empty()) {
+        OLOG(warning) << "The agent pool is only used together with the session pool, ignoring it";
+    }
+}
+
+void Controller::setAgentPool(const vector<string>& groups)
+{
+    unordered_map<string, AgentGroupInfo> agentGroupInfo;
+    for (const auto& g : groups) {
+        vector<string> groupCfg;
+        boost::algorithm::split(groupCfg, g, boost::algorithm::is_any_of(":"));
+        if (groupCfg.size() != 4 && groupCfg.size() != 5) {
+            throw runtime_error(toString("Provided agent pool configuration has incorrect format. Expected <zone>:<agentGroup>:<numAgents>:<numSlots>[:<numCores>]. Received: ", g));
+        }
+        AgentGroupInfo agi;
+        agi.zone = groupCfg.at(0);
+        agi.name = groupCfg.at(1);
+        agi.numAgents = stoi(groupCfg.at(2));
+        agi.minAgents = 0;
+        agi.numSlots = stoi(groupCfg.at(3));
+        agi.numCores = groupCfg.size() == 5 ? stoi(groupCfg.at(4)) : 0;
+        agentGroupInfo[agi.name] = agi;
+    }
+    mAgentPool = mSubmit.makeParams(mRMS, mZoneCfgs, agentGroupInfo);
+    for (const auto& p : mAgentPool) {
+        OLOG(info) << "Agent pool: " << p;
+    }
+}
+
 void Controller::setZoneCfgs(const std::vector<std::string>& zonesStr)
 {
     for (const auto& z : zonesStr) {
@@ -1471,38 +2032,23 @@ void Controller::setZoneCfgs(const std::vector<std::string>& zonesStr)
     }
 }
 
-void Controller::printStateStats(const CommonParams& common, const TopoState& topoState)
+void Controller::printStateStats(const CommonParams& common, const TopoStateCounts& counts)
 {
-    std::map<DeviceState, uint64_t> taskStateCounts;
-    std::map<AggregatedState, uint64_t> collectionStateCounts;
-
-    for (const auto& ds : topoState) {
-        if (taskStateCounts.find(ds.state) == taskStateCounts.end()) {
-            taskStateCounts[ds.state] = 0;
-        }
-        taskStateCounts[ds.state]++;
-    }
-
-    auto collectionMap{ GroupByCollectionId(topoState) };
-    for (const auto& [collectionId, states] : collectionMap) {
-        AggregatedState collectionState = AggregateState(states);
-        if (collectionStateCounts.find(collectionState) == collectionStateCounts.end()) {
-            collectionStateCounts[collectionState] = 0;
-        }
-        collectionStateCounts[collectionState]++;
-    }
-
     stringstream ss;
     ss << "Device states:";
-    for (const auto& [state, count] : taskStateCounts) {
-        ss << " " << fair::mq::GetStateName(state) << " (" << count << "/" << topoState.size() << ")";
+    for (size_t i = 0; i < counts.tasks.size(); ++i) {
+        if (counts.tasks[i] > 0) {
+            ss << " " << fair::mq::GetStateName(static_cast<DeviceState>(i)) << " (" << counts.tasks[i] << "/" << counts.numTasks << ")";
+        }
     }
     OLOG(info, common) << ss.str();
     ss.str("");
     ss.clear();
     ss << "Collection states:";
-    for (const auto& [state, count] : collectionStateCounts) {
-        ss << " " << GetAggregatedStateName(state) << " (" << count << "/" << collectionMap.size() << ")";
+    for (size_t i = 0; i < counts.collections.size(); ++i) {
+        if (counts.collections[i] > 0) {
+            ss << " " << GetAggregatedStateName(static_cast<AggregatedState>(i)) << " (" << counts.collections[i] << "/" << counts.numCollections << ")";
+        }
     }
     OLOG(info, common) << ss.str();
 }
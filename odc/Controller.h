@@ -9,19 +9,33 @@
 #ifndef ODC_CORE_CONTROLLER
 #define ODC_CORE_CONTROLLER
 
+#include <odc/DDSSessionPool.h>
 #include <odc/DDSSubmit.h>
+#include <odc/MiscUtils.h>
 #include <odc/Params.h>
 #include <odc/Session.h>
 #include <odc/Topology.h>
+#include <odc/TopologyCache.h>
+#include <odc/TopologyScriptCache.h>
 
 #include <dds/Tools.h>
 #include <dds/Topology.h>
 
+#include <boost/asio/associated_executor.hpp>
+#include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 namespace odc::core
 {
@@ -30,6 +44,8 @@ class Controller
 {
   public:
     Controller() {}
+    /// \brief Cancels the in-flight asynchronous requests and waits for their completions
+    ~Controller();
     // Disable copy constructors and assignment operators
     Controller(const Controller&) = delete;
     Controller(Controller&&) = delete;
@@ -62,6 +78,38 @@ class Controller
     /// \param [in] rms name of the RMS
     void setRMS(const std::string& rms) { mRMS = rms; }
 
+    /// \brief Fail state change requests as soon as a non-ignorable device failure makes them impossible to succeed
+    /// \param [in] failFast if false (default), requests wait for all devices or for the timeout
+    void setFailFast(bool failFast) { mFailFast = failFast; }
+
+    /// \brief Complete state change requests once nMin collections of every collection with nMin reached the target state
+    /// \param [in] quorum if true, the remaining (straggling) collections are ignored as if they had failed
+    void setQuorum(bool quorum) { mQuorum = quorum; }
+
+    /// \brief Set the maximum number of agent submissions to the RMS that are in flight at the same time
+    /// \param [in] concurrency independent agent groups/zones are submitted concurrently up to this limit, 1 submits them one by one
+    void setSubmitConcurrency(size_t concurrency) { mSubmitConcurrency = std::max<size_t>(concurrency, 1); }
+
+    /// \brief Cache the output of topology generation scripts (disabled by default)
+    /// \param [in] dir cache directory, empty disables the cache
+    /// \param [in] maxEntries maximum number of cached outputs, least recently used ones are evicted
+    /// \param [in] envVars environment variables that influence the output of the scripts (part of the cache key)
+    /// \param [in] inputs files/directories read by the scripts, their size and modification time are part of the cache key
+    void setTopoScriptCache(const std::string& dir, size_t maxEntries, const std::vector<std::string>& envVars, const std::vector<std::string>& inputs);
+
+    /// \brief Start agents in every idle session of the session pool (see setSessionPoolSize()), disabled by default
+    ///  The agents are used by the Submit requests of the partition that takes the session, instead of submitting new
+    ///  ones. On Shutdown the session is given back to the pool (with its topology stopped) if it still has exactly
+    ///  these agents. Call after setRMS() and setZoneCfgs().
+    /// \param [in] groups agent groups in "<zone>:<agentGroup>:<numAgents>:<numSlots>[:<numCores>]" format
+    void setAgentPool(const std::vector<std::string>& groups);
+
+    /// \brief Keep a number of pre-created idle DDS sessions for new partitions (disabled by default)
+    ///  The pool refills in the background, Initialize/Run wait for a session still being prepared up to half of the
+    ///  request timeout. Call before restore(), which hands the sessions pooled before a restart to the pool.
+    /// \param [in] size number of idle sessions, 0 disables the pool
+    void setSessionPoolSize(size_t size);
+
     // DDS topology and session requests
 
     /// \brief Initialize DDS session
@@ -98,10 +146,54 @@ class Controller
     /// \brief Status request
     StatusRequestResult execStatus(const StatusParams& params);
 
+    // asynchronous change state requests
+    //  The requests return right after the transitions are sent to the devices. The completion token is invoked with the
+    //  RequestResult once the devices reached the target state (or failed), without a thread waiting in the meantime.
+    //  As for the blocking requests, requests for the same partition must not overlap. A Shutdown of the partition
+    //  cancels them and waits for their completions. Exceptions thrown by the completion handler are logged and dropped.
+    //  Only the state changes are asynchronous: Initialize, Submit, Activate, Run, Update and Shutdown wait for DDS
+    //  (session, agent submission, activation) and are blocking only, as are the requests of the gRPC service.
+
+    /// \brief Configure devices: InitDevice->CompleteInit->Bind->Connect->InitTask
+    template<typename CompletionToken>
+    auto asyncExecConfigure(const CommonParams& common, const DeviceParams& params, CompletionToken&& token)
+    {
+        return initiateRequest(&Controller::startConfigure, common, params, std::forward<CompletionToken>(token));
+    }
+    /// \brief Start devices: Run
+    template<typename CompletionToken>
+    auto asyncExecStart(const CommonParams& common, const DeviceParams& params, CompletionToken&& token)
+    {
+        return initiateRequest(&Controller::startStart, common, params, std::forward<CompletionToken>(token));
+    }
+    /// \brief Stop devices: Stop
+    template<typename CompletionToken>
+    auto asyncExecStop(const CommonParams& common, const DeviceParams& params, CompletionToken&& token)
+    {
+        return initiateRequest(&Controller::startStop, common, params, std::forward<CompletionToken>(token));
+    }
+    /// \brief Reset devices: ResetTask->ResetDevice
+    template<typename CompletionToken>
+    auto asyncExecReset(const CommonParams& common, const DeviceParams& params, CompletionToken&& token)
+    {
+        return initiateRequest(&Controller::startReset, common, params, std::forward<CompletionToken>(token));
+    }
+    /// \brief Terminate devices: End
+    template<typename CompletionToken>
+    auto asyncExecTerminate(const CommonParams& common, const DeviceParams& params, CompletionToken&& token)
+    {
+        return initiateRequest(&Controller::startTerminate, common, params, std::forward<CompletionToken>(token));
+    }
+
+    /// \brief Parse the topology file of the session and fill the session with its requirements (bypasses the topology cache)
     static void extractRequirements(const CommonParams& common, Session& session);
 
   private:
-    std::map<std::string, std::unique_ptr<Session>> mSessions; ///< Map of partition ID to session info
+    using RequestHandler = std::function<void(RequestResult)>;
+    using ChangeStateHandler = std::function<void(Error, TopologyState)>;
+
+    RequestIdGenerator mRequestIds;                            ///< ids of the topology operations, outlives the sessions
+    std::map<std::string, std::shared_ptr<Session>> mSessions; ///< Map of partition ID to session info, shared with in-flight asynchronous requests
     std::mutex mSessionsMtx;                                   ///< Mutex of sessions map
     std::chrono::seconds mTimeout{ 30 };                       ///< Request timeout in sec
     DDSSubmit mSubmit;                                         ///< ODC to DDS submit resource converter
@@ -110,6 +202,18 @@ class Controller
     std::string mHistoryDir;                                   ///< History file directory
     std::map<std::string, ZoneConfig> mZoneCfgs;               ///< stores zones configuration (cfgFilePath/envFilePath) by zone name
     std::string mRMS{ "localhost" };                           ///< resource management system to be used by DDS
+    bool mFailFast{ false };                                   ///< fail-fast policy for state change requests
+    bool mQuorum{ false };                                     ///< quorum completion of state change requests
+    size_t mSubmitConcurrency{ 4 };                            ///< max. number of concurrent agent submissions
+    TopologyCache mTopoCache;                                  ///< parsed topologies by file content
+    std::unique_ptr<TopologyScriptCache> mTopoScriptCache;     ///< output of topology generation scripts, opt-in
+    boost::asio::thread_pool mAsyncPool{ 2 };                  ///< runs the completions of asynchronous requests, joined in the dtor
+    std::mutex mAsyncMtx;                                      ///< Mutex of the in-flight asynchronous state changes
+    std::condition_variable mAsyncCv;                          ///< signaled when an asynchronous state change completed
+    size_t mNumAsyncChangeStates{ 0 };                         ///< in-flight asynchronous state changes
+    bool mShuttingDown{ false };                               ///< set by the dtor, no further asynchronous state changes are started
+    std::vector<DDSSubmitParams> mAgentPool;                   ///< agents started in every pooled session, opt-in
+    std::unique_ptr<DDSSessionPool> mSessionPool;              ///< idle DDS sessions, opt-in; declared last, its refills update the restore file
 
     void updateRestore();
     void updateHistory(const CommonParams& common, const std::string& sessionId);
@@ -117,22 +221,52 @@ class Controller
     std::unordered_set<std::string> submit(const CommonParams& common, Session& session, Error& error, const std::string& plugin, const std::string& res, bool extractResources);
     void activate(const CommonParams& common, Session& session, Error& error);
 
+    /// @brief Fill the session with the requirements of its topology file, parsed via the topology cache
+    ParsedTopologyPtr loadTopology(const CommonParams& common, Session& session);
+    /// @brief Parse the topology file via the topology cache, without touching a session
+    ParsedTopologyPtr parseTopology(const CommonParams& common, const std::string& topoFilePath);
+    static void extractRequirements(const CommonParams& common, dds::topology_api::CTopology& ddsTopo, TopologyRequirements& reqs);
+    static void applyRequirements(Session& session, const TopologyRequirements& reqs);
+    static void logRequirements(const CommonParams& common, const Session& session);
+
     bool createDDSSession(           const CommonParams& common, Session& session, Error& error);
+    /// @brief Start the agents of the agent pool in a new pooled session, throws on failure
+    void warmUpDDSSession(const std::string& sessionID);
+    /// @brief Use the agents of the agent pool running in the session for the given submissions, reducing their number of agents
+    void assignWarmAgents(const CommonParams& common, Session& session, std::vector<DDSSubmitParams>& params);
+    /// @brief Stop the topology and give the session back to the session pool, if it runs exactly the agents of the agent pool
+    bool reclaimDDSSession(const CommonParams& common, Session& session);
     bool attachToDDSSession(         const CommonParams& common, Session& session, Error& error, const std::string& sessionID);
     bool shutdownDDSSession(         const CommonParams& common, Session& session, Error& error);
     std::string getActiveDDSTopology(const CommonParams& common, Session& session, Error& error);
 
-    bool submitDDSAgents(      const CommonParams& common, Session& session, Error& error, const DDSSubmitParams& params);
+    /// @brief Submit the agent groups concurrently (up to mSubmitConcurrency at a time) and wait for all submissions
+    /// @param numSlots incremented by the slots of every successful submission
+    bool submitDDSAgents(      const CommonParams& common, Session& session, Error& error, const std::vector<DDSSubmitParams>& params, size_t& numSlots);
     bool waitForNumActiveSlots(const CommonParams& common, Session& session, Error& error, size_t numSlots);
+    /// @brief Wait until the number of active DDS slots fulfils `reached`, or until the request timeout
+    bool waitForNumSlots(const CommonParams& common, Session& session, const std::function<bool(uint32_t)>& reached, uint32_t& currentSlots);
     void ShutdownDDSAgent(     const CommonParams& common, Session& session, uint64_t agentID);
 
     bool activateDDSTopology(const CommonParams& common, Session& session, Error& error, dds::tools_api::STopologyRequest::request_t::EUpdateType updateType);
     bool createDDSTopology(  const CommonParams& common, Session& session, Error& error);
 
-    bool createTopology(const CommonParams& common, Session& session, Error& error);
+    /// @param subscribeOnActivation create the topology before activating it, see BasicTopology
+    bool createTopology(const CommonParams& common, Session& session, Error& error, bool subscribeOnActivation = false);
     bool resetTopology(Session& session);
+    /// @brief Update the running topology to session.mTopoFilePath: reset all devices, activate the update and configure all devices
+    bool updateTopology(const CommonParams& common, Session& session, Error& error, TopologyState& topologyState);
+    /// @brief Update the running topology to the DDS topology in place: reset only the removed devices, activate the
+    /// update and configure only the added devices, the other devices keep their state
+    /// Kept devices do not connect again, so if they read channel properties of added tasks (see
+    /// Topology::ReconnectsToAdded()), the whole topology is updated with updateTopology() instead.
+    bool updateTopologyInPlace(const CommonParams& common, Session& session, Error& error, std::shared_ptr<dds::topology_api::CTopology> ddsTopo, TopologyState& topologyState);
 
     bool changeState(         const CommonParams& common, Session& session, Error& error, const std::string& path, TopoTransition transition, TopologyState& topologyState);
+    bool changeState(         const CommonParams& common, Session& session, Error& error, const std::string& path, const std::vector<TopoTransition>& transitions, TopologyState& topologyState);
+    void asyncChangeState(    const CommonParams& common, std::shared_ptr<Session> session, const std::string& path, const std::vector<TopoTransition>& transitions, TopologyState topologyState, ChangeStateHandler done);
+    bool prepareChangeState(  const CommonParams& common, Session& session, Error& error, const std::string& path, const std::vector<TopoTransition>& transitions, std::string& transition, DeviceState& expState);
+    bool completeChangeState( const CommonParams& common, Session& session, Error& error, const std::string& transition, DeviceState expState, std::error_code errorCode, TopoStateSnapshotPtr snapshot, TopologyState& topologyState);
     bool changeStateConfigure(const CommonParams& common, Session& session, Error& error, const std::string& path, TopologyState& topologyState);
     bool changeStateReset(    const CommonParams& common, Session& session, Error& error, const std::string& path, TopologyState& topologyState);
     bool waitForState(        const CommonParams& common, Session& session, Error& error, const std::string& path, DeviceState expState);
@@ -145,9 +279,12 @@ class Controller
     void logFatalLineByLine(            const CommonParams& common, const std::string& msg);
 
     RequestResult createRequestResult(const CommonParams& common, const Session& session, const Error& error, const std::string& msg, size_t execTime, TopologyState&& topologyState);
-    AggregatedState aggregateStateForPath(const dds::topology_api::CTopology* ddsTopo, const TopoState& topoState, const std::string& path);
+    AggregatedState aggregateStateForPath(const Topology& topo, const TopoState& topoState, const std::string& path);
 
     Session& acquireSession(const CommonParams& common);
+    std::shared_ptr<Session> acquireSessionPtr(const CommonParams& common);
+    /// @brief Cancel the asynchronous state changes of the session and wait for their completions, refuse new ones
+    void cancelChangeStates(const CommonParams& common, Session& session);
     void removeSession(const CommonParams& common);
 
     void stateSummaryOnFailure(const CommonParams& common, Session& session, const TopoState& topoState, DeviceState expectedState);
@@ -171,7 +308,47 @@ class Controller
     uint32_t getNumSlots(const CommonParams& common, Session& session) const;
     dds::tools_api::SAgentInfoRequest::responseVector_t getAgentInfo(const CommonParams& common, Session& session) const;
 
-    void printStateStats(const CommonParams& common, const TopoState& topoState);
+    void printStateStats(const CommonParams& common, const TopoStateCounts& counts);
+
+    /// Configure is sent as one sequence: each device advances on its own, connecting as soon as its peers have bound,
+    /// instead of all devices waiting for the slowest one after every transition
+    static std::vector<TopoTransition> configureTransitions()
+    {
+        return { TopoTransition::InitDevice, TopoTransition::CompleteInit, TopoTransition::Bind, TopoTransition::Connect, TopoTransition::InitTask };
+    }
+
+    void startConfigure(const CommonParams& common, const DeviceParams& params, RequestHandler handler);
+    void startStart(    const CommonParams& common, const DeviceParams& params, RequestHandler handler);
+    void startStop(     const CommonParams& common, const DeviceParams& params, RequestHandler handler);
+    void startReset(    const CommonParams& common, const DeviceParams& params, RequestHandler handler);
+    void startTerminate(const CommonParams& common, const DeviceParams& params, RequestHandler handler);
+
+    /// \brief Run an asynchronous request and block until it completes
+    RequestResult waitForRequest(const std::function<void(RequestHandler)>& start);
+
+    template<typename CompletionToken>
+    auto initiateRequest(void (Controller::*start)(const CommonParams&, const DeviceParams&, RequestHandler), const CommonParams& common, const DeviceParams& params, CompletionToken&& token)
+    {
+        return boost::asio::async_initiate<CompletionToken, void(RequestResult)>(
+            [this, start, common, params](auto handler) {
+                // RequestHandler is copyable, the asio handler is not necessarily
+                auto h = std::make_shared<decltype(handler)>(std::move(handler));
+                (this->*start)(common, params, [h, partitionID = common.mPartitionID](RequestResult result) {
+                    auto ex = boost::asio::get_associated_executor(*h);
+                    boost::asio::dispatch(ex, [h, partitionID, result = std::move(result)]() mutable {
+                        // must not escape onto the thread pool that runs the completions
+                        try {
+                            (*h)(std::move(result));
+                        } catch (std::exception& e) {
+                            OLOG(error, partitionID, 0) << "Exception in the completion handler of an asynchronous request: " << e.what();
+                        } catch (...) {
+                            OLOG(error, partitionID, 0) << "Unknown exception in the completion handler of an asynchronous request";
+                        }
+                    });
+                });
+            },
+            token);
+    }
 };
 
 } // namespace odc::core
@@ -0,0 +1,274 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_CORE_DDSSESSIONPOOL
+#define ODC_CORE_DDSSESSIONPOOL
+
+#include <odc/Logger.h>
+
+#include <dds/Tools.h>
+
+#include <boost/uuid/uuid_io.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace odc::core
+{
+
+/**
+ * @brief Pool of pre-created, idle DDS sessions
+ *
+ * Starting a DDS commander is a noticeable part of every Initialize/Run. The pool keeps the given number of idle
+ * sessions running and refills itself in the background whenever a session is taken. Pooled sessions are detached,
+ * the partition that takes one attaches to it by id and owns it from then on (including its shutdown), unless it
+ * gives the session back. Idle sessions are shut down when the pool is destroyed.
+ *
+ * An optional warm-up runs for every new session before it becomes available, e.g. to start agents in it. Sessions given
+ * back are always kept, idle sessions beyond the pool size are shut down in the background.
+ */
+class DDSSessionPool
+{
+  public:
+    /// Called (without the pool locked) whenever the set of pooled sessions changed, e.g. to update the restore file
+    using Listener = std::function<void()>;
+    /// Prepares a new (detached) session given by its id, throws on failure (the session is then shut down)
+    using WarmUp = std::function<void(const std::string& id)>;
+
+    /// @param size number of idle sessions to keep
+    /// @param warmUp runs for every new session, may be empty
+    DDSSessionPool(size_t size, WarmUp warmUp, Listener onChange)
+        : mSize(size)
+        , mWarmUp(std::move(warmUp))
+        , mOnChange(std::move(onChange))
+        , mWorker([this]() { run(); })
+    {}
+
+    DDSSessionPool(const DDSSessionPool&) = delete;
+    DDSSessionPool& operator=(const DDSSessionPool&) = delete;
+
+    ~DDSSessionPool()
+    {
+        {
+            std::lock_guard<std::mutex> lk(mMtx);
+            mStop = true;
+        }
+        mCv.notify_all();
+        mWorker.join();
+        for (const auto& id : mIdle) {
+            shutdownSession(id);
+        }
+        for (const auto& id : mAdopted) {
+            shutdownSession(id);
+        }
+    }
+
+    /// @brief Take an idle session, the pool starts a replacement in the background
+    /// @param maxWait if the pool is empty, wait up to this long for a session that is being prepared
+    /// @return id of the session, none if the pool is empty
+    std::optional<std::string> take(std::chrono::milliseconds maxWait = std::chrono::milliseconds(0))
+    {
+        std::optional<std::string> id;
+        {
+            std::unique_lock<std::mutex> lk(mMtx);
+            // a session being prepared is usually ready sooner than a new one, unless creating them fails
+            mCv.wait_for(lk, maxWait, [&]() { return !mIdle.empty() || mStop || mBackoff; });
+            if (mIdle.empty()) {
+                return std::nullopt;
+            }
+            id = std::move(mIdle.front());
+            mIdle.pop_front();
+        }
+        mCv.notify_all();
+        if (mOnChange) {
+            mOnChange();
+        }
+        return id;
+    }
+
+    /// @brief Return a (detached) session that is in the same condition as a warmed up one
+    /// If the pool is full, the oldest idle session is shut down in the background instead of this one.
+    /// @return false if the pool is being destroyed, the caller keeps the session then
+    bool giveBack(const std::string& id)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mMtx);
+            if (mStop) {
+                return false;
+            }
+            mIdle.push_back(id);
+        }
+        mCv.notify_all();
+        if (mOnChange) {
+            mOnChange();
+        }
+        return true;
+    }
+
+    /// @brief Take over sessions pooled by a previous controller (see Controller::restore())
+    /// Sessions that are still running are kept as far as the pool size allows, the other ones are shut down. With a
+    /// warm-up all of them are shut down, since their condition is unknown.
+    void adopt(const std::vector<std::string>& ids)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mMtx);
+            mAdopted.insert(mAdopted.end(), ids.begin(), ids.end());
+        }
+        mCv.notify_all();
+    }
+
+    /// @brief Ids of the pooled sessions, including adopted ones that are not checked yet
+    std::vector<std::string> ids() const
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        std::vector<std::string> ids(mIdle.begin(), mIdle.end());
+        ids.insert(ids.end(), mAdopted.begin(), mAdopted.end());
+        return ids;
+    }
+
+    /// @brief Number of idle sessions ready to be taken
+    size_t numIdle() const
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        return mIdle.size();
+    }
+
+    /// @brief Attach to a session and shut it down, errors are logged
+    static void shutdownSession(const std::string& id)
+    {
+        try {
+            dds::tools_api::CSession session;
+            session.attach(id);
+            session.shutdown();
+            OLOG(info) << "Pooled DDS session " << id << " has been shut down";
+        } catch (const std::exception& e) {
+            OLOG(warning) << "Failed to shut down pooled DDS session " << id << ": " << e.what();
+        }
+    }
+
+  private:
+    size_t mSize;
+    WarmUp mWarmUp;
+    Listener mOnChange;
+    mutable std::mutex mMtx;
+    std::condition_variable mCv;
+    std::deque<std::string> mIdle;     ///< running sessions, ready to be taken
+    std::vector<std::string> mAdopted; ///< sessions of a previous controller, to be checked by the worker
+    size_t mNumCreating = 0;           ///< sessions being created or warmed up by the worker
+    bool mBackoff = false;             ///< creating a session failed, the worker waits before the next attempt
+    bool mStop = false;
+    std::thread mWorker; ///< declared last: starts after all other members are initialized
+
+    static bool isRunning(const std::string& id)
+    {
+        try {
+            dds::tools_api::CSession session;
+            session.attach(id);
+            const bool running = session.IsRunning();
+            session.detach();
+            return running;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    /// @return id of the new (warmed up) session, empty on failure
+    std::string create()
+    {
+        std::string id;
+        try {
+            dds::tools_api::CSession session;
+            id = boost::uuids::to_string(session.create());
+            session.detach();
+            OLOG(info) << "Created pooled DDS session " << id;
+        } catch (const std::exception& e) {
+            OLOG(error) << "Failed to create a pooled DDS session: " << e.what();
+            return std::string();
+        }
+        if (mWarmUp) {
+            try {
+                mWarmUp(id);
+            } catch (const std::exception& e) {
+                OLOG(error) << "Failed to warm up pooled DDS session " << id << ": " << e.what();
+                shutdownSession(id);
+                return std::string();
+            }
+        }
+        return id;
+    }
+
+    void run()
+    {
+        using namespace std::chrono_literals;
+        std::unique_lock<std::mutex> lk(mMtx);
+        while (true) {
+            mCv.wait(lk, [&]() { return mStop || !mAdopted.empty() || mIdle.size() != mSize; });
+            if (mStop) {
+                return;
+            }
+
+            if (!mAdopted.empty()) {
+                // adopt() may add sessions while the lock is released
+                const std::string id = std::move(mAdopted.back());
+                mAdopted.pop_back();
+                lk.unlock();
+                const bool running = isRunning(id);
+                lk.lock();
+                if (running && !mWarmUp && mIdle.size() < mSize) {
+                    OLOG(info) << "Adopted pooled DDS session " << id;
+                    mIdle.push_back(id);
+                } else if (running) {
+                    lk.unlock();
+                    shutdownSession(id);
+                    lk.lock();
+                }
+            } else if (mIdle.size() > mSize) {
+                // given back while the pool was full
+                const std::string id = std::move(mIdle.front());
+                mIdle.pop_front();
+                lk.unlock();
+                shutdownSession(id);
+                lk.lock();
+            } else {
+                ++mNumCreating;
+                lk.unlock();
+                std::string id = create();
+                lk.lock();
+                --mNumCreating;
+                if (id.empty()) {
+                    // do not hammer a failing DDS installation
+                    mBackoff = true;
+                    mCv.notify_all();
+                    mCv.wait_for(lk, 10s, [&]() { return mStop; });
+                    mBackoff = false;
+                    continue;
+                }
+                mIdle.push_back(id);
+            }
+
+            mCv.notify_all();
+            lk.unlock();
+            if (mOnChange) {
+                mOnChange();
+            }
+            lk.lock();
+        }
+    }
+};
+
+} // namespace odc::core
+
+#endif /* ODC_CORE_DDSSESSIONPOOL */
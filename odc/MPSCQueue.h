@@ -0,0 +1,125 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_MPSCQUEUE
+#define ODC_MPSCQUEUE
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace odc::core
+{
+
+/**
+ * @brief Unbounded multi-producer single-consumer queue
+ *
+ * Push() is lock-free and may be called from any number of threads. TryPop() must only be called by one thread at a
+ * time. Node based (D. Vyukov's intrusive MPSC queue with a stub node): a push is one allocation plus one atomic
+ * exchange.
+ *
+ * TryPop() may return false for a short moment while a producer is between its exchange and linking its node, even
+ * though Size() already counts the element. Consumers that rely on Size() must retry in that case.
+ */
+template<typename T>
+class MPSCQueue
+{
+  public:
+    MPSCQueue()
+        : mHead(&mStub)
+        , mTail(&mStub)
+    {}
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    ~MPSCQueue()
+    {
+        T item;
+        while (TryPop(item)) {
+        }
+    }
+
+    void Push(T item)
+    {
+        Node* node = new Node(std::move(item));
+        mSize.fetch_add(1);
+        Link(node);
+    }
+
+    /// @brief Pop the oldest element, single consumer only
+    /// @return false if the queue is (momentarily) empty
+    bool TryPop(T& item)
+    {
+        Node* tail = mTail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &mStub) {
+            if (next == nullptr) {
+                return false;
+            }
+            mTail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next != nullptr) {
+            Pop(tail, next, item);
+            return true;
+        }
+        if (tail != mHead.load(std::memory_order_acquire)) {
+            // a producer is in the middle of a push
+            return false;
+        }
+        // tail is the last element, put the stub behind it so that it can be released
+        Link(&mStub);
+        next = tail->next.load(std::memory_order_acquire);
+        if (next != nullptr) {
+            Pop(tail, next, item);
+            return true;
+        }
+        return false;
+    }
+
+    /// @brief Number of pushed but not yet popped elements
+    size_t Size() const { return mSize.load(); }
+
+  private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T&& v)
+            : value(std::move(v))
+        {}
+
+        std::atomic<Node*> next{ nullptr };
+        T value;
+    };
+
+    std::atomic<Node*> mHead; ///< last pushed node, written by producers
+    Node* mTail;              ///< next node to pop, consumer only
+    Node mStub;
+    std::atomic<size_t> mSize{ 0 };
+
+    void Link(Node* node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = mHead.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    void Pop(Node* tail, Node* next, T& item)
+    {
+        mTail = next;
+        item = std::move(tail->value);
+        mSize.fetch_sub(1);
+        delete tail;
+    }
+};
+
+} // namespace odc::core
+
+#endif /* ODC_MPSCQUEUE */
@@ -20,6 +20,8 @@
 #include <stdlib.h>
 #include <sys/types.h>
 
+#include <atomic>
+#include <cstdint>
 #include <ctime>
 #include <initializer_list>
 #include <iomanip>
@@ -58,6 +60,43 @@ inline std::size_t uuidHash()
     return uuid_hasher(u);
 }
 
+/**
+ * @brief Lock-free generator of request ids
+ *
+ * The upper 24 bits hold an epoch drawn at random once per generator, the lower 40 bits a monotonic counter. Ids of
+ * different generators (e.g. of a restarted controller attached to the same session) differ in the epoch, so late
+ * device replies to requests of another generator do not match. Generating an id is a single relaxed atomic increment.
+ */
+class RequestIdGenerator
+{
+  public:
+    RequestIdGenerator()
+        : mEpoch((static_cast<uint64_t>(uuidHash()) & kEpochMask) << kCounterBits)
+    {}
+
+    RequestIdGenerator(const RequestIdGenerator&) = delete;
+    RequestIdGenerator& operator=(const RequestIdGenerator&) = delete;
+
+    uint64_t Next() { return mEpoch | ((mCounter.fetch_add(1, std::memory_order_relaxed) + 1) & kCounterMask); }
+
+    uint64_t GetEpoch() const { return mEpoch >> kCounterBits; }
+
+    /// @brief Generator shared by everything in this process that has no generator of its own
+    static RequestIdGenerator& Default()
+    {
+        static RequestIdGenerator generator;
+        return generator;
+    }
+
+  private:
+    static constexpr unsigned int kCounterBits = 40;
+    static constexpr uint64_t kCounterMask = (uint64_t(1) << kCounterBits) - 1;
+    static constexpr uint64_t kEpochMask = (uint64_t(1) << (64 - kCounterBits)) - 1;
+
+    const uint64_t mEpoch;
+    std::atomic<uint64_t> mCounter{ 0 };
+};
+
 inline bool strStartsWith(std::string const& str, std::string const& start)
 {
     if (str.length() >= start.length()) {
@@ -16,6 +16,7 @@
 
 #include <filesystem>
 #include <string>
+#include <vector>
 
 namespace odc::core {
 
@@ -58,6 +59,11 @@ struct RestoreData
         }
         boost::property_tree::ptree pt;
         pt.add_child("sessions", children);
+        boost::property_tree::ptree pool;
+        for (const auto& id : mPooledSessions) {
+            pool.push_back(make_pair("", boost::property_tree::ptree(id)));
+        }
+        pt.add_child("pool", pool);
         return pt;
     }
     void fromPT(const boost::property_tree::ptree& _pt)
@@ -68,9 +74,16 @@ struct RestoreData
                 mPartitions.push_back(RestorePartition(v.second));
             }
         }
+        auto pool{ _pt.get_child_optional("pool") };
+        if (pool) {
+            for (const auto& v : pool.get()) {
+                mPooledSessions.push_back(v.second.get_value<std::string>());
+            }
+        }
     }
 
     std::vector<RestorePartition> mPartitions;
+    std::vector<std::string> mPooledSessions; ///< idle sessions of the DDS session pool
 };
 
 class RestoreFile
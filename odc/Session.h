@@ -9,6 +9,7 @@
 #ifndef ODC_CORE_SESSION
 #define ODC_CORE_SESSION
 
+#include <odc/DDSSubmit.h>
 #include <odc/Topology.h>
 
 #include <dds/Tools.h>
@@ -16,15 +17,52 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace odc::core
 {
 
+/// Events that may change the number of DDS agents/slots of a session (submission done, agent shutdown, ...)
+/// Shared with the DDS callbacks, which may arrive after the request that registered them timed out.
+struct AgentEvents
+{
+    void notify()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            ++mNum;
+        }
+        mCV.notify_all();
+    }
+
+    uint64_t num()
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        return mNum;
+    }
+
+    /// @brief Wait until more than `seen` events have been signalled, or until the deadline
+    /// @return number of events signalled so far
+    uint64_t wait(uint64_t seen, std::chrono::steady_clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(mMtx);
+        mCV.wait_until(lock, deadline, [&]() { return mNum != seen; });
+        return mNum;
+    }
+
+  private:
+    std::mutex mMtx;
+    std::condition_variable mCV;
+    uint64_t mNum = 0;
+};
+
 struct Session
 {
     void addTaskDetails(TaskDetails&& taskDetails)
@@ -117,7 +155,20 @@ struct Session
         return mCollectionDetails.size();
     }
 
-    std::unique_ptr<dds::topology_api::CTopology> mDDSTopo = nullptr; ///< DDS topology
+    /// @brief Signal an event that may change the number of DDS agents/slots, see AgentEvents
+    void notifyAgentEvent() { mAgentEvents->notify(); }
+
+    /// @brief Number of agent events signalled so far
+    uint64_t numAgentEvents() { return mAgentEvents->num(); }
+
+    /// @brief Wait until more than `seen` agent events have been signalled, or until the deadline
+    /// @return number of agent events signalled so far
+    uint64_t waitForAgentEvent(uint64_t seen, std::chrono::steady_clock::time_point deadline) { return mAgentEvents->wait(seen, deadline); }
+
+    /// @brief Agent events of this session, for DDS callbacks that may outlive the session
+    std::shared_ptr<AgentEvents> agentEvents() const { return mAgentEvents; }
+
+    std::shared_ptr<dds::topology_api::CTopology> mDDSTopo = nullptr; ///< DDS topology, shared with the topology cache
     dds::tools_api::CSession mDDSSession; ///< DDS session
     std::unique_ptr<Topology> mTopology = nullptr; ///< Topology
     std::string mPartitionID; ///< External partition ID of this DDS session
@@ -130,15 +181,20 @@ struct Session
     std::unordered_set<uint64_t> mExpendableTasks; ///< List of expandable task IDs
     size_t mTotalSlots = 0; ///< total number of DDS slots
     std::unordered_map<uint64_t, uint32_t> mAgentSlots;
+    std::vector<DDSSubmitParams> mWarmAgents; ///< agents of the agent pool running in the session, not yet assigned by a Submit
+    size_t mNumPoolAgentsUsed = 0;            ///< agents of the agent pool assigned by Submit requests
     bool mRunAttempted = false;
     dds::tools_api::SOnTaskDoneRequest::ptr_t mDDSOnTaskDoneRequest;
     std::atomic<uint64_t> mLastRunNr = 0;
+    size_t mNumAsyncChangeStates = 0; ///< in-flight asynchronous state changes, guarded by Controller::mAsyncMtx
+    bool mClosing = false; ///< set by Shutdown, no further asynchronous state changes are started, guarded by Controller::mAsyncMtx
 
     private:
     std::mutex mDetailsMtx; ///< Mutex for the tasks/collections container
     std::unordered_map<uint64_t, TaskDetails> mTaskDetails; ///< Additional information about task
     std::unordered_map<uint64_t, CollectionDetails> mCollectionDetails; ///< Additional information about collection
     std::unordered_map<uint64_t, AgentDetails> mAgentDetails; ///< Additional information about agent
+    std::shared_ptr<AgentEvents> mAgentEvents = std::make_shared<AgentEvents>(); ///< see notifyAgentEvent()
 };
 
 } // namespace odc::core
@@ -12,34 +12,49 @@
 #include <odc/AsioAsyncOp.h>
 #include <odc/AsioBase.h>
 #include <odc/Error.h>
+#include <odc/MPSCQueue.h>
 #include <odc/MiscUtils.h>
 #include <odc/Semaphore.h>
+#include <odc/TopologyAllocator.h>
 #include <odc/TopologyDefs.h>
 #include <odc/TopologyOpChangeState.h>
 #include <odc/TopologyOpGetProperties.h>
 #include <odc/TopologyOpSetProperties.h>
 #include <odc/TopologyOpWaitForState.h>
+#include <odc/TopologyPathIndex.h>
+#include <odc/TopologyStateStore.h>
+#include <odc/TopologyTimerWheel.h>
+#include <odc/TopologyWatch.h>
 
 #include <boost/asio/associated_executor.hpp>
 #include <boost/asio/async_result.hpp>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
 #include <boost/asio/system_executor.hpp>
 
 #include <dds/Tools.h>
 #include <dds/Topology.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <ostream>
 #include <stdexcept>
 #include <string>
 #include <sstream>
 #include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -48,15 +63,79 @@
 namespace odc::core
 {
 
+/**
+ * @brief Completion handler of a topology operation that posts the wrapped handler to its executor
+ *
+ * In strand mode the strand is the default executor of the completion handlers, so dispatching them from the state
+ * update (or timer) that completes an operation would run them inline, while the topology is still fanning out the
+ * update over its in-flight operations. A handler that starts a new operation would then reap and link operations in
+ * the middle of that loop. Posting the handler defers it until the current strand handler has finished.
+ */
+template<typename Handler, typename Executor>
+struct TopoDeferredHandler
+{
+    Handler handler;
+    Executor ex; ///< associated executor of the wrapped handler
+    bool defer;  ///< post the handler, otherwise call it directly (the operation dispatched to ex already)
+
+    template<typename... Args>
+    void operator()(Args&&... args)
+    {
+        if (!defer) {
+            handler(std::forward<Args>(args)...);
+            return;
+        }
+        boost::asio::post(ex, [h = std::move(handler), argsTuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            std::apply([&](auto&... a) { h(std::move(a)...); }, argsTuple);
+        });
+    }
+};
+
+} // namespace odc::core
+
+namespace boost::asio
+{
+
+template<typename Handler, typename Executor, typename Executor1>
+struct associated_executor<odc::core::TopoDeferredHandler<Handler, Executor>, Executor1>
+{
+    using type = Executor;
+    static type get(const odc::core::TopoDeferredHandler<Handler, Executor>& h, const Executor1& = Executor1()) noexcept { return h.ex; }
+};
+
+template<typename Handler, typename Executor, typename Allocator1>
+struct associated_allocator<odc::core::TopoDeferredHandler<Handler, Executor>, Allocator1>
+{
+    using type = associated_allocator_t<Handler, Allocator1>;
+    static type get(const odc::core::TopoDeferredHandler<Handler, Executor>& h, const Allocator1& a = Allocator1()) noexcept
+    {
+        return associated_allocator<Handler, Allocator1>::get(h.handler, a);
+    }
+};
+
+} // namespace boost::asio
+
+namespace odc::core
+{
+
 /**
  * @class BasicTopology
  * @tparam Executor Associated I/O executor
- * @tparam Allocator Associated default allocator
+ * @tparam Allocator Associated default allocator, used for the in-flight operations (see TopoPoolAllocator)
  * @brief Represents a FairMQ topology
  *
  * @par Thread Safety
  * @e Distinct @e objects: Safe.@n
  * @e Shared @e objects: Safe.
+ *
+ * @par Serialization
+ * With TopoSerialization::Mutex (default) the topology state is guarded by a mutex, taken by DDS callbacks, operation
+ * initiations, operation timers and state queries. With TopoSerialization::Strand all of them run on a strand of the
+ * associated executor instead and no lock is taken: DDS callbacks and initiations are dispatched to the strand,
+ * operation timers run on it, completion handlers (without an associated executor of their own) are posted to it, and
+ * synchronous state queries from other threads wait for the strand. Strand serialization needs a type-erased Executor (such as
+ * DefaultExecutor) to run the operations on the strand. Synchronous calls that wait for an operation (e.g.
+ * ChangeState()) must not be made from a completion handler running on the strand.
  */
 template<typename Executor, typename Allocator>
 class BasicTopology : public AsioBase<Executor, Allocator>
@@ -66,14 +145,17 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     /// @param topo CTopology
     /// @param session CSession
     /// @param blockUntilConnected if true, ctor will wait for all tasks to confirm subscriptions
+    /// @param subscribeOnActivation see the executor overload
     BasicTopology(dds::topology_api::CTopology& topo,
                   dds::tools_api::CSession& session,
                   const std::unordered_set<uint64_t>& expendableTasks,
                   std::map<std::string, odc::core::CollectionInfo>& collectionInfo,
                   const std::string& partitionId,
                   std::atomic<uint64_t>& lastRunNr,
-                  bool blockUntilConnected = false)
-        : BasicTopology<Executor, Allocator>(boost::asio::system_executor(), topo, session, expendableTasks, collectionInfo, partitionId, lastRunNr, blockUntilConnected)
+                  bool blockUntilConnected = false,
+                  TopoSerialization serialization = TopoSerialization::Mutex,
+                  bool subscribeOnActivation = false)
+        : BasicTopology<Executor, Allocator>(boost::asio::system_executor(), topo, session, expendableTasks, collectionInfo, partitionId, lastRunNr, blockUntilConnected, serialization, subscribeOnActivation)
     {}
 
     /// @brief (Re)Construct a FairMQ topology from an existing DDS topology
@@ -83,6 +165,10 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     /// @param blockUntilConnected if true, ctor will wait for all tasks to confirm subscriptions
     /// @param expendableTasks list of expendable tasks
     /// @param collectionInfo collections information
+    /// @param serialization guard the topology state with a mutex or run all state access on a strand of ex
+    /// @param subscribeOnActivation construct the topology before activating it in DDS: instead of subscribing to all
+    /// devices, subscribe to each one as DDS reports it activated (OnTaskActivated()), and to the remaining ones in
+    /// FinishActivation()
     /// @throws RuntimeError
     BasicTopology(const Executor& ex,
                   dds::topology_api::CTopology& topo,
@@ -92,41 +178,54 @@ class BasicTopology : public AsioBase<Executor, Allocator>
                   const std::string& partitionId,
                   std::atomic<uint64_t>& lastRunNr,
                   bool blockUntilConnected = false,
-                  Allocator alloc = DefaultAllocator())
+                  TopoSerialization serialization = TopoSerialization::Mutex,
+                  bool subscribeOnActivation = false,
+                  Allocator alloc = Allocator())
         : AsioBase<Executor, Allocator>(ex, std::move(alloc))
         , mDDSSession(ddsSession)
         , mDDSCustomCmd(mDDSService)
-        , mDDSTopo(topo)
-        , mMtx(std::make_unique<std::mutex>())
-        , mStateChangeSubscriptionsCV(std::make_unique<std::condition_variable>())
-        , mNumStateChangePublishers(0)
+        , mDDSTopo(&topo)
+        , mSerialization(serialization)
+        , mStrand(boost::asio::make_strand(ex))
+        , mMtx(std::make_unique<TopoMutex>(serialization == TopoSerialization::Mutex))
+        , mTimers(std::make_unique<TopoTimerWheel>(GetOpExecutor(), *mMtx))
+        , mIngest(std::make_unique<CmdIngest>())
+        , mPublishers(std::make_unique<Publishers>())
         , mHeartbeatsTimer(boost::asio::system_executor())
         , mHeartbeatInterval(600000)
+        , mChangeStateOps(AsioBase<Executor, Allocator>::GetAllocator())
+        , mWaitForStateOps(AsioBase<Executor, Allocator>::GetAllocator())
+        , mSetPropertiesOps(AsioBase<Executor, Allocator>::GetAllocator())
+        , mGetPropertiesOps(AsioBase<Executor, Allocator>::GetAllocator())
         , mCollectionInfo(collectionInfo)
         , mPartitionID(partitionId)
         , mLastRunNr(lastRunNr)
     {
+        if constexpr (!std::is_constructible_v<Executor, boost::asio::strand<Executor>>) {
+            if (serialization == TopoSerialization::Strand) {
+                throw RuntimeError("Strand serialization of a topology requires a type-erased executor");
+            }
+        }
+
         // TODO: resources should be extracted from the topology file here, not in the Controller
 
         // prepare topology state
-        dds::topology_api::STopoRuntimeTask::FilterIteratorPair_t itPair;
-        itPair = mDDSTopo.getRuntimeTaskIterator(nullptr);
-        auto tasks = boost::make_iterator_range(itPair.first, itPair.second);
-        mStateData.reserve(boost::size(tasks));
-        int index = 0;
-        for (const auto& [id, task] : tasks) {
-            bool expendable = expendableTasks.find(id) != expendableTasks.end();
-            mStateData.push_back(DeviceStatus(expendable, id, task.m_taskCollectionId));
-            mStateIndex.emplace(id, index++);
-        }
+        auto itPair = mDDSTopo->getRuntimeTaskIterator(nullptr);
+        mStateData.Reserve(boost::size(boost::make_iterator_range(itPair.first, itPair.second)));
+        IndexTasks(expendableTasks);
+        mSubscriptionSent.resize(mStateData.Size(), false);
 
         SubscribeToCommands();
         SubscribeToTaskDoneEvents();
 
         mDDSService.start(to_string(mDDSSession.getSessionID()));
-        SubscribeToStateChanges();
+        if (subscribeOnActivation) {
+            ScheduleSubscriptionHeartbeats();
+        } else {
+            SubscribeToStateChanges();
+        }
         if (blockUntilConnected) {
-            WaitForPublisherCount(mStateIndex.size());
+            WaitForPublisherCount(mStateData.Size());
         }
     }
 
@@ -144,10 +243,15 @@ class BasicTopology : public AsioBase<Executor, Allocator>
 
         mDDSCustomCmd.unsubscribe();
         try {
-            std::lock_guard<std::mutex> lk(*mMtx);
-            for (auto& op : mChangeStateOps) {
-                op.second.Complete(MakeErrorCode(ErrorCode::OperationCanceled));
-            }
+            // in strand mode this also waits for the handlers dispatched to the strand so far
+            Query([&]() {
+                std::lock_guard<TopoMutex> lk(*mMtx);
+                CancelChangeStateOps();
+                for (auto& watch : mWatches) {
+                    watch.second->Cancel();
+                }
+                mWatches.clear();
+            });
         } catch (...) {
         }
         mDDSOnTaskDoneRequest->unsubscribeResponseCallback();
@@ -156,61 +260,79 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     // precondition: mMtx is locked.
     std::vector<DDSTask> GetTasks(const std::string& path = "") const
     {
-        std::vector<DDSTask> list;
+        const TopoPathSelectionPtr selection = SelectPath(path);
 
-        dds::topology_api::STopoRuntimeTask::FilterIteratorPair_t itPair;
-        if (path.empty()) {
-            itPair = mDDSTopo.getRuntimeTaskIterator(nullptr); // passing nullptr will get all tasks
-        } else {
-            itPair = mDDSTopo.getRuntimeTaskIteratorMatchingPath(path);
+        std::vector<DDSTask> list;
+        list.reserve(selection->size());
+        for (const int index : *selection) {
+            if (mStateData.Ignored(index)) {
+                continue;
+            }
+            list.emplace_back(mStateData.TaskId(index), mStateData.CollectionId(index));
         }
-        auto tasks = boost::make_iterator_range(itPair.first, itPair.second);
 
-        list.reserve(boost::size(tasks));
+        return list;
+    }
 
-        // OLOG(debug, mPartitionID, mLastRunNr.load()) << "GetTasks(): Num of tasks: " << boost::size(tasks);
-        for (const auto& task : tasks) {
-            // OLOG(debug, mPartitionID, mLastRunNr.load()) << "GetTasks(): Found task with id: " << task.first << ", "
-            //            << "Path: " << task.second.m_taskPath << ", "
-            //            << "Collection id: " << task.second.m_taskCollectionId << ", "
-            //            << "Name: " << task.second.m_task->getName() << "_" << task.second.m_taskIndex;
-            const DeviceStatus& ds = mStateData.at(mStateIndex.at(task.first));
-            if (ds.ignored) {
-                // OLOG(debug, mPartitionID, mLastRunNr.load()) << "GetTasks(): Task " << ds.taskId << " has failed and is set to be ignored, skipping";
-                continue;
+    /// @brief Get the indices (in the state store) of all tasks matching the path, including ignored ones
+    /// Resolved through the path index and cached per path for the lifetime of the topology.
+    /// precondition: mMtx is locked.
+    TopoPathSelectionPtr SelectPath(const std::string& path) const
+    {
+        auto it = mPathSelections.find(path);
+        if (it == mPathSelections.end()) {
+            if (mPathSelections.size() >= kMaxCachedPaths) {
+                mPathSelections.clear();
             }
-            list.emplace_back(task.first, task.second.m_taskCollectionId);
+            it = mPathSelections.emplace(path, std::make_shared<const TopoPathSelection>(mPathIndex.Select(path))).first;
         }
+        return it->second;
+    }
 
-        return list;
+    /// @brief Get the indices of all tasks matching the path, including ignored ones, see SelectPath()
+    TopoPathSelectionPtr GetPathSelection(const std::string& path) const
+    {
+        return Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            return SelectPath(path);
+        });
     }
 
-    void IgnoreFailedTask(uint64_t id)
+    /// @brief Get the (shared) selection of tasks for the given path
+    /// The selection is cached per path and invalidated whenever a task is ignored.
+    /// precondition: mMtx is locked.
+    TopoTaskSetPtr GetTaskSet(const std::string& path = "")
     {
-        std::lock_guard<std::mutex> lk(*mMtx);
-        DeviceStatus& device = mStateData.at(mStateIndex.at(id));
-        if (device.subscribedToStateChanges) {
-            device.subscribedToStateChanges = false;
-            --mNumStateChangePublishers;
+        auto it = mTaskSets.find(path);
+        if (it == mTaskSets.end()) {
+            if (mTaskSets.size() >= kMaxCachedPaths) {
+                mTaskSets.clear();
+            }
+            it = mTaskSets.emplace(path, std::make_shared<const TopoTaskSet>(GetTasks(path), mStateData)).first;
         }
-        device.ignored = true;
+        return it->second;
+    }
+
+    void IgnoreFailedTask(uint64_t id)
+    {
+        Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            IgnoreTask(mStateData.At(id));
+            mTaskSets.clear();
+        });
     }
 
     void IgnoreFailedCollections(const std::vector<CollectionDetails*>& collections)
     {
-        std::lock_guard<std::mutex> lk(*mMtx);
-        for (auto& device : mStateData) {
+        Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            std::vector<DDSCollection::Id> ids;
+            ids.reserve(collections.size());
             for (const auto& collection : collections) {
-                if (device.collectionId == collection->mCollectionID) {
-                    // OLOG(debug, mPartitionID, mLastRunNr.load()) << "Ignoring device " << device.taskId << " from collection " << collection->mCollectionID;
-                    if (device.subscribedToStateChanges) {
-                        device.subscribedToStateChanges = false;
-                        --mNumStateChangePublishers;
-                    }
-                    device.ignored = true;
-                }
+                ids.push_back(collection->mCollectionID);
             }
-        }
+            IgnoreCollections(ids);
+        });
     }
 
     void SubscribeToStateChanges()
@@ -219,8 +341,44 @@ class BasicTopology : public AsioBase<Executor, Allocator>
         cc::Cmds cmds(cc::make<cc::SubscribeToStateChange>(mHeartbeatInterval.count()));
         mDDSCustomCmd.send(cmds.Serialize(), "");
 
-        mHeartbeatsTimer.expires_after(mHeartbeatInterval);
-        mHeartbeatsTimer.async_wait(std::bind(&BasicTopology::SendSubscriptionHeartbeats, this, std::placeholders::_1));
+        ScheduleSubscriptionHeartbeats();
+    }
+
+    /// @brief Start tracking a device and subscribe to its state changes as soon as DDS reports it activated
+    /// Only for topologies constructed with subscribeOnActivation, called from the activation response callback.
+    void OnTaskActivated(DDSTask::Id taskId)
+    {
+        Dispatch([this, taskId]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            const int index = mStateData.Find(taskId);
+            if (index < 0) {
+                OLOG(warning, mPartitionID, mLastRunNr.load()) << "Activated task " << taskId << " is not part of the topology";
+                return;
+            }
+            SubscribeTask(index, taskId);
+        });
+    }
+
+    /// @brief Subscribe to the state changes of the devices that were not reported by OnTaskActivated()
+    /// Only for topologies constructed with subscribeOnActivation, called once the activation is done.
+    /// A subscription sent before the FairMQ plugin of a device listens to custom commands is lost: subscriptions that
+    /// are not confirmed are re-sent, with an increasing interval, until all devices confirmed or reported a state.
+    void FinishActivation()
+    {
+        Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            const size_t numSent = std::count(mSubscriptionSent.begin(), mSubscriptionSent.end(), true);
+            if (numSent == 0) {
+                mDDSCustomCmd.send(cc::Cmds(cc::make<cc::SubscribeToStateChange>(mHeartbeatInterval.count())).Serialize(), "");
+                mSubscriptionSent.assign(mSubscriptionSent.size(), true);
+            } else {
+                for (int index = 0; index < static_cast<int>(mStateData.Size()); ++index) {
+                    SubscribeTask(index, mStateData.TaskId(index));
+                }
+            }
+            mTimers->Cancel(mResubscription);
+            ScheduleResubscription(kResubscribeInterval, 0);
+        });
     }
 
     void SubscribeToTaskDoneEvents()
@@ -228,82 +386,96 @@ class BasicTopology : public AsioBase<Executor, Allocator>
         using namespace dds::tools_api;
         SOnTaskDoneRequest::request_t request;
         mDDSOnTaskDoneRequest = SOnTaskDoneRequest::makeRequest(request);
-        mDDSOnTaskDoneRequest->setResponseCallback([&](const SOnTaskDoneResponseData& task) {
-            odc::core::DeviceState lastKnownState = odc::core::DeviceState::Undefined;
-            bool unexpected = false;
-
-            {
-                std::unique_lock<std::mutex> lk(*mMtx);
-                DeviceStatus& device = mStateData.at(mStateIndex.at(task.m_taskID));
-                if (device.subscribedToStateChanges) {
-                    device.subscribedToStateChanges = false;
-                    --mNumStateChangePublishers;
-                }
-                device.exitCode = task.m_exitCode;
-                device.signal = task.m_signal;
-                device.lastState = device.state;
-                lastKnownState = device.state;
-
-                bool expendable = false;
-                // check if we have an unexpected exit
-                // only exit from Idle or Exiting are expected
-                if ((device.lastState != DeviceState::Idle && device.lastState != DeviceState::Exiting) || device.exitCode > 0) {
-                    unexpected = true;
-                    device.state = DeviceState::Error;
-                    // check if the device is expendable
-                    expendable = IsExpendable(device);
-                    // Update SetProperties OPs only if unexpected exit
-                    for (auto& op : mSetPropertiesOps) {
-                        op.second.Update(device.taskId, cc::Result::Failure, expendable);
-                    }
-                    // TODO: include GetProperties OPs
-                } else {
-                    device.state = DeviceState::Exiting;
-                }
+        mDDSOnTaskDoneRequest->setResponseCallback([&](const SOnTaskDoneResponseData& response) {
+            Dispatch([this, task = response]() { OnTaskDone(task); });
+        });
+        mDDSSession.sendRequest<SOnTaskDoneRequest>(mDDSOnTaskDoneRequest);
+    }
 
-                for (auto& op : mChangeStateOps) {
-                    op.second.Update(device.taskId, device.state, expendable);
-                }
-                for (auto& op : mWaitForStateOps) {
-                    op.second.Update(device.taskId, device.lastState, device.state, expendable);
-                }
+    // precondition: runs on mStrand in strand mode.
+    void OnTaskDone(const dds::tools_api::SOnTaskDoneResponseData& task)
+    {
+        odc::core::DeviceState lastKnownState = odc::core::DeviceState::Undefined;
+        bool unexpected = false;
+
+        {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            const int index = mStateData.Find(task.m_taskID);
+            if (index < 0) {
+                // removed from the topology by ApplyUpdate() before DDS stopped it
+                OLOG(debug, mPartitionID, mLastRunNr.load()) << "Removed task " << task.m_taskID << " exited";
+                return;
             }
+            UnsubscribeTask(index);
+            mStateData.SetExit(index, task.m_exitCode, task.m_signal);
+            lastKnownState = mStateData.State(index);
 
-            std::stringstream ss;
-            ss << "Task "                 << task.m_taskID << " exited."
-               << " Last known state: "   << lastKnownState
-               << "; path: "              << quoted(task.m_taskPath)
-               << "; exit code: "         << task.m_exitCode
-               << "; signal: "            << task.m_signal
-               << "; host: "              << task.m_host
-               << "; working directory: " << quoted(task.m_wrkDir);
-            if (unexpected) {
-                OLOG(error, mPartitionID, mLastRunNr.load()) << ss.str();
+            bool expendable = false;
+            // check if we have an unexpected exit
+            // only exit from Idle or Exiting are expected
+            if ((lastKnownState != DeviceState::Idle && lastKnownState != DeviceState::Exiting) || task.m_exitCode > 0) {
+                unexpected = true;
+                mStateData.SetState(index, lastKnownState, DeviceState::Error);
+                // check if the device is expendable
+                expendable = IsExpendable(index);
+                // Update SetProperties OPs only if unexpected exit
+                for (const auto id : mOpsByTask[index].setProperties) {
+                    mSetPropertiesOps.at(id).Update(index, task.m_taskID, cc::Result::Failure, expendable);
+                }
+                // TODO: include GetProperties OPs
             } else {
-                OLOG(debug, mPartitionID, mLastRunNr.load()) << ss.str();
+                mStateData.SetState(index, lastKnownState, DeviceState::Exiting);
             }
-        });
-        mDDSSession.sendRequest<SOnTaskDoneRequest>(mDDSOnTaskDoneRequest);
+            NotifyWatches(index);
+
+            const DeviceState state = mStateData.State(index);
+            for (const auto id : mOpsByTask[index].changeState) {
+                mChangeStateOps.at(id).Update(index, task.m_taskID, state, expendable);
+            }
+            for (const auto id : mOpsByTask[index].waitForState) {
+                mWaitForStateOps.at(id).Update(index, task.m_taskID, lastKnownState, state, expendable);
+            }
+            ReapCompletedOps();
+            FlushWatches();
+        }
+
+        std::stringstream ss;
+        ss << "Task "                 << task.m_taskID << " exited."
+           << " Last known state: "   << lastKnownState
+           << "; path: "              << quoted(task.m_taskPath)
+           << "; exit code: "         << task.m_exitCode
+           << "; signal: "            << task.m_signal
+           << "; host: "              << task.m_host
+           << "; working directory: " << quoted(task.m_wrkDir);
+        if (unexpected) {
+            OLOG(error, mPartitionID, mLastRunNr.load()) << ss.str();
+        } else {
+            OLOG(debug, mPartitionID, mLastRunNr.load()) << ss.str();
+        }
     }
 
     // precondition: mMtx is locked
-    bool IsExpendable(odc::core::DeviceStatus& device)
+    bool IsExpendable(int index)
     {
-        if (device.ignored) {
-            OLOG(debug, mPartitionID, mLastRunNr.load()) << "Failed Device " << device.taskId << " is already ignored.";
+        const DDSTask::Id taskId = mStateData.TaskId(index);
+        const DDSCollection::Id collectionId = mStateData.CollectionId(index);
+
+        if (mStateData.Ignored(index)) {
+            OLOG(debug, mPartitionID, mLastRunNr.load()) << "Failed Device " << taskId << " is already ignored.";
             // TODO: check if and when this can happen
             return true;
         }
 
-        if (device.expendable) {
-            OLOG(debug, mPartitionID, mLastRunNr.load()) << "Failed Device " << device.taskId << " is expendable. ignoring.";
-            device.ignored = true;
+        if (mStateData.Expendable(index)) {
+            OLOG(debug, mPartitionID, mLastRunNr.load()) << "Failed Device " << taskId << " is expendable. ignoring.";
+            mStateData.SetIgnored(index);
+            mTaskSets.clear();
             return true;
         }
 
         // if task is not expendable, but is in a collection, check nMin condition
-        if (device.collectionId != 0) {
-            auto runtimeCollection = mDDSTopo.getRuntimeCollectionById(device.collectionId);
+        if (collectionId != 0) {
+            auto runtimeCollection = mDDSTopo->getRuntimeCollectionById(collectionId);
             auto col = runtimeCollection.m_collection;
             auto it = mCollectionInfo.find(col->getName());
             if (it != mCollectionInfo.end()) {
@@ -317,25 +489,22 @@ class BasicTopology : public AsioBase<Executor, Allocator>
                 }
                 if (it->second.nCurrent < it->second.nMin) {
                     // if nMin is not satisfied, the failure cannot be ignored
-                    OLOG(error, mPartitionID, mLastRunNr.load()) << "Collection '" << runtimeCollection.m_collectionPath << "' (id: " << device.collectionId << ")"
+                    OLOG(error, mPartitionID, mLastRunNr.load()) << "Collection '" << runtimeCollection.m_collectionPath << "' (id: " << collectionId << ")"
                         << " has failed and current number of '" << col->getPath() << "' collections (" << it->second.nCurrent
                         << ") is less than nMin (" << it->second.nMin << "). failure cannot be ignored.";
                     return false;
                 } else {
                     // if nMin is satisfied, ignore the entire collection
-                    OLOG(info, mPartitionID, mLastRunNr.load()) << "Ignoring failed collection '" << runtimeCollection.m_collectionPath << "' (id: " << device.collectionId << ")"
+                    OLOG(info, mPartitionID, mLastRunNr.load()) << "Ignoring failed collection '" << runtimeCollection.m_collectionPath << "' (id: " << collectionId << ")"
                         << " as the remaining number of '" << col->getPath() << "' collections (" << it->second.nCurrent
                         << ") is greater than or equal to nMin (" << it->second.nMin << ").";
-                    for (auto& d : mStateData) {
-                        if (d.collectionId == device.collectionId) {
-                            // OLOG(info) << "Ignoring device " << d.taskId << " from collection " << device.collectionId;
-                            if (d.subscribedToStateChanges) {
-                                d.subscribedToStateChanges = false;
-                                --mNumStateChangePublishers;
-                            }
-                            d.ignored = true;
+                    for (size_t i = 0; i < mStateData.Size(); ++i) {
+                        if (mStateData.CollectionId(i) == collectionId) {
+                            // OLOG(info) << "Ignoring device " << mStateData.TaskId(i) << " from collection " << collectionId;
+                            IgnoreTask(i);
                         }
                     }
+                    mTaskSets.clear();
 
                     // TODO: shutdown agent if it has no tasks left (should be done outside of the lock though)
 
@@ -348,28 +517,184 @@ class BasicTopology : public AsioBase<Executor, Allocator>
         return false;
     }
 
+    /// @brief Wait (up to 30s) until the given number of devices are subscribed to state changes
+    /// Woken directly by every change of the count (subscription confirmations, task exits, ignored tasks).
     void WaitForPublisherCount(unsigned int number)
     {
         using namespace std::chrono_literals;
-        std::unique_lock<std::mutex> lk(*mMtx);
-        auto publisherCountReached = [&]() { return mNumStateChangePublishers == number; };
-        auto count = 0;
-        constexpr auto checkInterval(50ms);
-        constexpr auto maxCount(30s / checkInterval);
-        while (!publisherCountReached() && mDDSSession.IsRunning() && count < maxCount) {
-            mStateChangeSubscriptionsCV->wait_for(lk, checkInterval, publisherCountReached);
-            ++count;
+        const auto deadline = std::chrono::steady_clock::now() + 30s;
+        std::unique_lock<std::mutex> lk(mPublishers->mtx);
+        auto publisherCountReached = [&]() { return mPublishers->count == number; };
+        // the end of the DDS session is not signalled, check it once per second
+        while (!publisherCountReached() && mDDSSession.IsRunning() && std::chrono::steady_clock::now() < deadline) {
+            mPublishers->cv.wait_until(lk, std::min(deadline, std::chrono::steady_clock::now() + 1s), publisherCountReached);
         }
     }
 
+    void ScheduleSubscriptionHeartbeats()
+    {
+        mHeartbeatsTimer.expires_after(mHeartbeatInterval);
+        mHeartbeatsTimer.async_wait(std::bind(&BasicTopology::SendSubscriptionHeartbeats, this, std::placeholders::_1));
+    }
+
+    /// @brief Send a state change subscription to a single device, once
+    // precondition: mMtx is locked.
+    void SubscribeTask(int index, DDSTask::Id taskId)
+    {
+        if (mSubscriptionSent[index]) {
+            return;
+        }
+        mSubscriptionSent[index] = true;
+        SendTaskSubscription(taskId);
+    }
+
+    // precondition: mMtx is locked.
+    void SendTaskSubscription(DDSTask::Id taskId)
+    {
+        // DDS looks up a numeric condition as a task id, a path condition is matched as a regex against every task
+        mDDSCustomCmd.send(cc::Cmds(cc::make<cc::SubscribeToStateChange>(mHeartbeatInterval.count())).Serialize(), std::to_string(taskId));
+    }
+
+    /// @brief Re-send the subscriptions that are not confirmed yet after the given interval
+    // precondition: mMtx is locked.
+    void ScheduleResubscription(Duration interval, int attempt)
+    {
+        mResubscription = mTimers->Add(interval, [this, interval, attempt]() {
+            const std::vector<int> pending = mStateData.PendingSubscriptions();
+            if (pending.empty()) {
+                return;
+            }
+            if (attempt == kMaxResubscriptions) {
+                OLOG(warning, mPartitionID, mLastRunNr.load()) << pending.size() << " device(s) did not confirm the state change subscription";
+                return;
+            }
+            OLOG(debug, mPartitionID, mLastRunNr.load()) << "Re-sending the state change subscription to " << pending.size() << " device(s)";
+            for (const int index : pending) {
+                SendTaskSubscription(mStateData.TaskId(index));
+            }
+            ScheduleResubscription(std::min(2 * interval, kMaxResubscribeInterval), attempt + 1);
+        });
+    }
+
+    /// @brief Path pattern selecting exactly the given tasks of a DDS topology, see TopoSelectionPattern()
+    /// @param taskIds selected tasks, must not be empty (an empty pattern selects all tasks)
+    static std::string SelectionPattern(dds::topology_api::CTopology& topo, const std::vector<DDSTask::Id>& taskIds)
+    {
+        std::vector<TopoSelectedTask> tasks;
+        tasks.reserve(taskIds.size());
+        std::unordered_map<uint64_t, size_t> collectionSizes;
+        for (const auto taskId : taskIds) {
+            const auto& task = topo.getRuntimeTaskById(taskId);
+            if (task.m_taskCollectionId == 0) {
+                tasks.push_back(TopoSelectedTask{ task.m_taskPath, 0, "" });
+            } else {
+                tasks.push_back(TopoSelectedTask{ task.m_taskPath, task.m_taskCollectionId, topo.getRuntimeCollectionById(task.m_taskCollectionId).m_collectionPath });
+                collectionSizes.emplace(task.m_taskCollectionId, 0);
+            }
+        }
+        if (!collectionSizes.empty()) {
+            auto itPair = topo.getRuntimeTaskIterator(nullptr);
+            for (const auto& [id, task] : boost::make_iterator_range(itPair.first, itPair.second)) {
+                if (auto it = collectionSizes.find(task.m_taskCollectionId); it != collectionSizes.end()) {
+                    ++it->second;
+                }
+            }
+        }
+        return TopoSelectionPattern(tasks, collectionSizes);
+    }
+
+    /// @brief Check if tasks of a DDS topology that are not added read properties that added tasks write
+    /// FairMQ devices publish the addresses of their bound channels as DDS properties, the readers connect to them. Kept
+    /// devices only read these properties during their configuration, so they have to be configured again.
+    /// @param taskIds added tasks
+    static bool ReconnectsToAdded(dds::topology_api::CTopology& topo, const std::vector<DDSTask::Id>& taskIds)
+    {
+        using dds::topology_api::EPropertyAccessType;
+        const std::unordered_set<DDSTask::Id> added(taskIds.begin(), taskIds.end());
+        std::unordered_set<std::string> written;
+        for (const auto taskId : taskIds) {
+            for (const auto& [name, property] : topo.getRuntimeTaskById(taskId).m_task->getProperties()) {
+                if (property->getAccessType() != EPropertyAccessType::READ) {
+                    written.insert(name);
+                }
+            }
+        }
+        if (written.empty()) {
+            return false;
+        }
+        auto itPair = topo.getRuntimeTaskIterator(nullptr);
+        for (const auto& [id, task] : boost::make_iterator_range(itPair.first, itPair.second)) {
+            if (added.count(id) != 0) {
+                continue;
+            }
+            for (const auto& [name, property] : task.m_task->getProperties()) {
+                if (property->getAccessType() != EPropertyAccessType::WRITE && written.count(name) != 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /// @brief Compare the devices of this topology with the tasks of an updated DDS topology, see ApplyUpdate()
+    TopoDiff Diff(dds::topology_api::CTopology& topo) const
+    {
+        const std::vector<DDSTask::Id> taskIds = RuntimeTaskIds(topo);
+        return Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            return mStateData.Diff(taskIds);
+        });
+    }
+
+    /// @brief Switch to an updated DDS topology in place, before activating the update in DDS
+    /// Devices that are not part of the updated topology are dropped (without waiting for them to exit), new ones are
+    /// added in the Undefined state and subscribed to as DDS reports them activated (OnTaskActivated()) or in
+    /// FinishActivation(). All other devices keep their state and subscription. State watches are canceled, since
+    /// their selections refer to the previous device indices.
+    /// @param topo updated DDS topology, must outlive this topology or the next update
+    /// @param expendableTasks expendable tasks of the updated topology
+    /// @throws RuntimeError if operations are in flight
+    void ApplyUpdate(dds::topology_api::CTopology& topo, const std::unordered_set<uint64_t>& expendableTasks)
+    {
+        Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            ReapCompletedOps();
+            if (!mChangeStateOps.empty() || !mWaitForStateOps.empty() || !mSetPropertiesOps.empty() || !mGetPropertiesOps.empty()) {
+                throw RuntimeError("Cannot update a topology with operations in flight");
+            }
+
+            std::vector<int> removed;
+            for (const auto taskId : mStateData.Diff(RuntimeTaskIds(topo)).removed) {
+                const int index = mStateData.Find(taskId);
+                UnsubscribeTask(index);
+                removed.push_back(index);
+            }
+            mStateData.Erase(removed);
+            const size_t numKept = mStateData.Size();
+
+            mDDSTopo = &topo;
+            mPathIndex = TopoPathIndex();
+            mCollectionNames.clear();
+            IndexTasks(expendableTasks);
+            // the remaining devices are subscribed already, by a broadcast or individually
+            mSubscriptionSent.assign(numKept, true);
+            mSubscriptionSent.resize(mStateData.Size(), false);
+            mTaskSets.clear();
+            mPathSelections.clear();
+            for (auto& watch : mWatches) {
+                watch.second->Cancel();
+            }
+            mWatches.clear();
+        });
+    }
+
     void SendSubscriptionHeartbeats(const boost::system::error_code& ec)
     {
         if (!ec) {
             // Timer expired.
             mDDSCustomCmd.send(cc::Cmds(cc::make<cc::SubscriptionHeartbeat>(mHeartbeatInterval.count())).Serialize(), "");
             // schedule again
-            mHeartbeatsTimer.expires_after(mHeartbeatInterval);
-            mHeartbeatsTimer.async_wait(std::bind(&BasicTopology::SendSubscriptionHeartbeats, this, std::placeholders::_1));
+            ScheduleSubscriptionHeartbeats();
         } else if (ec == boost::asio::error::operation_aborted) {
             // OLOG(debug) << "Heartbeats timer canceled";
         } else {
@@ -395,26 +720,16 @@ class BasicTopology : public AsioBase<Executor, Allocator>
             // OLOG(debug) << "Received " << inCmds.Size() << " command(s) with total size of " <<
             // msg.length() << " bytes: ";
 
-            for (const auto& cmd : inCmds) {
+            for (auto& cmd : inCmds) {
                 // OLOG(debug) << " > " << cmd->GetType();
                 switch (cmd->GetType()) {
                     case cc::Type::state_change_subscription:
-                        HandleCmd(static_cast<cc::StateChangeSubscription&>(*cmd));
-                        break;
                     case cc::Type::state_change_unsubscription:
-                        HandleCmd(static_cast<cc::StateChangeUnsubscription&>(*cmd));
-                        break;
                     case cc::Type::state_change:
-                        HandleCmd(static_cast<cc::StateChange&>(*cmd));
-                        break;
                     case cc::Type::transition_status:
-                        HandleCmd(static_cast<cc::TransitionStatus&>(*cmd));
-                        break;
                     case cc::Type::properties:
-                        HandleCmd(static_cast<cc::Properties&>(*cmd));
-                        break;
                     case cc::Type::properties_set:
-                        HandleCmd(static_cast<cc::PropertiesSet&>(*cmd));
+                        mIngest->queue.Push(std::move(cmd));
                         break;
                     default:
                         OLOG(warning) << "Unexpected/unknown command received: " << cmd->GetType();
@@ -422,25 +737,106 @@ class BasicTopology : public AsioBase<Executor, Allocator>
                         break;
                 }
             }
+            Dispatch([this]() { ApplyQueuedCmds(); });
         });
     }
 
+    /// @brief Apply queued device commands in batches, taking mMtx once per batch
+    /// Any thread that queued commands calls this. Only one thread applies at a time, the others return
+    /// immediately and leave their commands to the active applier.
+    void ApplyQueuedCmds()
+    {
+        CmdIngest& ingest = *mIngest;
+        std::vector<std::unique_ptr<cc::Cmd>> batch;
+        while (ingest.queue.Size() > 0 && !ingest.applying.exchange(true)) {
+            while (ingest.queue.Size() > 0) {
+                const size_t depth = ingest.queue.Size();
+                if (depth > ingest.maxQueueDepth.load(std::memory_order_relaxed)) {
+                    ingest.maxQueueDepth.store(depth, std::memory_order_relaxed);
+                }
+                batch.clear();
+                std::unique_ptr<cc::Cmd> cmd;
+                while (batch.size() < kMaxCmdBatchSize && ingest.queue.TryPop(cmd)) {
+                    batch.push_back(std::move(cmd));
+                }
+                if (batch.empty()) {
+                    // a producer is still linking its element
+                    std::this_thread::yield();
+                    continue;
+                }
+                {
+                    std::lock_guard<TopoMutex> lk(*mMtx);
+                    for (const auto& c : batch) {
+                        ApplyCmd(*c);
+                    }
+                    FlushWatches();
+                }
+                ingest.numCmds.fetch_add(batch.size(), std::memory_order_relaxed);
+                ingest.numBatches.fetch_add(1, std::memory_order_relaxed);
+                if (batch.size() > ingest.maxBatchSize.load(std::memory_order_relaxed)) {
+                    ingest.maxBatchSize.store(batch.size(), std::memory_order_relaxed);
+                }
+            }
+            ingest.applying.store(false);
+            // re-check the queue: commands pushed after the last pop may have seen the applying flag still set
+            // (sequentially consistent flag and size accesses, so either we or the producer sees the other)
+        }
+    }
+
+    /// @brief Counters of the device command ingest queue
+    CmdIngestStats GetCmdIngestStats() const
+    {
+        CmdIngestStats stats;
+        stats.queueDepth = mIngest->queue.Size();
+        stats.maxQueueDepth = mIngest->maxQueueDepth.load(std::memory_order_relaxed);
+        stats.numCmds = mIngest->numCmds.load(std::memory_order_relaxed);
+        stats.numBatches = mIngest->numBatches.load(std::memory_order_relaxed);
+        stats.maxBatchSize = mIngest->maxBatchSize.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // precondition: mMtx is locked.
+    void ApplyCmd(const cc::Cmd& cmd)
+    {
+        switch (cmd.GetType()) {
+            case cc::Type::state_change_subscription:
+                HandleCmd(static_cast<const cc::StateChangeSubscription&>(cmd));
+                break;
+            case cc::Type::state_change_unsubscription:
+                HandleCmd(static_cast<const cc::StateChangeUnsubscription&>(cmd));
+                break;
+            case cc::Type::state_change:
+                HandleCmd(static_cast<const cc::StateChange&>(cmd));
+                break;
+            case cc::Type::transition_status:
+                HandleCmd(static_cast<const cc::TransitionStatus&>(cmd));
+                break;
+            case cc::Type::properties:
+                HandleCmd(static_cast<const cc::Properties&>(cmd));
+                break;
+            case cc::Type::properties_set:
+                HandleCmd(static_cast<const cc::PropertiesSet&>(cmd));
+                break;
+            default:
+                break;
+        }
+    }
+
+    // precondition: mMtx is locked.
     void HandleCmd(cc::StateChangeSubscription const& cmd)
     {
         if (cmd.GetResult() == cc::Result::Ok) {
             DDSTask::Id taskId(cmd.GetTaskId());
 
             try {
-                std::unique_lock<std::mutex> lk(*mMtx);
-                DeviceStatus& task = mStateData.at(mStateIndex.at(taskId));
-                if (!task.subscribedToStateChanges) {
-                    task.subscribedToStateChanges = true;
-                    ++mNumStateChangePublishers;
+                const int index = mStateData.At(taskId);
+                if (!mStateData.Subscribed(index)) {
+                    mStateData.SetSubscribed(index, true);
+                    AddPublishers(1);
                 } else {
-                    OLOG(warning) << "Task '" << task.taskId << "' sent subscription confirmation more than once";
+                    // re-sent subscriptions (FinishActivation()) can cross their first confirmation
+                    OLOG(debug) << "Task '" << taskId << "' sent subscription confirmation more than once";
                 }
-                lk.unlock();
-                mStateChangeSubscriptionsCV->notify_one();
             } catch (const std::exception& e) {
                 OLOG(error) << "Exception in HandleCmd(cc::StateChangeSubscription const&): " << e.what();
                 OLOG(error) << "Possibly no task with id '" << taskId << "'?";
@@ -450,22 +846,19 @@ class BasicTopology : public AsioBase<Executor, Allocator>
         }
     }
 
+    // precondition: mMtx is locked.
     void HandleCmd(cc::StateChangeUnsubscription const& cmd)
     {
         if (cmd.GetResult() == cc::Result::Ok) {
             DDSTask::Id taskId(cmd.GetTaskId());
 
             try {
-                std::unique_lock<std::mutex> lk(*mMtx);
-                DeviceStatus& task = mStateData.at(mStateIndex.at(taskId));
-                if (task.subscribedToStateChanges) {
-                    task.subscribedToStateChanges = false;
-                    --mNumStateChangePublishers;
+                const int index = mStateData.At(taskId);
+                if (mStateData.Subscribed(index)) {
+                    UnsubscribeTask(index);
                 } else {
-                    // OLOG(debug) << "Task '" << task.taskId << "' sent unsubscription confirmation more than once";
+                    // OLOG(debug) << "Task '" << taskId << "' sent unsubscription confirmation more than once";
                 }
-                lk.unlock();
-                mStateChangeSubscriptionsCV->notify_one();
             } catch (const std::exception& e) {
                 OLOG(error) << "Exception in HandleCmd(cc::StateChangeUnsubscription const&): " << e.what();
             }
@@ -474,130 +867,184 @@ class BasicTopology : public AsioBase<Executor, Allocator>
         }
     }
 
+    // precondition: mMtx is locked.
     void HandleCmd(cc::StateChange const& cmd)
     {
         DDSTask::Id taskId(cmd.GetTaskId());
 
         try {
-            std::lock_guard<std::mutex> lk(*mMtx);
-            DeviceStatus& device = mStateData.at(mStateIndex.at(taskId));
-            DeviceState lastState = device.state;
-            device.lastState = cmd.GetLastState();
-            device.state = cmd.GetCurrentState();
-            // OLOG(debug, mPartitionID, mLastRunNr.load()) << "Updated state entry: taskId=" << taskId << ", state=" << device.state;
+            const int index = mStateData.At(taskId);
+            const DeviceState lastState = mStateData.State(index);
+            const DeviceState state = cmd.GetCurrentState();
+            mStateData.SetState(index, cmd.GetLastState(), state);
+            NotifyWatches(index);
+            // OLOG(debug, mPartitionID, mLastRunNr.load()) << "Updated state entry: taskId=" << taskId << ", state=" << state;
 
             bool expendable = false;
             // check if we have an unexpected exit
-            if (device.state == DeviceState::Error || (device.state == DeviceState::Exiting && lastState != DeviceState::Idle)) {
-                OLOG(error, mPartitionID, mLastRunNr.load()) << "Device " << device.taskId << " unexpectedly reached " << device.state << " state";
+            if (state == DeviceState::Error || (state == DeviceState::Exiting && lastState != DeviceState::Idle)) {
+                OLOG(error, mPartitionID, mLastRunNr.load()) << "Device " << taskId << " unexpectedly reached " << state << " state";
                 // check if the device is expendable
-                expendable = IsExpendable(device);
+                expendable = IsExpendable(index);
                 // Update SetProperties OPs only if unexpected exit
-                for (auto& op : mSetPropertiesOps) {
-                    op.second.Update(device.taskId, cc::Result::Failure, expendable);
+                for (const auto id : mOpsByTask[index].setProperties) {
+                    mSetPropertiesOps.at(id).Update(index, taskId, cc::Result::Failure, expendable);
                 }
             }
 
-            for (auto& op : mChangeStateOps) {
-                op.second.Update(taskId, cmd.GetCurrentState(), expendable);
+            for (const auto id : mOpsByTask[index].changeState) {
+                mChangeStateOps.at(id).Update(index, taskId, cmd.GetCurrentState(), expendable);
             }
-            for (auto& op : mWaitForStateOps) {
-                op.second.Update(taskId, cmd.GetLastState(), cmd.GetCurrentState(), expendable);
+            for (const auto id : mOpsByTask[index].waitForState) {
+                mWaitForStateOps.at(id).Update(index, taskId, cmd.GetLastState(), cmd.GetCurrentState(), expendable);
             }
+            ReapCompletedOps();
         } catch (const std::exception& e) {
             OLOG(error) << "Exception in HandleCmd(cmd::StateChange const&): " << e.what();
             OLOG(error) << "Possibly no task with id '" << taskId << "'?";
         }
     }
 
+    // precondition: mMtx is locked.
     void HandleCmd(cc::TransitionStatus const& cmd)
     {
         if (cmd.GetResult() != cc::Result::Ok) {
             DDSTask::Id taskId(cmd.GetTaskId());
-            std::lock_guard<std::mutex> lk(*mMtx);
-            for (auto& op : mChangeStateOps) {
-                if (!op.second.IsCompleted() && op.second.ContainsTask(taskId)) {
-                    if (mStateData.at(mStateIndex.at(taskId)).state != op.second.GetTargetState()) {
+            const int index = mStateData.Find(taskId);
+            if (index < 0) {
+                OLOG(error) << "Transition status received from unknown task id '" << taskId << "'";
+                return;
+            }
+            for (const auto id : mOpsByTask[index].changeState) {
+                auto& op = mChangeStateOps.at(id);
+                if (!op.IsCompleted()) {
+                    if (mStateData.State(index) != op.GetTargetState()) {
                         OLOG(error) << cmd.GetTransition() << " transition failed for " << cmd.GetDeviceId() << ", device is in " << cmd.GetCurrentState() << " state.";
-                        op.second.Complete(MakeErrorCode(ErrorCode::DeviceChangeStateInvalidTransition));
+                        op.Complete(MakeErrorCode(ErrorCode::DeviceChangeStateInvalidTransition));
                     } else {
                         OLOG(debug) << cmd.GetTransition() << " transition failed for " << cmd.GetDeviceId() << ", device is already in " << cmd.GetCurrentState() << " state.";
                     }
                 }
             }
+            ReapCompletedOps();
         }
     }
 
+    // precondition: mMtx is locked.
     void HandleCmd(cc::Properties const& cmd)
     {
         try {
-            std::unique_lock<std::mutex> lk(*mMtx);
             auto& op(mGetPropertiesOps.at(cmd.GetRequestId()));
             op.Update(cmd.GetTaskId(), cmd.GetResult(), cmd.GetProps());
+            ReapCompletedOps();
         } catch (std::out_of_range& e) {
             OLOG(debug) << "GetProperties operation (request id: " << cmd.GetRequestId() << ") not found (probably completed or timed out), "
                         << "discarding reply of device " << cmd.GetDeviceId() << ", task id: " << cmd.GetTaskId();
         }
     }
 
+    // precondition: mMtx is locked.
     void HandleCmd(cc::PropertiesSet const& cmd)
     {
         try {
-            std::unique_lock<std::mutex> lk(*mMtx);
             auto& op(mSetPropertiesOps.at(cmd.GetRequestId()));
-            op.Update(cmd.GetTaskId(), cmd.GetResult(), false);
+            op.Update(mStateData.At(cmd.GetTaskId()), cmd.GetTaskId(), cmd.GetResult(), false);
+            ReapCompletedOps();
         } catch (std::out_of_range& e) {
             OLOG(debug) << "SetProperties operation (request id: " << cmd.GetRequestId() << ") not found (probably completed or timed out), "
                         << "discarding reply of device " << cmd.GetDeviceId() << ", task id: " << cmd.GetTaskId();
         }
     }
 
-    /// @brief Initiate state transition on all FairMQ devices in this topology
-    /// @param transition FairMQ device state machine transition
+    /// @brief Initiate a sequence of state transitions on all FairMQ devices in this topology
+    /// More than one transition is sent as a single cc::ChangeStateSequence, which every device advances through on its
+    /// own (waiting for the addresses of its connecting channels before Connect), so the devices do not wait for each
+    /// other between the individual transitions. Completes once all devices reach the state of the last transition.
+    /// @param transitions FairMQ device state machine transitions, applied in order
     /// @param path Select a subset of FairMQ devices in this topology, empty selects all
     /// @param timeout Timeout in milliseconds, 0 means no timeout
     /// @param token Asio completion token
     /// @tparam CompletionToken Asio completion token type
     /// @throws std::system_error
     template<typename CompletionToken>
-    auto AsyncChangeState(const TopoTransition transition, const std::string& path, Duration timeout, CompletionToken&& token)
+    auto AsyncChangeState(std::vector<TopoTransition> transitions, const std::string& path, Duration timeout, CompletionToken&& token)
     {
+        if (transitions.empty()) {
+            throw RuntimeError("AsyncChangeState: empty transition sequence");
+        }
         return boost::asio::async_initiate<CompletionToken, ChangeStateCompletionSignature>(
             [&](auto handler) {
-                const uint64_t id = uuidHash();
-
-                std::lock_guard<std::mutex> lk(*mMtx);
+                const uint64_t id = mRequestIds->Next();
+                const bool failFast = mFailFast;
+                const bool quorum = mQuorum;
+
+                Dispatch([this, id, transitions = std::move(transitions), path, timeout, failFast, quorum, handler = std::move(handler)]() mutable {
+                    std::lock_guard<TopoMutex> lk(*mMtx);
+
+                    ReapCompletedOps();
+
+                    auto [it, inserted] = mChangeStateOps.try_emplace(id,
+                                                                      id,
+                                                                      transitions.back(),
+                                                                      GetTaskSet(path),
+                                                                      mStateData,
+                                                                      timeout,
+                                                                      *mMtx,
+                                                                      *mTimers,
+                                                                      GetOpExecutor(),
+                                                                      AsioBase<Executor, Allocator>::GetAllocator(),
+                                                                      MakeOpHandler(std::move(handler))
+                    );
+
+                    it->second.SetCompletionCallback([this](uint64_t opId) { mCompletedOps.emplace_back(OpKind::ChangeState, opId); });
+                    it->second.SetFailFast(failFast);
+                    if (quorum) {
+                        if (auto q = MakeQuorum(*(it->second.GetTaskSet())); q.has_value()) {
+                            it->second.SetQuorum(std::move(q.value()), [this](const std::vector<DDSCollection::Id>& stragglers) { IgnoreStragglers(stragglers); });
+                        }
+                    }
+                    LinkOp(&TaskOps::changeState, id, *(it->second.GetTaskSet()));
 
-                for (auto it = begin(mChangeStateOps); it != end(mChangeStateOps);) {
-                    if (it->second.IsCompleted()) {
-                        it = mChangeStateOps.erase(it);
+                    if (transitions.size() == 1) {
+                        cc::Cmds cmds(cc::make<cc::ChangeState>(transitions.front()));
+                        mDDSCustomCmd.send(cmds.Serialize(), path);
                     } else {
-                        ++it;
+                        cc::Cmds cmds(cc::make<cc::ChangeStateSequence>(transitions));
+                        mDDSCustomCmd.send(cmds.Serialize(), path);
                     }
-                }
 
-                auto [it, inserted] = mChangeStateOps.try_emplace(id,
-                                                                  id,
-                                                                  transition,
-                                                                  GetTasks(path),
-                                                                  mStateData,
-                                                                  timeout,
-                                                                  *mMtx,
-                                                                  AsioBase<Executor, Allocator>::GetExecutor(),
-                                                                  AsioBase<Executor, Allocator>::GetAllocator(),
-                                                                  std::move(handler)
-                );
-
-                cc::Cmds cmds(cc::make<cc::ChangeState>(transition));
-                mDDSCustomCmd.send(cmds.Serialize(), path);
-
-                it->second.ResetCount(mStateIndex, mStateData);
-                // TODO: make sure following operation properly queues the completion and not doing it directly out of initiation call.
-                it->second.TryCompletion();
+                    it->second.ResetCount(mStateData);
+                    // TODO: make sure following operation properly queues the completion and not doing it directly out of initiation call.
+                    it->second.TryCompletion();
+                    ReapCompletedOps();
+                });
             },
             token);
     }
 
+    /// @brief Complete all in-flight ChangeState operations with OperationCanceled
+    /// Returns once the operations are completed, their handlers run on their executors.
+    void CancelChangeStates()
+    {
+        Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            CancelChangeStateOps();
+        });
+    }
+
+    /// @brief Initiate state transition on all FairMQ devices in this topology
+    /// @param transition FairMQ device state machine transition
+    /// @param path Select a subset of FairMQ devices in this topology, empty selects all
+    /// @param timeout Timeout in milliseconds, 0 means no timeout
+    /// @param token Asio completion token
+    /// @tparam CompletionToken Asio completion token type
+    /// @throws std::system_error
+    template<typename CompletionToken>
+    auto AsyncChangeState(const TopoTransition transition, const std::string& path, Duration timeout, CompletionToken&& token)
+    {
+        return AsyncChangeState(std::vector<TopoTransition>{ transition }, path, timeout, std::move(token));
+    }
+
     /// @brief Initiate state transition on all FairMQ devices in this topology
     /// @param transition FairMQ device state machine transition
     /// @param token Asio completion token
@@ -638,12 +1085,12 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     /// @param path Select a subset of FairMQ devices in this topology, empty selects all
     /// @param timeout Timeout in milliseconds, 0 means no timeout
     /// @throws std::system_error
-    std::pair<std::error_code, TopoState> ChangeState(const TopoTransition transition, const std::string& path = "", Duration timeout = Duration(0))
+    std::pair<std::error_code, TopoStateSnapshotPtr> ChangeState(const TopoTransition transition, const std::string& path = "", Duration timeout = Duration(0))
     {
         SharedSemaphore blocker;
         std::error_code ec;
-        TopoState state;
-        AsyncChangeState(transition, path, timeout, [&, blocker](std::error_code _ec, TopoState _state) mutable {
+        TopoStateSnapshotPtr state;
+        AsyncChangeState(transition, path, timeout, [&, blocker](std::error_code _ec, TopoStateSnapshotPtr _state) mutable {
             ec = _ec;
             state = _state;
             blocker.Signal();
@@ -656,19 +1103,131 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     /// @param transition FairMQ device state machine transition
     /// @param timeout Timeout in milliseconds, 0 means no timeout
     /// @throws std::system_error
-    std::pair<std::error_code, TopoState> ChangeState(const TopoTransition transition, Duration timeout) { return ChangeState(transition, "", timeout); }
+    std::pair<std::error_code, TopoStateSnapshotPtr> ChangeState(const TopoTransition transition, Duration timeout) { return ChangeState(transition, "", timeout); }
+
+    /// @brief Perform a sequence of state transitions on FairMQ devices in this topology for a specified topology path
+    /// @param transitions FairMQ device state machine transitions, applied in order
+    /// @param path Select a subset of FairMQ devices in this topology, empty selects all
+    /// @param timeout Timeout in milliseconds, 0 means no timeout
+    /// @throws std::system_error
+    std::pair<std::error_code, TopoStateSnapshotPtr> ChangeState(const std::vector<TopoTransition>& transitions, const std::string& path = "", Duration timeout = Duration(0))
+    {
+        SharedSemaphore blocker;
+        std::error_code ec;
+        TopoStateSnapshotPtr state;
+        AsyncChangeState(transitions, path, timeout, [&, blocker](std::error_code _ec, TopoStateSnapshotPtr _state) mutable {
+            ec = _ec;
+            state = _state;
+            blocker.Signal();
+        });
+        blocker.Wait();
+        return { ec, state };
+    }
 
     /// @brief Returns the current state of the topology
     /// @return map of id : DeviceStatus
-    TopoState GetCurrentState() const
+    TopoState GetCurrentState() const { return GetStateSnapshot()->state; }
+
+    /// @brief Returns an immutable snapshot of the current state of the topology
+    /// The snapshot is shared with other readers (and operation completions) until the state changes,
+    /// so repeated calls without intermediate state changes do not copy the topology state. A new snapshot is
+    /// materialized outside of the lock from a flat copy of the state arrays, to not stall incoming state updates.
+    TopoStateSnapshotPtr GetStateSnapshot() const
     {
-        std::lock_guard<std::mutex> lk(*mMtx);
-        return mStateData;
+        std::optional<TopoStateColumns> columns;
+        TopoStateSnapshotPtr snapshot = Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            TopoStateSnapshotPtr cached = mStateData.CachedSnapshot();
+            if (!cached) {
+                columns = mStateData.CopyColumns();
+            }
+            return cached;
+        });
+        if (snapshot) {
+            return snapshot;
+        }
+        snapshot = columns->ToSnapshot();
+        Dispatch([this, snapshot]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            mStateData.PublishSnapshot(snapshot);
+        });
+        return snapshot;
     }
 
-    DeviceState AggregateState() const { return AggregateState(GetCurrentState()); }
+    /// @brief Watch the state changes of selected FairMQ devices in this topology
+    /// The handler is called with batches of state changes (on its associated executor, one batch at a time) until
+    /// CancelWatchState() or the destruction of the topology, and then once more with OperationCanceled. Changes that
+    /// happen while the handler is busy are coalesced to the latest change per device.
+    /// @param path Select a subset of FairMQ devices in this topology, empty selects all
+    /// @param sinceVersion state version the caller is up to date with (e.g. of GetStateSnapshot()), if the state
+    /// changed since then the first batch carries the current state of all selected devices
+    /// @param handler Handler with the signature void(std::error_code, TopoStateDeltas), called repeatedly
+    /// @return id of the watch
+    template<typename Handler>
+    uint64_t AsyncWatchState(const std::string& path, uint64_t sinceVersion, Handler&& handler)
+    {
+        const uint64_t id = mRequestIds->Next();
+        auto ex = boost::asio::get_associated_executor(handler, GetOpExecutor());
+        TopoStateWatch::Handler watchHandler(std::forward<Handler>(handler));
+
+        Dispatch([this, id, path, sinceVersion, ex, watchHandler = std::move(watchHandler)]() mutable {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+
+            auto watch = std::make_shared<TopoStateWatch>(GetTaskSet(path), mStateData.Size(), std::move(watchHandler), [ex](std::function<void()> f) {
+                boost::asio::post(ex, std::move(f));
+            });
+            if (sinceVersion < mStateData.Version()) {
+                const uint64_t version = mStateData.Version();
+                for (const int index : watch->GetTaskSet()->Indices()) {
+                    watch->Push(index, { mStateData.TaskId(index), mStateData.LastState(index), mStateData.State(index), version });
+                }
+                watch->Flush();
+            }
+            mWatches.emplace(id, std::move(watch));
+        });
+        return id;
+    }
 
-    bool StateEqualsTo(DeviceState state) const { return StateEqualsTo(GetCurrentState(), state); }
+    /// @brief Stop a watch started with AsyncWatchState(), its handler is called a last time with OperationCanceled
+    void CancelWatchState(uint64_t id)
+    {
+        Dispatch([this, id]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            if (auto it = mWatches.find(id); it != mWatches.end()) {
+                it->second->Cancel();
+                mWatches.erase(it);
+            }
+        });
+    }
+
+    /// @brief Returns the aggregated state of the (non-ignored) devices in this topology, in O(1)
+    AggregatedState AggregateState() const
+    {
+        return Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            return mStateData.Counters().Aggregated();
+        });
+    }
+
+    /// @brief Returns the aggregated state of the (non-ignored) devices of a collection, in O(1)
+    AggregatedState AggregateCollectionState(DDSCollection::Id id) const
+    {
+        return Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            return mStateData.Counters().CollectionAggregated(id);
+        });
+    }
+
+    bool StateEqualsTo(DeviceState state) const { return AggregateState() == static_cast<AggregatedState>(state); }
+
+    /// @brief Returns per-state counts of devices and collections, without copying the topology state
+    TopoStateCounts GetStateCounts() const
+    {
+        return Query([&]() {
+            std::lock_guard<TopoMutex> lk(*mMtx);
+            return mStateData.Counters().Counts();
+        });
+    }
 
     /// @brief Initiate waiting for selected FairMQ devices to reach given last & current state in this topology
     /// @param targetLastState the target last device state to wait for
@@ -683,33 +1242,36 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     {
         return boost::asio::async_initiate<CompletionToken, WaitForStateCompletionSignature>(
             [&](auto handler) {
-                const uint64_t id = uuidHash();
-
-                std::lock_guard<std::mutex> lk(*mMtx);
-
-                for (auto it = begin(mWaitForStateOps); it != end(mWaitForStateOps);) {
-                    if (it->second.IsCompleted()) {
-                        it = mWaitForStateOps.erase(it);
-                    } else {
-                        ++it;
-                    }
-                }
-
-                auto [it, inserted] = mWaitForStateOps.try_emplace(id,
-                                                                   id,
-                                                                   targetLastState,
-                                                                   targetCurrentState,
-                                                                   GetTasks(path),
-                                                                   timeout,
-                                                                   *mMtx,
-                                                                   AsioBase<Executor, Allocator>::GetExecutor(),
-                                                                   AsioBase<Executor, Allocator>::GetAllocator(),
-                                                                   std::move(handler)
-                );
-
-                it->second.ResetCount(mStateIndex, mStateData);
-                // TODO: make sure following operation properly queues the completion and not doing it directly out of initiation call.
-                it->second.TryCompletion();
+                const uint64_t id = mRequestIds->Next();
+                const bool failFast = mFailFast;
+
+                Dispatch([this, id, targetLastState, targetCurrentState, path, timeout, failFast, handler = std::move(handler)]() mutable {
+                    std::lock_guard<TopoMutex> lk(*mMtx);
+
+                    ReapCompletedOps();
+
+                    auto [it, inserted] = mWaitForStateOps.try_emplace(id,
+                                                                       id,
+                                                                       targetLastState,
+                                                                       targetCurrentState,
+                                                                       GetTaskSet(path),
+                                                                       timeout,
+                                                                       *mMtx,
+                                                                       *mTimers,
+                                                                       GetOpExecutor(),
+                                                                       AsioBase<Executor, Allocator>::GetAllocator(),
+                                                                       MakeOpHandler(std::move(handler))
+                    );
+
+                    it->second.SetCompletionCallback([this](uint64_t opId) { mCompletedOps.emplace_back(OpKind::WaitForState, opId); });
+                    it->second.SetFailFast(failFast);
+                    LinkOp(&TaskOps::waitForState, id, *(it->second.GetTaskSet()));
+
+                    it->second.ResetCount(mStateData);
+                    // TODO: make sure following operation properly queues the completion and not doing it directly out of initiation call.
+                    it->second.TryCompletion();
+                    ReapCompletedOps();
+                });
             },
             token);
     }
@@ -777,30 +1339,28 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     {
         return boost::asio::async_initiate<CompletionToken, GetPropertiesCompletionSignature>(
             [&](auto handler) {
-                const uint64_t id = uuidHash();
-
-                std::lock_guard<std::mutex> lk(*mMtx);
-
-                for (auto it = begin(mGetPropertiesOps); it != end(mGetPropertiesOps);) {
-                    if (it->second.IsCompleted()) {
-                        it = mGetPropertiesOps.erase(it);
-                    } else {
-                        ++it;
-                    }
-                }
-
-                mGetPropertiesOps.try_emplace(id,
-                                              id,
-                                              GetTasks(path),
-                                              timeout,
-                                              *mMtx,
-                                              AsioBase<Executor, Allocator>::GetExecutor(),
-                                              AsioBase<Executor, Allocator>::GetAllocator(),
-                                              std::move(handler)
-                );
-
-                cc::Cmds const cmds(cc::make<cc::GetProperties>(id, query));
-                mDDSCustomCmd.send(cmds.Serialize(), path);
+                const uint64_t id = mRequestIds->Next();
+
+                Dispatch([this, id, query, path, timeout, handler = std::move(handler)]() mutable {
+                    std::lock_guard<TopoMutex> lk(*mMtx);
+
+                    ReapCompletedOps();
+
+                    auto [it, inserted] = mGetPropertiesOps.try_emplace(id,
+                                                                        id,
+                                                                        GetTaskSet(path),
+                                                                        timeout,
+                                                                        *mMtx,
+                                                                        *mTimers,
+                                                                        GetOpExecutor(),
+                                                                        AsioBase<Executor, Allocator>::GetAllocator(),
+                                                                        MakeOpHandler(std::move(handler))
+                    );
+                    it->second.SetCompletionCallback([this](uint64_t opId) { mCompletedOps.emplace_back(OpKind::GetProperties, opId); });
+
+                    cc::Cmds const cmds(cc::make<cc::GetProperties>(id, query));
+                    mDDSCustomCmd.send(cmds.Serialize(), path);
+                });
             },
             token);
     }
@@ -847,34 +1407,35 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     {
         return boost::asio::async_initiate<CompletionToken, SetPropertiesCompletionSignature>(
             [&](auto handler) {
-                const uint64_t id = uuidHash();
-
-                std::lock_guard<std::mutex> lk(*mMtx);
-
-                for (auto it = begin(mGetPropertiesOps); it != end(mGetPropertiesOps);) {
-                    if (it->second.IsCompleted()) {
-                        it = mGetPropertiesOps.erase(it);
-                    } else {
-                        ++it;
-                    }
-                }
-
-                auto [it, inserted] = mSetPropertiesOps.try_emplace(id,
-                                                                    id,
-                                                                    GetTasks(path),
-                                                                    timeout,
-                                                                    *mMtx,
-                                                                    AsioBase<Executor, Allocator>::GetExecutor(),
-                                                                    AsioBase<Executor, Allocator>::GetAllocator(),
-                                                                    std::move(handler)
-                );
-
-                cc::Cmds const cmds(cc::make<cc::SetProperties>(id, props));
-                mDDSCustomCmd.send(cmds.Serialize(), path);
-
-                it->second.ResetCount(mStateIndex, mStateData);
-                // TODO: make sure following operation properly queues the completion and not doing it directly out of initiation call.
-                it->second.TryCompletion();
+                const uint64_t id = mRequestIds->Next();
+
+                Dispatch([this, id, props, path, timeout, handler = std::move(handler)]() mutable {
+                    std::lock_guard<TopoMutex> lk(*mMtx);
+
+                    ReapCompletedOps();
+
+                    auto [it, inserted] = mSetPropertiesOps.try_emplace(id,
+                                                                        id,
+                                                                        GetTaskSet(path),
+                                                                        timeout,
+                                                                        *mMtx,
+                                                                        *mTimers,
+                                                                        GetOpExecutor(),
+                                                                        AsioBase<Executor, Allocator>::GetAllocator(),
+                                                                        MakeOpHandler(std::move(handler))
+                    );
+
+                    it->second.SetCompletionCallback([this](uint64_t opId) { mCompletedOps.emplace_back(OpKind::SetProperties, opId); });
+                    LinkOp(&TaskOps::setProperties, id, *(it->second.GetTaskSet()));
+
+                    cc::Cmds const cmds(cc::make<cc::SetProperties>(id, props));
+                    mDDSCustomCmd.send(cmds.Serialize(), path);
+
+                    it->second.ResetCount(mStateData);
+                    // TODO: make sure following operation properly queues the completion and not doing it directly out of initiation call.
+                    it->second.TryCompletion();
+                    ReapCompletedOps();
+                });
             },
             token);
     }
@@ -912,36 +1473,364 @@ class BasicTopology : public AsioBase<Executor, Allocator>
     std::chrono::milliseconds GetHeartbeatInterval() const { return mHeartbeatInterval; }
     void SetHeartbeatInterval(std::chrono::milliseconds duration) { mHeartbeatInterval = duration; }
 
+    TopoSerialization GetSerialization() const { return mSerialization; }
+
+    /// @brief Opt-in fail-fast policy for ChangeState and WaitForState operations initiated afterwards:
+    /// complete with an error as soon as a device fails that is neither expendable nor covered by its collection's nMin,
+    /// instead of waiting for all other devices or for the timeout
+    bool GetFailFast() const { return mFailFast; }
+    void SetFailFast(bool failFast) { mFailFast = failFast; }
+
+    /// @brief Opt-in quorum completion for ChangeState operations initiated afterwards: complete once nMin collections of
+    /// every collection with an nMin requirement (and all other tasks) reached the target state. The remaining
+    /// collections of those groups are ignored, as if they had failed.
+    bool GetQuorum() const { return mQuorum; }
+    void SetQuorum(bool quorum) { mQuorum = quorum; }
+
+    /// @brief Use the given generator for the ids of operations initiated afterwards (RequestIdGenerator::Default() otherwise)
+    /// The generator must outlive the topology.
+    void SetRequestIdGenerator(RequestIdGenerator& requestIds) { mRequestIds = &requestIds; }
+
   private:
+    /// In-flight operations that watch a task, so that device events only touch the operations that care
+    struct TaskOps
+    {
+        std::vector<uint64_t> changeState;
+        std::vector<uint64_t> waitForState;
+        std::vector<uint64_t> setProperties;
+    };
+
+    enum class OpKind
+    {
+        ChangeState,
+        WaitForState,
+        SetProperties,
+        GetProperties
+    };
+
     dds::tools_api::CSession& mDDSSession;
     dds::intercom_api::CIntercomService mDDSService;
     dds::intercom_api::CCustomCmd mDDSCustomCmd;
-    dds::topology_api::CTopology& mDDSTopo;
+    dds::topology_api::CTopology* mDDSTopo; ///< replaced by ApplyUpdate()
     dds::tools_api::SOnTaskDoneRequest::ptr_t mDDSOnTaskDoneRequest;
-    TopoState mStateData;
-    TopoStateIndex mStateIndex;
+    TopoStateStore mStateData;
+    TopoPathIndex mPathIndex; ///< runtime task paths, rebuilt by ApplyUpdate()
 
-    mutable std::unique_ptr<std::mutex> mMtx;
+    TopoSerialization mSerialization;
+    boost::asio::strand<Executor> mStrand;   ///< serializes all state access in strand mode
+    mutable std::unique_ptr<TopoMutex> mMtx; ///< guards the state in mutex mode, no-op in strand mode
+    std::unique_ptr<TopoTimerWheel> mTimers; ///< timeouts of all operations
 
-    std::unique_ptr<std::condition_variable> mStateChangeSubscriptionsCV;
-    unsigned int mNumStateChangePublishers;
+    /// Device commands received from DDS, waiting to be applied in batches by ApplyQueuedCmds()
+    struct CmdIngest
+    {
+        MPSCQueue<std::unique_ptr<cc::Cmd>> queue;
+        std::atomic<bool> applying{ false };
+        std::atomic<size_t> maxQueueDepth{ 0 };
+        std::atomic<uint64_t> numCmds{ 0 };
+        std::atomic<uint64_t> numBatches{ 0 };
+        std::atomic<size_t> maxBatchSize{ 0 };
+    };
+    static constexpr size_t kMaxCmdBatchSize = 1024; ///< bounds the time mMtx (or the strand) is held by one batch
+    std::unique_ptr<CmdIngest> mIngest;
+
+    /// Number of devices subscribed to state changes, see WaitForPublisherCount()
+    struct Publishers
+    {
+        std::mutex mtx;
+        std::condition_variable cv;
+        unsigned int count = 0;
+    };
+    std::unique_ptr<Publishers> mPublishers;
     boost::asio::steady_timer mHeartbeatsTimer;
     std::chrono::milliseconds mHeartbeatInterval;
-
-    std::unordered_map<uint64_t, ChangeStateOp<Executor, Allocator>> mChangeStateOps;
-    std::unordered_map<uint64_t, WaitForStateOp<Executor, Allocator>> mWaitForStateOps;
-    std::unordered_map<uint64_t, SetPropertiesOp<Executor, Allocator>> mSetPropertiesOps;
-    std::unordered_map<uint64_t, GetPropertiesOp<Executor, Allocator>> mGetPropertiesOps;
+    bool mFailFast = false;
+    bool mQuorum = false;
+    RequestIdGenerator* mRequestIds = &RequestIdGenerator::Default();
+
+    /// in-flight operations by request id, the nodes are allocated with the topology allocator
+    template<typename Op>
+    using OpMap = std::unordered_map<uint64_t, Op, std::hash<uint64_t>, std::equal_to<uint64_t>, TopoRebindAlloc<Allocator, std::pair<const uint64_t, Op>>>;
+
+    OpMap<ChangeStateOp<Executor, Allocator>> mChangeStateOps;
+    OpMap<WaitForStateOp<Executor, Allocator>> mWaitForStateOps;
+    OpMap<SetPropertiesOp<Executor, Allocator>> mSetPropertiesOps;
+    OpMap<GetPropertiesOp<Executor, Allocator>> mGetPropertiesOps;
+    std::unordered_map<std::string, TopoTaskSetPtr> mTaskSets; ///< path -> selected tasks, shared between ops on the same path
+    mutable std::unordered_map<std::string, TopoPathSelectionPtr> mPathSelections; ///< path -> matching tasks, incl. ignored ones
+    static constexpr size_t kMaxCachedPaths = 1024; ///< bounds the per-path caches for clients sending many distinct paths
+    std::vector<TaskOps> mOpsByTask; ///< task index in mStateData -> in-flight ops watching the task
+    std::vector<bool> mSubscriptionSent; ///< task index in mStateData -> state change subscription sent (subscribeOnActivation)
+    TopoTimerWheel::Id mResubscription = 0; ///< timeout re-sending unconfirmed subscriptions (subscribeOnActivation)
+    static constexpr Duration kResubscribeInterval = std::chrono::milliseconds(500); ///< doubled after each attempt
+    static constexpr Duration kMaxResubscribeInterval = std::chrono::seconds(8);
+    static constexpr int kMaxResubscriptions = 8;
+    std::vector<std::pair<OpKind, uint64_t>> mCompletedOps; ///< ops that completed since the last ReapCompletedOps()
+    std::unordered_map<uint64_t, TopoStateWatchPtr> mWatches; ///< state watches by id
 
     std::map<std::string, odc::core::CollectionInfo>& mCollectionInfo;
+    std::unordered_map<DDSCollection::Id, std::string> mCollectionNames; ///< runtime collection -> key in mCollectionInfo
     std::string mPartitionID;
     std::atomic<uint64_t>& mLastRunNr;
 
     // precodition: mMtx is locked.
-    TopoState GetCurrentStateUnsafe() const { return mStateData; }
+    TopoState GetCurrentStateUnsafe() const { return mStateData.ToTopoState(); }
+
+    /// @brief Queue the last state change of a device for the watches selecting it, delivered by FlushWatches()
+    // precondition: mMtx is locked.
+    void NotifyWatches(int index)
+    {
+        if (mWatches.empty()) {
+            return;
+        }
+        const TopoStateDelta delta{ mStateData.TaskId(index), mStateData.LastState(index), mStateData.State(index), mStateData.Version() };
+        for (auto& watch : mWatches) {
+            if (watch.second->Contains(index)) {
+                watch.second->Push(index, delta);
+            }
+        }
+    }
+
+    // precondition: mMtx is locked.
+    void FlushWatches()
+    {
+        for (auto& watch : mWatches) {
+            watch.second->Flush();
+        }
+    }
+
+    /// @brief Run f serialized with all other state access: inline in mutex mode (f locks mMtx itself),
+    /// on the strand in strand mode (inline if already running on it, queued otherwise)
+    template<typename F>
+    void Dispatch(F&& f) const
+    {
+        if (mSerialization == TopoSerialization::Strand) {
+            boost::asio::dispatch(mStrand, std::forward<F>(f));
+        } else {
+            f();
+        }
+    }
+
+    /// @brief Run f serialized with all other state access and return its result
+    /// In strand mode a call from outside the strand blocks until the strand has run f, exceptions are rethrown.
+    template<typename F>
+    auto Query(F&& f) const
+    {
+        if (mSerialization == TopoSerialization::Strand && !mStrand.running_in_this_thread()) {
+            std::packaged_task<std::invoke_result_t<F>()> task(std::forward<F>(f));
+            auto result = task.get_future();
+            boost::asio::dispatch(mStrand, std::move(task));
+            return result.get();
+        }
+        return f();
+    }
+
+    /// @brief Wrap the completion handler of an operation, posted to its executor in strand mode (see TopoDeferredHandler)
+    template<typename Handler>
+    auto MakeOpHandler(Handler&& handler) const
+    {
+        auto ex = boost::asio::get_associated_executor(handler, GetOpExecutor());
+        return TopoDeferredHandler<std::decay_t<Handler>, decltype(ex)>{ std::forward<Handler>(handler), std::move(ex), mSerialization == TopoSerialization::Strand };
+    }
+
+    /// @brief Executor for operation timers and completions, the strand in strand mode
+    Executor GetOpExecutor() const
+    {
+        if constexpr (std::is_constructible_v<Executor, boost::asio::strand<Executor>>) {
+            if (mSerialization == TopoSerialization::Strand) {
+                return Executor(mStrand);
+            }
+        }
+        return AsioBase<Executor, Allocator>::GetExecutor();
+    }
+
+    /// @brief Change the number of state change publishers and wake up WaitForPublisherCount()
+    // precondition: mMtx is locked.
+    void AddPublishers(int delta)
+    {
+        {
+            std::lock_guard<std::mutex> lk(mPublishers->mtx);
+            mPublishers->count += delta;
+        }
+        mPublishers->cv.notify_all();
+    }
+
+    static std::vector<DDSTask::Id> RuntimeTaskIds(dds::topology_api::CTopology& topo)
+    {
+        std::vector<DDSTask::Id> taskIds;
+        auto itPair = topo.getRuntimeTaskIterator(nullptr);
+        for (const auto& [id, task] : boost::make_iterator_range(itPair.first, itPair.second)) {
+            taskIds.push_back(id);
+        }
+        return taskIds;
+    }
+
+    /// @brief Track the tasks of mDDSTopo that are not tracked yet and index the paths of all of them
+    // precondition: mMtx is locked, mPathIndex is empty.
+    void IndexTasks(const std::unordered_set<uint64_t>& expendableTasks)
+    {
+        auto itPair = mDDSTopo->getRuntimeTaskIterator(nullptr);
+        for (const auto& [id, task] : boost::make_iterator_range(itPair.first, itPair.second)) {
+            int index = mStateData.Find(id);
+            if (index < 0) {
+                index = mStateData.Add(id, task.m_taskCollectionId, expendableTasks.find(id) != expendableTasks.end());
+            }
+            mPathIndex.Add(task.m_taskPath, index);
+            if (task.m_taskCollectionId != 0 && !mCollectionInfo.empty() && mCollectionNames.count(task.m_taskCollectionId) == 0) {
+                mCollectionNames.emplace(task.m_taskCollectionId, mDDSTopo->getRuntimeCollectionById(task.m_taskCollectionId).m_collection->getName());
+            }
+        }
+        mPathIndex.Build();
+        mOpsByTask.assign(mStateData.Size(), TaskOps());
+    }
+
+    // precondition: mMtx is locked.
+    void UnsubscribeTask(int index)
+    {
+        if (mStateData.Subscribed(index)) {
+            mStateData.SetSubscribed(index, false);
+            AddPublishers(-1);
+        }
+    }
+
+    // precondition: mMtx is locked.
+    void IgnoreTask(int index)
+    {
+        UnsubscribeTask(index);
+        mStateData.SetIgnored(index);
+    }
+
+    // precondition: mMtx is locked.
+    void IgnoreCollections(const std::vector<DDSCollection::Id>& collections)
+    {
+        const std::unordered_set<DDSCollection::Id> ids(collections.begin(), collections.end());
+        for (size_t i = 0; i < mStateData.Size(); ++i) {
+            if (ids.count(mStateData.CollectionId(i)) > 0) {
+                IgnoreTask(i);
+            }
+        }
+        mTaskSets.clear();
+    }
+
+    /// @brief Quorum requirement for a ChangeState on the given tasks, none if they contain no collection with nMin
+    // precondition: mMtx is locked.
+    std::optional<TopoQuorum> MakeQuorum(const TopoTaskSet& tasks) const
+    {
+        TopoQuorum quorum;
+        std::unordered_map<std::string, size_t> groups; // collection name -> index in quorum.groups
+        std::vector<unsigned int> numCollections;
+        for (const int index : tasks.Indices()) {
+            const DDSCollection::Id collectionId = mStateData.CollectionId(index);
+            auto name = mCollectionNames.find(collectionId);
+            auto info = name == mCollectionNames.end() ? mCollectionInfo.end() : mCollectionInfo.find(name->second);
+            if (info == mCollectionInfo.end() || info->second.nMin <= 0) {
+                ++quorum.numOther;
+                continue;
+            }
+            auto [group, newGroup] = groups.try_emplace(info->first, quorum.groups.size());
+            if (newGroup) {
+                quorum.groups.push_back(TopoQuorum::Group{ static_cast<unsigned int>(info->second.nMin), 0 });
+                numCollections.push_back(0);
+            }
+            auto [collection, newCollection] = quorum.collections.try_emplace(collectionId, TopoQuorum::Collection{ group->second, 0, 0, false });
+            if (newCollection) {
+                ++numCollections[group->second];
+            }
+            ++collection->second.numTasks;
+        }
+        if (quorum.collections.empty()) {
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < quorum.groups.size(); ++i) {
+            quorum.groups[i].required = std::min(quorum.groups[i].required, numCollections[i]);
+        }
+        return quorum;
+    }
+
+    // precondition: mMtx is locked.
+    void IgnoreStragglers(const std::vector<DDSCollection::Id>& stragglers)
+    {
+        for (const auto collectionId : stragglers) {
+            auto& info = mCollectionInfo.at(mCollectionNames.at(collectionId));
+            info.nCurrent--;
+            OLOG(info, mPartitionID, mLastRunNr.load()) << "Quorum reached, ignoring straggling collection '" << info.name << "' (id: " << collectionId << ")"
+                << ", remaining number of collections: " << info.nCurrent << ", nMin: " << info.nMin;
+        }
+        IgnoreCollections(stragglers);
+    }
+
+    // precondition: mMtx is locked.
+    void LinkOp(std::vector<uint64_t> TaskOps::*ops, uint64_t id, const TopoTaskSet& tasks)
+    {
+        for (const int index : tasks.Indices()) {
+            (mOpsByTask[index].*ops).push_back(id);
+        }
+    }
+
+    // precondition: mMtx is locked.
+    void UnlinkOp(std::vector<uint64_t> TaskOps::*ops, uint64_t id, const TopoTaskSet& tasks)
+    {
+        for (const int index : tasks.Indices()) {
+            auto& taskOps = mOpsByTask[index].*ops;
+            auto it = std::find(taskOps.begin(), taskOps.end(), id);
+            if (it != taskOps.end()) {
+                *it = taskOps.back();
+                taskOps.pop_back();
+            }
+        }
+    }
+
+    // precondition: mMtx is locked.
+    template<typename Ops>
+    void ReapOp(Ops& ops, std::vector<uint64_t> TaskOps::*taskOps, uint64_t id)
+    {
+        auto it = ops.find(id);
+        if (it != ops.end()) {
+            UnlinkOp(taskOps, id, *(it->second.GetTaskSet()));
+            ops.erase(it);
+        }
+    }
+
+    /// @brief Unlink completed operations from the per-task index and release them.
+    /// Called at the end of each event dispatch and operation initiation, i.e. never from within an operation.
+    /// Operations completed by a timeout are reaped on the next event or initiation.
+    // precondition: mMtx is locked.
+    void ReapCompletedOps()
+    {
+        for (const auto& [kind, id] : mCompletedOps) {
+            switch (kind) {
+                case OpKind::ChangeState:
+                    ReapOp(mChangeStateOps, &TaskOps::changeState, id);
+                    break;
+                case OpKind::WaitForState:
+                    ReapOp(mWaitForStateOps, &TaskOps::waitForState, id);
+                    break;
+                case OpKind::SetProperties:
+                    ReapOp(mSetPropertiesOps, &TaskOps::setProperties, id);
+                    break;
+                case OpKind::GetProperties:
+                    mGetPropertiesOps.erase(id);
+                    break;
+            }
+        }
+        mCompletedOps.clear();
+    }
+
+    // precondition: mMtx is locked.
+    void CancelChangeStateOps()
+    {
+        for (auto& op : mChangeStateOps) {
+            if (!op.second.IsCompleted()) {
+                op.second.Complete(MakeErrorCode(ErrorCode::OperationCanceled));
+            }
+        }
+        ReapCompletedOps();
+    }
 };
 
 using Topology = BasicTopology<DefaultExecutor, DefaultAllocator>;
+/// Topology allocating its operations from a memory resource, see TopoPoolAllocator
+using PooledTopology = BasicTopology<DefaultExecutor, TopoPoolAllocator>;
 
 } // namespace odc::core
 
@@ -0,0 +1,57 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYALLOCATOR
+#define ODC_TOPOLOGYALLOCATOR
+
+#include <odc/TopologyDefs.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+
+namespace odc::core
+{
+
+/**
+ * @brief Pool allocator for BasicTopology
+ *
+ * Allocates the operation storage (op map nodes, async op state incl. the completion handler) and the per-operation
+ * device sets of a topology from a memory resource, typically a std::pmr::synchronized_pool_resource. Completed
+ * operations return their memory to the pool, so a steady stream of requests does not hit the global heap for them.
+ * The resource must outlive the topology.
+ */
+using TopoPoolAllocator = std::pmr::polymorphic_allocator<std::byte>;
+
+template<typename Allocator, typename T>
+using TopoRebindAlloc = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+
+/// Device set of an operation, allocated with the allocator of the topology
+template<typename Allocator>
+using TopoFailedDevices = std::unordered_set<DDSTask::Id, std::hash<DDSTask::Id>, std::equal_to<DDSTask::Id>, TopoRebindAlloc<Allocator, DDSTask::Id>>;
+
+/// @brief Convert a device set of an operation to the FailedDevices of the completion signature (moved if the types match)
+template<typename Set>
+FailedDevices ToFailedDevices(Set&& devices)
+{
+    if constexpr (std::is_same_v<std::decay_t<Set>, FailedDevices> && !std::is_lvalue_reference_v<Set>) {
+        return std::move(devices);
+    } else if (devices.empty()) {
+        return FailedDevices();
+    } else {
+        return FailedDevices(devices.begin(), devices.end());
+    }
+}
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYALLOCATOR */
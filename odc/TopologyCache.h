@@ -0,0 +1,175 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYCACHE
+#define ODC_TOPOLOGYCACHE
+
+#include <odc/DDSSubmit.h>
+#include <odc/MiscUtils.h>
+#include <odc/TopologyDefs.h>
+
+#include <dds/Topology.h>
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace odc::core
+{
+
+/// Requirements extracted from a topology file
+struct TopologyRequirements
+{
+    std::map<std::string, CollectionNInfo> mNinfo; ///< minimum number of collections, by collection name
+    std::map<std::string, std::vector<ZoneGroup>> mZoneInfo; ///< zoneName:vector<ZoneGroup>
+    std::unordered_map<std::string, AgentGroupInfo> mAgentGroupInfo; ///< groupName:AgentGroupInfo
+    std::vector<TaskInfo> mStandaloneTasks; ///< tasks not belonging to any collection
+    std::map<std::string, CollectionInfo> mCollections; ///< collectionName:CollectionInfo
+    std::unordered_set<uint64_t> mExpendableTasks; ///< expendable task IDs
+};
+
+/// Parsed topology file: the DDS topology and the requirements extracted from it. Immutable once cached.
+struct ParsedTopology
+{
+    std::shared_ptr<dds::topology_api::CTopology> mDDSTopo;
+    TopologyRequirements mRequirements;
+};
+
+using ParsedTopologyPtr = std::shared_ptr<const ParsedTopology>;
+
+/**
+ * @brief Cache of parsed topologies, keyed by the content of the topology file
+ *
+ * Activating the same topology again (in the following runs, or in another partition) reuses the parsed DDS topology
+ * and the extracted requirements instead of parsing the XML again. A lookup reads and hashes the file, which is cheap
+ * compared to parsing it. Entries keep the file content and a hit compares it, so hash collisions are misses. The
+ * least recently used entries are dropped beyond the capacity; sessions keep their entry alive as long as they use it.
+ */
+class TopologyCache
+{
+  public:
+    using Parser = std::function<void(const std::string& topoFilePath, ParsedTopology& parsed)>;
+
+    /// @param capacity number of parsed topologies to keep
+    explicit TopologyCache(size_t capacity = 8)
+        : mCapacity(capacity)
+    {}
+
+    TopologyCache(const TopologyCache&) = delete;
+    TopologyCache& operator=(const TopologyCache&) = delete;
+
+    /// @brief Get the parsed topology for the current content of the file, parse it on a miss
+    /// @param parse fills the ParsedTopology from the file, called without the cache locked
+    /// @param hit set to true if the topology was taken from the cache
+    ParsedTopologyPtr get(const std::string& topoFilePath, const Parser& parse, bool& hit)
+    {
+        std::string content = readFile(topoFilePath);
+        const Key key{ content.size(), std::hash<std::string_view>()(content) };
+        {
+            std::lock_guard<std::mutex> lk(mMtx);
+            if (auto entry = find(key, content); entry != nullptr) {
+                hit = true;
+                return entry;
+            }
+        }
+
+        auto parsed = std::make_shared<ParsedTopology>();
+        parse(topoFilePath, *parsed);
+
+        std::lock_guard<std::mutex> lk(mMtx);
+        // another request may have parsed the same content in the meantime
+        if (auto entry = find(key, content); entry != nullptr) {
+            hit = true;
+            return entry;
+        }
+        hit = false;
+        mEntries.push_front(Entry{ key, std::move(content), parsed });
+        while (mEntries.size() > mCapacity) {
+            mEntries.pop_back();
+        }
+        return parsed;
+    }
+
+    /// @brief Change the number of parsed topologies to keep, 0 disables the cache
+    void setCapacity(size_t capacity)
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        mCapacity = capacity;
+        while (mEntries.size() > mCapacity) {
+            mEntries.pop_back();
+        }
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        return mEntries.size();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        mEntries.clear();
+    }
+
+  private:
+    struct Key
+    {
+        size_t size; ///< content length
+        uint64_t hash; ///< content hash
+        bool operator==(const Key& other) const { return size == other.size && hash == other.hash; }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::string content; ///< compared on a hit
+        ParsedTopologyPtr topo;
+    };
+
+    mutable std::mutex mMtx;
+    size_t mCapacity;
+    std::list<Entry> mEntries; ///< most recently used first
+
+    static std::string readFile(const std::string& topoFilePath)
+    {
+        std::ifstream file(topoFilePath, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error(toString("Failed to open topology file ", std::quoted(topoFilePath)));
+        }
+        return std::string{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    }
+
+    // precondition: mMtx is locked.
+    ParsedTopologyPtr find(const Key& key, const std::string& content)
+    {
+        for (auto it = mEntries.begin(); it != mEntries.end(); ++it) {
+            if (it->key == key && it->content == content) {
+                mEntries.splice(mEntries.begin(), mEntries, it);
+                return mEntries.front().topo;
+            }
+        }
+        return nullptr;
+    }
+};
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYCACHE */
@@ -15,6 +15,8 @@
 #include <algorithm>
 #include <chrono>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <string>
@@ -217,8 +219,25 @@ struct GetPropertiesResult
     FailedDevices failed;
 };
 
+/// Counters of the device command ingest queue of a topology
+struct CmdIngestStats
+{
+    size_t queueDepth = 0;    ///< commands currently waiting to be applied
+    size_t maxQueueDepth = 0; ///< highest queue depth seen by the applier
+    uint64_t numCmds = 0;     ///< total number of applied commands
+    uint64_t numBatches = 0;  ///< total number of batches (one lock acquisition each)
+    size_t maxBatchSize = 0;  ///< largest batch applied so far
+};
+
+/// Difference between the devices of a topology and the tasks of an updated DDS topology
+struct TopoDiff
+{
+    std::vector<DDSTask::Id> removed; ///< devices that are not part of the updated topology
+    std::vector<DDSTask::Id> added;   ///< tasks of the updated topology that are not tracked yet
+    bool Empty() const { return removed.empty() && added.empty(); }
+};
+
 using TopoState = std::vector<DeviceStatus>;
-using TopoStateIndex = std::unordered_map<DDSTask::Id, int>; //  task id -> index in the data vector
 using TopoStateByTask = std::unordered_map<DDSTask::Id, DeviceStatus>;
 using TopoStateByCollection = std::unordered_map<DDSCollection::Id, std::vector<DeviceStatus>>;
 using TopoTransition = fair::mq::Transition;
@@ -230,16 +249,14 @@ inline AggregatedState AggregateState(const TopoState& topoState)
     // get the state of a first not-ignored device
     for (const auto& ds : topoState) {
         if (!ds.ignored) {
-            if (state == AggregatedState::Mixed) {
+            if (ds.state == DeviceState::Error) {
+                // if any device is in error state and it is not ignored, the whole topology is in the error state
+                return AggregatedState::Error;
+            } else if (state == AggregatedState::Mixed) {
                 // first assignment
                 state = static_cast<AggregatedState>(ds.state);
-            } else {
-                if (ds.state == DeviceState::Error) {
-                    // if any device is in error state and it is not ignored, the whole topology is in the error state
-                    return AggregatedState::Error;
-                } else if (static_cast<AggregatedState>(ds.state) != state) {
-                    homogeneous = false;
-                }
+            } else if (static_cast<AggregatedState>(ds.state) != state) {
+                homogeneous = false;
             }
         }
     }
@@ -277,6 +294,42 @@ inline TopoStateByTask GroupByTaskId(const TopoState& topoState)
 
 using Duration = std::chrono::microseconds;
 
+/// How a topology serializes access to its state
+enum class TopoSerialization
+{
+    Mutex, ///< state is guarded by a mutex, DDS callbacks and operation timers take it
+    Strand ///< state is only touched from a strand of the topology executor, no locking
+};
+
+/// Mutex guarding the topology state, a no-op when the state is serialized by a strand instead
+class TopoMutex
+{
+  public:
+    explicit TopoMutex(bool enabled = true)
+        : mEnabled(enabled)
+    {}
+
+    void lock()
+    {
+        if (mEnabled) {
+            mMtx.lock();
+        }
+    }
+    void unlock()
+    {
+        if (mEnabled) {
+            mMtx.unlock();
+        }
+    }
+    bool try_lock() { return !mEnabled || mMtx.try_lock(); }
+
+    bool Enabled() const { return mEnabled; }
+
+  private:
+    std::mutex mMtx;
+    const bool mEnabled;
+};
+
 struct TaskDetails
 {
     uint64_t mAgentID = 0;       ///< Agent ID
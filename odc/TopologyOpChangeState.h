@@ -11,9 +11,10 @@
 
 #include <odc/AsioAsyncOp.h>
 #include <odc/Error.h>
+#include <odc/TopologyAllocator.h>
 #include <odc/TopologyDefs.h>
-
-#include <boost/asio/steady_timer.hpp>
+#include <odc/TopologyStateStore.h>
+#include <odc/TopologyTimerWheel.h>
 
 #include <dds/Tools.h>
 #include <dds/Topology.h>
@@ -22,13 +23,91 @@
 #include <chrono>
 #include <functional>
 #include <mutex>
+#include <optional>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace odc::core
 {
 
-using ChangeStateCompletionSignature = void(std::error_code, TopoState);
+using ChangeStateCompletionSignature = void(std::error_code, TopoStateSnapshotPtr);
+
+/**
+ * @brief Quorum completion requirement of a ChangeStateOp
+ *
+ * Collections with an nMin requirement are grouped by collection name. Of each group only nMin collections have to
+ * reach the target state, all other selected tasks have to reach it as usual. Collections that did not make it by then
+ * (stragglers) are handed to the op owner to be ignored.
+ */
+struct TopoQuorum
+{
+    struct Group
+    {
+        unsigned int required = 0; ///< collections that have to reach the target state, nMin (or less for a partial selection)
+        unsigned int reached = 0;  ///< collections that reached it
+    };
+
+    struct Collection
+    {
+        size_t group = 0;
+        unsigned int numTasks = 0; ///< selected tasks of the collection
+        unsigned int pending = 0;  ///< selected tasks not yet in the target state
+        bool failed = false;
+    };
+
+    std::vector<Group> groups;
+    std::unordered_map<DDSCollection::Id, Collection> collections;
+    unsigned int numOther = 0;     ///< selected tasks outside of the quorum collections
+    unsigned int otherPending = 0; ///< of those, tasks not yet in the target state
+
+    void Reset()
+    {
+        for (auto& group : groups) {
+            group.reached = 0;
+        }
+        for (auto& [id, collection] : collections) {
+            collection.pending = collection.numTasks;
+            collection.failed = false;
+        }
+        otherPending = numOther;
+    }
+
+    /// @brief Count a task of the selection that reached the target state (or failed)
+    void Count(DDSCollection::Id collectionId, bool reachedTarget)
+    {
+        auto it = collections.find(collectionId);
+        if (it == collections.end()) {
+            if (otherPending > 0) {
+                --otherPending;
+            }
+            return;
+        }
+        Collection& collection = it->second;
+        if (!reachedTarget) {
+            collection.failed = true;
+        } else if (collection.pending > 0 && --collection.pending == 0 && !collection.failed) {
+            ++groups[collection.group].reached;
+        }
+    }
+
+    bool Reached() const
+    {
+        return otherPending == 0 && std::all_of(groups.begin(), groups.end(), [](const Group& g) { return g.reached >= g.required; });
+    }
+
+    /// @return collections that neither reached the target state nor failed
+    std::vector<DDSCollection::Id> Stragglers() const
+    {
+        std::vector<DDSCollection::Id> stragglers;
+        for (const auto& [id, collection] : collections) {
+            if (collection.pending > 0 && !collection.failed) {
+                stragglers.push_back(id);
+            }
+        }
+        return stragglers;
+    }
+};
 
 template<typename Executor, typename Allocator>
 struct ChangeStateOp
@@ -36,35 +115,34 @@ struct ChangeStateOp
     template<typename Handler>
     ChangeStateOp(uint64_t id,
                   TopoTransition transition,
-                  std::vector<DDSTask> tasks,
-                  TopoState& stateData,
+                  TopoTaskSetPtr tasks,
+                  const TopoStateStore& stateData,
                   Duration timeout,
-                  std::mutex& mutex,
+                  TopoMutex& mutex,
+                  TopoTimerWheel& timers,
                   Executor const& ex,
                   Allocator const& alloc,
                   Handler&& handler)
         : mId(id)
         , mOp(ex, alloc, std::move(handler))
         , mStateData(stateData)
-        , mTimer(ex)
+        , mTimers(timers)
         , mCount(0)
         , mTasks(std::move(tasks))
+        , mFailed(alloc)
         , mTargetState(gExpectedState.at(transition))
         , mMtx(mutex)
     {
         if (timeout > std::chrono::milliseconds(0)) {
-            mTimer.expires_after(timeout);
-            mTimer.async_wait([&](std::error_code ec) {
-                if (!ec) {
-                    std::lock_guard<std::mutex> lk(mMtx);
-                    mOp.Timeout(mStateData);
-                }
+            mTimeout = mTimers.Add(timeout, [this]() {
+                mOp.Timeout(mStateData.Snapshot());
+                NotifyCompletion();
             });
         }
-        if (mTasks.empty()) {
+        if (mTasks->Empty()) {
             OLOG(warning) << "ChangeState initiated on an empty set of tasks, check the path argument.";
         }
-        // OLOG(debug) << "SetProperties " << mId << " with expected count of " << mTasks.size() << " started.";
+        // OLOG(debug) << "ChangeState " << mId << " with expected count of " << mTasks->Size() << " started.";
     }
     ChangeStateOp() = delete;
     ChangeStateOp(const ChangeStateOp&) = delete;
@@ -74,38 +152,40 @@ struct ChangeStateOp
     ~ChangeStateOp() = default;
 
     /// precondition: mMtx is locked.
-    void ResetCount(const TopoStateIndex& stateIndex, const TopoState& stateData)
+    void ResetCount(const TopoStateStore& stateData)
     {
-        mCount = std::count_if(stateIndex.cbegin(), stateIndex.cend(), [=](const auto& s) {
-            const auto& task = stateData.at(s.second);
-            if (ContainsTask(task.taskId)) {
-                if (task.state == mTargetState) {
-                    return true;
-                } else {
-                    // Do not wait for an errored/exited device that is not yet ignored
-                    if (task.state == DeviceState::Error || task.state == DeviceState::Exiting) {
-                        mErrored = true;
-                        return true;
-                    } else {
-                        return false;
-                    }
-                }
-            } else {
-                return false;
+        mCount = 0;
+        if (mQuorum) {
+            mQuorum->Reset();
+        }
+        for (const int index : mTasks->Indices()) {
+            const DeviceState state = stateData.State(index);
+            if (state == mTargetState) {
+                ++mCount;
+                CountQuorum(index, true);
+            } else if (state == DeviceState::Error || state == DeviceState::Exiting) {
+                // Do not wait for an errored/exited device that is not yet ignored
+                mErrored = true;
+                ++mCount;
+                CountQuorum(index, false);
             }
-        });
+        }
     }
 
     /// precondition: mMtx is locked.
-    void Update(const DDSTask::Id taskId, const DeviceState currentState, bool expendable)
+    void Update(const int index, const DDSTask::Id taskId, const DeviceState currentState, bool expendable)
     {
-        if (!mOp.IsCompleted() && ContainsTask(taskId)) {
+        if (!mOp.IsCompleted() && ContainsTask(index)) {
             if (currentState == mTargetState) {
                 ++mCount;
+                CountQuorum(index, true);
             } else if (currentState == DeviceState::Error || currentState == DeviceState::Exiting) {
                 if (mFailed.count(taskId) == 0) {
-                    mErrored = expendable ? false : true;
+                    if (!expendable) {
+                        mErrored = true;
+                    }
                     ++mCount;
+                    CountQuorum(index, false);
                     mFailed.emplace(taskId);
                 } else {
                     // OLOG(debug) << "Task " << taskId << " is already in the set of failed devices";
@@ -118,44 +198,91 @@ struct ChangeStateOp
     /// precondition: mMtx is locked.
     void TryCompletion()
     {
-        if (!mOp.IsCompleted() && mCount == mTasks.size()) {
+        if (mOp.IsCompleted()) {
+            return;
+        }
+        if (mCount == mTasks->Size() || (mFailFast && mErrored)) {
             if (mErrored) {
                 Complete(MakeErrorCode(ErrorCode::DeviceChangeStateFailed));
             } else {
                 Complete(std::error_code());
             }
+        } else if (mQuorum && mQuorum->Reached()) {
+            if (mErrored) {
+                Complete(MakeErrorCode(ErrorCode::DeviceChangeStateFailed));
+            } else {
+                if (mOnStragglers) {
+                    mOnStragglers(mQuorum->Stragglers());
+                }
+                Complete(std::error_code());
+            }
         }
     }
 
     /// precondition: mMtx is locked.
     void Complete(std::error_code ec)
     {
-        mTimer.cancel();
-        mOp.Complete(ec, mStateData);
+        mTimers.Cancel(mTimeout);
+        mOp.Complete(ec, mStateData.Snapshot());
+        NotifyCompletion();
     }
 
+    /// @param index index of the task in TopoStateStore
+    bool ContainsTask(int index) const { return mTasks->Contains(index); }
+    const TopoTaskSetPtr& GetTaskSet() const { return mTasks; }
+
+    bool IsCompleted() { return mOp.IsCompleted(); }
+
+    /// @brief Set a callback to be called (with mMtx locked) once the operation completes, including timeouts
     /// precondition: mMtx is locked.
-    bool ContainsTask(DDSTask::Id id)
+    void SetCompletionCallback(std::function<void(uint64_t)> cb) { mOnCompletion = std::move(cb); }
+
+    /// @brief Complete with an error as soon as a non-ignorable device failure makes success impossible,
+    /// instead of waiting for the remaining devices (or the timeout)
+    void SetFailFast(bool failFast) { mFailFast = failFast; }
+
+    /// @brief Complete once the quorum is reached, the stragglers are passed to onStragglers (with mMtx locked) to be ignored
+    /// precondition: mMtx is locked, ResetCount() has not been called yet.
+    void SetQuorum(TopoQuorum quorum, std::function<void(const std::vector<DDSCollection::Id>&)> onStragglers)
     {
-        auto it = std::find_if(mTasks.begin(), mTasks.end(), [id](const DDSTask& t) { return t.GetId() == id; });
-        return it != mTasks.end();
+        mQuorum = std::move(quorum);
+        mOnStragglers = std::move(onStragglers);
     }
 
-    bool IsCompleted() { return mOp.IsCompleted(); }
-
     DeviceState GetTargetState() const { return mTargetState; }
 
   private:
     const uint64_t mId;
     AsioAsyncOp<Executor, Allocator, ChangeStateCompletionSignature> mOp;
-    TopoState& mStateData;
-    boost::asio::steady_timer mTimer;
+    const TopoStateStore& mStateData;
+    TopoTimerWheel& mTimers;
+    TopoTimerWheel::Id mTimeout = 0;
     unsigned int mCount;
-    std::vector<DDSTask> mTasks;
-    FailedDevices mFailed;
+    TopoTaskSetPtr mTasks;
+    TopoFailedDevices<Allocator> mFailed;
     DeviceState mTargetState;
-    std::mutex& mMtx;
+    TopoMutex& mMtx;
+    std::function<void(uint64_t)> mOnCompletion;
     bool mErrored = false;
+    bool mFailFast = false;
+    std::optional<TopoQuorum> mQuorum;
+    std::function<void(const std::vector<DDSCollection::Id>&)> mOnStragglers;
+
+    /// precondition: mMtx is locked.
+    void CountQuorum(int index, bool reachedTarget)
+    {
+        if (mQuorum) {
+            mQuorum->Count(mStateData.CollectionId(index), reachedTarget);
+        }
+    }
+
+    /// precondition: mMtx is locked.
+    void NotifyCompletion()
+    {
+        if (mOnCompletion) {
+            mOnCompletion(mId);
+        }
+    }
 };
 
 } // namespace odc::core
@@ -11,9 +11,10 @@
 
 #include <odc/AsioAsyncOp.h>
 #include <odc/Error.h>
+#include <odc/TopologyAllocator.h>
 #include <odc/TopologyDefs.h>
-
-#include <boost/asio/steady_timer.hpp>
+#include <odc/TopologyStateStore.h>
+#include <odc/TopologyTimerWheel.h>
 
 #include <dds/Tools.h>
 #include <dds/Topology.h>
@@ -35,38 +36,38 @@ struct GetPropertiesOp
 {
     template<typename Handler>
     GetPropertiesOp(uint64_t id,
-                    std::vector<DDSTask> tasks,
+                    TopoTaskSetPtr tasks,
                     Duration timeout,
-                    std::mutex& mutex,
+                    TopoMutex& mutex,
+                    TopoTimerWheel& timers,
                     Executor const& ex,
                     Allocator const& alloc,
                     Handler&& handler)
         : mId(id)
         , mOp(ex, alloc, std::move(handler))
-        , mTimer(ex)
+        , mTimers(timers)
         , mCount(0)
         , mTasks(std::move(tasks))
+        , mOutstandingDevices(alloc)
         , mMtx(mutex)
     {
         if (timeout > std::chrono::milliseconds(0)) {
-            mTimer.expires_after(timeout);
-            mTimer.async_wait([&](std::error_code ec) {
-                if (!ec) {
-                    std::lock_guard<std::mutex> lk(mMtx);
-                    mOp.Timeout(mResult);
-                }
+            mTimeout = mTimers.Add(timeout, [this]() {
+                mOp.Timeout(TakeResult());
+                NotifyCompletion();
             });
         }
-        if (mTasks.empty()) {
+        if (mTasks->Empty()) {
             OLOG(warning) << "GetProperties initiated on an empty set of tasks, check the path argument.";
         }
 
-        mResult.failed.reserve(mTasks.size());
-        for (const auto& task : mTasks) {
-            mResult.failed.emplace(task.GetId());
+        mOutstandingDevices.reserve(mTasks->Size());
+        mResult.devices.reserve(mTasks->Size());
+        for (const auto& task : mTasks->Tasks()) {
+            mOutstandingDevices.emplace(task.GetId());
         }
 
-        // OLOG(debug) << "GetProperties " << mId << " with expected count of " << mTasks.size() << " started.";
+        // OLOG(debug) << "GetProperties " << mId << " with expected count of " << mTasks->Size() << " started.";
     }
     GetPropertiesOp() = delete;
     GetPropertiesOp(const GetPropertiesOp&) = delete;
@@ -79,7 +80,7 @@ struct GetPropertiesOp
     void Update(const DDSTask::Id taskId, cc::Result result, DeviceProperties props)
     {
         if (result == cc::Result::Ok) {
-            mResult.failed.erase(taskId);
+            mOutstandingDevices.erase(taskId);
             mResult.devices.insert({ taskId, { std::move(props) } });
         }
         ++mCount;
@@ -88,25 +89,47 @@ struct GetPropertiesOp
 
     bool IsCompleted() { return mOp.IsCompleted(); }
 
+    /// @brief Set a callback to be called (with mMtx locked) once the operation completes, including timeouts
+    /// precondition: mMtx is locked.
+    void SetCompletionCallback(std::function<void(uint64_t)> cb) { mOnCompletion = std::move(cb); }
+
   private:
     const uint64_t mId;
     AsioAsyncOp<Executor, Allocator, GetPropertiesCompletionSignature> mOp;
-    boost::asio::steady_timer mTimer;
+    TopoTimerWheel& mTimers;
+    TopoTimerWheel::Id mTimeout = 0;
     unsigned int mCount;
-    std::vector<DDSTask> mTasks;
+    TopoTaskSetPtr mTasks;
+    TopoFailedDevices<Allocator> mOutstandingDevices; ///< devices without a successful reply so far
     GetPropertiesResult mResult;
-    std::mutex& mMtx;
+    TopoMutex& mMtx;
+    std::function<void(uint64_t)> mOnCompletion;
 
     /// precondition: mMtx is locked.
     void TryCompletion()
     {
-        if (!mOp.IsCompleted() && mCount == mTasks.size()) {
-            mTimer.cancel();
-            if (!mResult.failed.empty()) {
-                mOp.Complete(MakeErrorCode(ErrorCode::DeviceGetPropertiesFailed), std::move(mResult));
+        if (!mOp.IsCompleted() && mCount == mTasks->Size()) {
+            mTimers.Cancel(mTimeout);
+            if (!mOutstandingDevices.empty()) {
+                mOp.Complete(MakeErrorCode(ErrorCode::DeviceGetPropertiesFailed), TakeResult());
             } else {
-                mOp.Complete(std::move(mResult));
+                mOp.Complete(TakeResult());
             }
+            NotifyCompletion();
+        }
+    }
+
+    GetPropertiesResult TakeResult()
+    {
+        mResult.failed = ToFailedDevices(std::move(mOutstandingDevices));
+        return std::move(mResult);
+    }
+
+    /// precondition: mMtx is locked.
+    void NotifyCompletion()
+    {
+        if (mOnCompletion) {
+            mOnCompletion(mId);
         }
     }
 };
@@ -11,9 +11,10 @@
 
 #include <odc/AsioAsyncOp.h>
 #include <odc/Error.h>
+#include <odc/TopologyAllocator.h>
 #include <odc/TopologyDefs.h>
-
-#include <boost/asio/steady_timer.hpp>
+#include <odc/TopologyStateStore.h>
+#include <odc/TopologyTimerWheel.h>
 
 #include <dds/Tools.h>
 #include <dds/Topology.h>
@@ -35,32 +36,31 @@ struct SetPropertiesOp
 {
     template<typename Handler>
     SetPropertiesOp(uint64_t id,
-                    std::vector<DDSTask> tasks,
+                    TopoTaskSetPtr tasks,
                     Duration timeout,
-                    std::mutex& mutex,
+                    TopoMutex& mutex,
+                    TopoTimerWheel& timers,
                     Executor const& ex,
                     Allocator const& alloc,
                     Handler&& handler)
         : mId(id)
         , mOp(ex, alloc, std::move(handler))
-        , mTimer(ex)
+        , mTimers(timers)
         , mCount(0)
         , mTasks(std::move(tasks))
+        , mOutstandingDevices(alloc)
         , mMtx(mutex)
     {
         if (timeout > std::chrono::milliseconds(0)) {
-            mTimer.expires_after(timeout);
-            mTimer.async_wait([&](std::error_code ec) {
-                if (!ec) {
-                    std::lock_guard<std::mutex> lk(mMtx);
-                    mOp.Timeout(mOutstandingDevices);
-                }
+            mTimeout = mTimers.Add(timeout, [this]() {
+                mOp.Timeout(ToFailedDevices(std::move(mOutstandingDevices)));
+                NotifyCompletion();
             });
         }
-        if (mTasks.empty()) {
+        if (mTasks->Empty()) {
             OLOG(warning) << "SetProperties initiated on an empty set of tasks, check the path argument.";
         }
-        // OLOG(debug) << "SetProperties " << mId << " with expected count of " << mTasks.size() << " started.";
+        // OLOG(debug) << "SetProperties " << mId << " with expected count of " << mTasks->Size() << " started.";
     }
     SetPropertiesOp() = delete;
     SetPropertiesOp(const SetPropertiesOp&) = delete;
@@ -70,24 +70,24 @@ struct SetPropertiesOp
     ~SetPropertiesOp() = default;
 
     /// precondition: mMtx is locked.
-    void ResetCount(const TopoStateIndex& stateIndex, const TopoState& stateData)
+    void ResetCount(const TopoStateStore& stateData)
     {
-        mOutstandingDevices.reserve(mTasks.size());
-        for (const auto& task : mTasks) {
-            const DeviceStatus& ds = stateData.at(stateIndex.at(task.GetId()));
+        mOutstandingDevices.reserve(mTasks->Size());
+        for (const int index : mTasks->Indices()) {
+            const DeviceState state = stateData.State(index);
             // Do not wait for an errored/exited device that is not yet ignored
-            if (ds.state == DeviceState::Error || ds.state == DeviceState::Exiting) {
+            if (state == DeviceState::Error || state == DeviceState::Exiting) {
                 ++mCount;
             }
             // but always list at as failed/outstanding
-            mOutstandingDevices.emplace(task.GetId());
+            mOutstandingDevices.emplace(stateData.TaskId(index));
         }
     }
 
     /// precondition: mMtx is locked.
-    void Update(const DDSTask::Id taskId, cc::Result result, bool expendable)
+    void Update(const int index, const DDSTask::Id taskId, cc::Result result, bool expendable)
     {
-        if (!mOp.IsCompleted() && ContainsTask(taskId)) {
+        if (!mOp.IsCompleted() && ContainsTask(index)) {
             if (result == cc::Result::Ok) {
                 mOutstandingDevices.erase(taskId);
                 ++mCount;
@@ -110,32 +110,44 @@ struct SetPropertiesOp
     /// precondition: mMtx is locked.
     void TryCompletion()
     {
-        if (!mOp.IsCompleted() && mCount == mTasks.size()) {
-            mTimer.cancel();
+        if (!mOp.IsCompleted() && mCount == mTasks->Size()) {
+            mTimers.Cancel(mTimeout);
             if (!mOutstandingDevices.empty()) {
-                mOp.Complete(MakeErrorCode(ErrorCode::DeviceSetPropertiesFailed), mOutstandingDevices);
+                mOp.Complete(MakeErrorCode(ErrorCode::DeviceSetPropertiesFailed), ToFailedDevices(std::move(mOutstandingDevices)));
             } else {
-                mOp.Complete(mOutstandingDevices);
+                mOp.Complete(FailedDevices());
             }
+            NotifyCompletion();
         }
     }
 
+    /// @param index index of the task in TopoStateStore
+    bool ContainsTask(int index) const { return mTasks->Contains(index); }
+    const TopoTaskSetPtr& GetTaskSet() const { return mTasks; }
+
     bool IsCompleted() { return mOp.IsCompleted(); }
 
+    /// @brief Set a callback to be called (with mMtx locked) once the operation completes, including timeouts
+    /// precondition: mMtx is locked.
+    void SetCompletionCallback(std::function<void(uint64_t)> cb) { mOnCompletion = std::move(cb); }
+
   private:
     const uint64_t mId;
     AsioAsyncOp<Executor, Allocator, SetPropertiesCompletionSignature> mOp;
-    boost::asio::steady_timer mTimer;
+    TopoTimerWheel& mTimers;
+    TopoTimerWheel::Id mTimeout = 0;
     unsigned int mCount;
-    std::vector<DDSTask> mTasks;
-    FailedDevices mOutstandingDevices;
-    std::mutex& mMtx;
+    TopoTaskSetPtr mTasks;
+    TopoFailedDevices<Allocator> mOutstandingDevices;
+    TopoMutex& mMtx;
+    std::function<void(uint64_t)> mOnCompletion;
 
     /// precondition: mMtx is locked.
-    bool ContainsTask(DDSTask::Id id)
+    void NotifyCompletion()
     {
-        auto it = std::find_if(mTasks.begin(), mTasks.end(), [id](const DDSTask& t) { return t.GetId() == id; });
-        return it != mTasks.end();
+        if (mOnCompletion) {
+            mOnCompletion(mId);
+        }
     }
 };
 
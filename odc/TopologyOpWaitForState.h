@@ -11,9 +11,10 @@
 
 #include <odc/AsioAsyncOp.h>
 #include <odc/Error.h>
+#include <odc/TopologyAllocator.h>
 #include <odc/TopologyDefs.h>
-
-#include <boost/asio/steady_timer.hpp>
+#include <odc/TopologyStateStore.h>
+#include <odc/TopologyTimerWheel.h>
 
 #include <dds/Tools.h>
 #include <dds/Topology.h>
@@ -37,31 +38,30 @@ struct WaitForStateOp
     WaitForStateOp(uint64_t id,
                    DeviceState targetLastState,
                    DeviceState targetCurrentState,
-                   std::vector<DDSTask> tasks,
+                   TopoTaskSetPtr tasks,
                    Duration timeout,
-                   std::mutex& mutex,
+                   TopoMutex& mutex,
+                   TopoTimerWheel& timers,
                    Executor const& ex,
                    Allocator const& alloc,
                    Handler&& handler)
         : mId(id)
         , mOp(ex, alloc, std::move(handler))
-        , mTimer(ex)
+        , mTimers(timers)
         , mCount(0)
         , mTasks(std::move(tasks))
+        , mFailed(alloc)
         , mTargetLastState(targetLastState)
         , mTargetCurrentState(targetCurrentState)
         , mMtx(mutex)
     {
         if (timeout > std::chrono::milliseconds(0)) {
-            mTimer.expires_after(timeout);
-            mTimer.async_wait([&](std::error_code ec) {
-                if (!ec) {
-                    std::lock_guard<std::mutex> lk(mMtx);
-                    mOp.Timeout();
-                }
+            mTimeout = mTimers.Add(timeout, [this]() {
+                mOp.Timeout();
+                NotifyCompletion();
             });
         }
-        if (mTasks.empty()) {
+        if (mTasks->Empty()) {
             OLOG(warning) << "WaitForState initiated on an empty set of tasks, check the path argument.";
         }
     }
@@ -73,37 +73,32 @@ struct WaitForStateOp
     ~WaitForStateOp() = default;
 
     /// precondition: mMtx is locked.
-    void ResetCount(const TopoStateIndex& stateIndex, const TopoState& stateData)
+    void ResetCount(const TopoStateStore& stateData)
     {
-        mCount = std::count_if(stateIndex.cbegin(), stateIndex.cend(), [=](const auto& s) {
-            const auto& task = stateData.at(s.second);
-            if (ContainsTask(task.taskId)) {
-                if (task.state == mTargetCurrentState && (task.lastState == mTargetLastState || mTargetLastState == DeviceState::Undefined)) {
-                    return true;
-                } else {
-                    // Do not wait for an errored/exited device that is not yet ignored
-                    if (task.state == DeviceState::Error || task.state == DeviceState::Exiting) {
-                        mErrored = true;
-                        return true;
-                    } else {
-                        return false;
-                    }
-                }
-            } else {
-                return false;
+        mCount = 0;
+        for (const int index : mTasks->Indices()) {
+            const DeviceState state = stateData.State(index);
+            if (state == mTargetCurrentState && (stateData.LastState(index) == mTargetLastState || mTargetLastState == DeviceState::Undefined)) {
+                ++mCount;
+            } else if (state == DeviceState::Error || state == DeviceState::Exiting) {
+                // Do not wait for an errored/exited device that is not yet ignored
+                mErrored = true;
+                ++mCount;
             }
-        });
+        }
     }
 
     /// precondition: mMtx is locked.
-    void Update(const DDSTask::Id taskId, const DeviceState lastState, const DeviceState currentState, bool expendable)
+    void Update(const int index, const DDSTask::Id taskId, const DeviceState lastState, const DeviceState currentState, bool expendable)
     {
-        if (!mOp.IsCompleted() && ContainsTask(taskId)) {
+        if (!mOp.IsCompleted() && ContainsTask(index)) {
             if (currentState == mTargetCurrentState && (lastState == mTargetLastState || mTargetLastState == DeviceState::Undefined)) {
                 ++mCount;
             } else if (currentState == DeviceState::Error || currentState == DeviceState::Exiting) {
                 if (mFailed.count(taskId) == 0) {
-                    mErrored = expendable ? false : true;
+                    if (!expendable) {
+                        mErrored = true;
+                    }
                     ++mCount;
                     mFailed.emplace(taskId);
                 } else {
@@ -117,7 +112,7 @@ struct WaitForStateOp
     /// precondition: mMtx is locked.
     void TryCompletion()
     {
-        if (!mOp.IsCompleted() && mCount == mTasks.size()) {
+        if (!mOp.IsCompleted() && (mCount == mTasks->Size() || (mFailFast && mErrored))) {
             if (mErrored) {
                 Complete(MakeErrorCode(ErrorCode::DeviceChangeStateFailed));
             } else {
@@ -129,30 +124,47 @@ struct WaitForStateOp
     /// precondition: mMtx is locked.
     void Complete(std::error_code ec)
     {
-        mTimer.cancel();
+        mTimers.Cancel(mTimeout);
         mOp.Complete(ec);
+        NotifyCompletion();
     }
 
-    /// precondition: mMtx is locked.
-    bool ContainsTask(DDSTask::Id id)
-    {
-        auto it = std::find_if(mTasks.begin(), mTasks.end(), [id](const DDSTask& t) { return t.GetId() == id; });
-        return it != mTasks.end();
-    }
+    /// @param index index of the task in TopoStateStore
+    bool ContainsTask(int index) const { return mTasks->Contains(index); }
+    const TopoTaskSetPtr& GetTaskSet() const { return mTasks; }
 
     bool IsCompleted() { return mOp.IsCompleted(); }
 
+    /// @brief Set a callback to be called (with mMtx locked) once the operation completes, including timeouts
+    /// precondition: mMtx is locked.
+    void SetCompletionCallback(std::function<void(uint64_t)> cb) { mOnCompletion = std::move(cb); }
+
+    /// @brief Complete with an error as soon as a non-ignorable device failure makes success impossible,
+    /// instead of waiting for the remaining devices (or the timeout)
+    void SetFailFast(bool failFast) { mFailFast = failFast; }
+
   private:
     const uint64_t mId;
     AsioAsyncOp<Executor, Allocator, WaitForStateCompletionSignature> mOp;
-    boost::asio::steady_timer mTimer;
+    TopoTimerWheel& mTimers;
+    TopoTimerWheel::Id mTimeout = 0;
     unsigned int mCount;
-    std::vector<DDSTask> mTasks;
-    FailedDevices mFailed;
+    TopoTaskSetPtr mTasks;
+    TopoFailedDevices<Allocator> mFailed;
     DeviceState mTargetLastState;
     DeviceState mTargetCurrentState;
-    std::mutex& mMtx;
+    TopoMutex& mMtx;
+    std::function<void(uint64_t)> mOnCompletion;
     bool mErrored = false;
+    bool mFailFast = false;
+
+    /// precondition: mMtx is locked.
+    void NotifyCompletion()
+    {
+        if (mOnCompletion) {
+            mOnCompletion(mId);
+        }
+    }
 };
 
 } // namespace odc::core
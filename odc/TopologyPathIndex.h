@@ -0,0 +1,228 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYPATHINDEX
+#define ODC_TOPOLOGYPATHINDEX
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace odc::core
+{
+
+/// Indices of the tasks (in TopoStateStore) selected by a path
+using TopoPathSelection = std::vector<int>;
+using TopoPathSelectionPtr = std::shared_ptr<const TopoPathSelection>;
+
+/**
+ * @brief Trie over the '/' separated components of the runtime task paths of a topology
+ *
+ * Selects tasks with the same semantics as DDS getRuntimeTaskIteratorMatchingPath() (regex_match of the pattern
+ * against the full task path). Tasks are stored in depth-first order, so that every subtree is a contiguous range:
+ * - literal paths select the task with exactly that path,
+ * - "<literal>.*" patterns (e.g. "main/Group_1/.*") select the contiguous range of the matching children,
+ * both proportional to the number of selected tasks. Other patterns fall back to one regex match per task.
+ */
+class TopoPathIndex
+{
+  public:
+    TopoPathIndex()
+        : mNodes(1)
+    {}
+
+    /// @brief Add a task path, call Build() after the last one
+    void Add(const std::string& path, int index)
+    {
+        int node = 0;
+        size_t begin = 0;
+        while (true) {
+            const size_t end = path.find('/', begin);
+            const std::string component = path.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+            auto it = mNodes[node].children.find(component);
+            if (it == mNodes[node].children.end()) {
+                const int child = static_cast<int>(mNodes.size());
+                mNodes[node].children.emplace(component, child);
+                mNodes.emplace_back();
+                node = child;
+            } else {
+                node = it->second;
+            }
+            if (end == std::string::npos) {
+                break;
+            }
+            begin = end + 1;
+        }
+        mNodes[node].tasks.push_back(index);
+        mPaths.emplace_back(path, index);
+    }
+
+    /// @brief Lay out the tasks in depth-first order
+    void Build()
+    {
+        mOrder.clear();
+        mOrder.reserve(mPaths.size());
+        Layout(0);
+    }
+
+    size_t Size() const { return mOrder.size(); }
+
+    /// @brief Select the tasks whose path matches the given pattern, empty pattern selects all
+    /// @throws std::regex_error for invalid patterns
+    TopoPathSelection Select(const std::string& pattern) const
+    {
+        const size_t meta = pattern.find_first_of(".[]{}()*+?^$|\\");
+        if (meta == std::string::npos) {
+            if (pattern.empty()) {
+                return mOrder;
+            }
+            const int node = Find(pattern);
+            return node < 0 ? TopoPathSelection() : mNodes[node].tasks;
+        }
+
+        if (pattern.compare(meta, std::string::npos, ".*") == 0) {
+            // literal prefix: select the subtrees of all children of its directory that start with the remainder
+            const std::string prefix = pattern.substr(0, meta);
+            const size_t slash = prefix.rfind('/');
+            const int dir = slash == std::string::npos ? 0 : Find(prefix.substr(0, slash));
+            if (dir < 0) {
+                return {};
+            }
+            const std::string partial = slash == std::string::npos ? prefix : prefix.substr(slash + 1);
+            const auto& children = mNodes[dir].children;
+            auto first = children.lower_bound(partial);
+            auto last = first;
+            while (last != children.end() && last->first.compare(0, partial.size(), partial) == 0) {
+                ++last;
+            }
+            if (first == last) {
+                return {};
+            }
+            // siblings are laid out in key order, so the matching subtrees are adjacent
+            const Node& from = mNodes[first->second];
+            const Node& to = mNodes[std::prev(last)->second];
+            return TopoPathSelection(mOrder.begin() + from.begin, mOrder.begin() + to.end);
+        }
+
+        const std::regex re(pattern);
+        TopoPathSelection selection;
+        for (const auto& [path, index] : mPaths) {
+            if (std::regex_match(path, re)) {
+                selection.push_back(index);
+            }
+        }
+        return selection;
+    }
+
+  private:
+    struct Node
+    {
+        std::map<std::string, int> children; ///< path component -> node
+        std::vector<int> tasks;              ///< tasks whose path ends at this node
+        size_t begin = 0;                    ///< subtree range in mOrder
+        size_t end = 0;
+    };
+
+    std::vector<Node> mNodes;                        ///< mNodes[0] is the root
+    std::vector<int> mOrder;                         ///< task indices in depth-first order
+    std::vector<std::pair<std::string, int>> mPaths; ///< full path of each task, for general patterns
+
+    /// @return node of the given literal path, -1 if there is none
+    int Find(const std::string& path) const
+    {
+        int node = 0;
+        size_t begin = 0;
+        while (true) {
+            const size_t end = path.find('/', begin);
+            const auto& children = mNodes[node].children;
+            auto it = children.find(path.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+            if (it == children.end()) {
+                return -1;
+            }
+            node = it->second;
+            if (end == std::string::npos) {
+                return node;
+            }
+            begin = end + 1;
+        }
+    }
+
+    void Layout(int node)
+    {
+        mNodes[node].begin = mOrder.size();
+        mOrder.insert(mOrder.end(), mNodes[node].tasks.begin(), mNodes[node].tasks.end());
+        for (const auto& child : mNodes[node].children) {
+            Layout(child.second);
+        }
+        mNodes[node].end = mOrder.size();
+    }
+};
+
+/// @brief Escape a task or collection path for use in a path pattern (matched as a regex)
+inline std::string TopoEscapePath(const std::string& path)
+{
+    std::string escaped;
+    escaped.reserve(path.size());
+    for (const char c : path) {
+        if (std::strchr(".^$|()[]{}*+?\\", c) != nullptr) {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+/// A task selected by TopoSelectionPattern()
+struct TopoSelectedTask
+{
+    std::string path;           ///< runtime task path
+    uint64_t collectionId;      ///< runtime collection id, 0 if the task is not part of a collection
+    std::string collectionPath; ///< runtime collection path
+};
+
+/// @brief Path pattern selecting exactly the given tasks, e.g. for ChangeState()
+/// Collections with all their tasks selected are matched by their path, other tasks by their full path.
+/// @param tasks selected tasks, must not be empty (an empty pattern selects all tasks)
+/// @param collectionSizes number of tasks of each collection of the selected tasks
+inline std::string TopoSelectionPattern(const std::vector<TopoSelectedTask>& tasks, const std::unordered_map<uint64_t, size_t>& collectionSizes)
+{
+    std::vector<std::string> alternatives;
+    std::map<uint64_t, std::vector<const TopoSelectedTask*>> collections; // collection -> selected tasks
+    for (const auto& task : tasks) {
+        if (task.collectionId == 0) {
+            alternatives.push_back(TopoEscapePath(task.path));
+        } else {
+            collections[task.collectionId].push_back(&task);
+        }
+    }
+    for (const auto& [collectionId, selected] : collections) {
+        const auto it = collectionSizes.find(collectionId);
+        if (it != collectionSizes.end() && selected.size() == it->second) {
+            alternatives.push_back(TopoEscapePath(selected.front()->collectionPath) + "/.*");
+        } else {
+            for (const auto* task : selected) {
+                alternatives.push_back(TopoEscapePath(task->path));
+            }
+        }
+    }
+    std::string pattern;
+    for (const auto& alternative : alternatives) {
+        pattern += (pattern.empty() ? "" : "|") + alternative;
+    }
+    return pattern;
+}
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYPATHINDEX */
@@ -0,0 +1,230 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYSCRIPTCACHE
+#define ODC_TOPOLOGYSCRIPTCACHE
+
+#include <odc/MiscUtils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace odc::core
+{
+
+/**
+ * @brief Opt-in cache of the output of topology generation scripts
+ *
+ * The output of a script is stored in the cache directory under a key derived from the script command, the values of
+ * the configured environment variables and a fingerprint (size and modification time) of the configured input files
+ * and directories. A script is assumed to produce the same topology for the same key. The key material is stored next
+ * to each output and compared on a lookup, so hash collisions are misses.
+ *
+ * The directory is bounded to a number of entries; the least recently used ones are evicted. The order of use is kept
+ * by a counter of this cache, file modification times (at kernel tick granularity, refreshed on every hit) only order
+ * the entries this cache has not used, e.g. the ones of a previous controller sharing the directory. Those are
+ * evicted first.
+ */
+class TopologyScriptCache
+{
+  public:
+    struct Stats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    /// @param dir cache directory, created if missing
+    /// @param maxEntries maximum number of cached outputs
+    /// @param envVars environment variables that influence the output of the scripts
+    /// @param inputs files or directories (recursively) read by the scripts
+    TopologyScriptCache(const std::string& dir, size_t maxEntries, std::vector<std::string> envVars, std::vector<std::string> inputs)
+        : mDir(dir)
+        , mMaxEntries(std::max<size_t>(maxEntries, 1))
+        , mEnvVars(std::move(envVars))
+        , mInputs(std::move(inputs))
+    {
+        std::filesystem::create_directories(mDir);
+    }
+
+    TopologyScriptCache(const TopologyScriptCache&) = delete;
+    TopologyScriptCache& operator=(const TopologyScriptCache&) = delete;
+
+    /// @brief Get the output of the script from the cache, or run it and store its output
+    /// @param run runs the script and returns its output, throws on failure (failures are not cached)
+    /// @param hit set to true if the output was taken from the cache
+    std::string get(const std::string& script, const std::function<std::string()>& run, bool& hit)
+    {
+        const std::string keyMaterial = makeKeyMaterial(script);
+        const std::string key = toHex(std::hash<std::string>()(keyMaterial));
+        const auto outPath = mDir / (key + ".xml");
+        const auto keyPath = mDir / (key + ".key");
+
+        {
+            std::lock_guard<std::mutex> lk(mMtx);
+            if (auto out = read(outPath); out && read(keyPath) == keyMaterial) {
+                std::error_code ec;
+                std::filesystem::last_write_time(outPath, std::filesystem::file_time_type::clock::now(), ec);
+                mLastUse[key] = ++mUseCounter;
+                ++mHits;
+                hit = true;
+                return std::move(*out);
+            }
+        }
+
+        ++mMisses;
+        hit = false;
+        std::string out = run();
+
+        std::lock_guard<std::mutex> lk(mMtx);
+        try {
+            // write under temporary names and rename, other controllers may share the directory
+            write(keyPath, keyMaterial);
+            write(outPath, out);
+            mLastUse[key] = ++mUseCounter;
+            evict();
+        } catch (const std::exception&) {
+            // the output is still valid, only caching it failed
+            std::error_code ec;
+            std::filesystem::remove(outPath, ec);
+            std::filesystem::remove(keyPath, ec);
+        }
+        return out;
+    }
+
+    Stats getStats() const { return Stats{ mHits.load(), mMisses.load(), mEvictions.load() }; }
+    const std::filesystem::path& getDir() const { return mDir; }
+
+  private:
+    std::filesystem::path mDir;
+    size_t mMaxEntries;
+    std::vector<std::string> mEnvVars;
+    std::vector<std::string> mInputs;
+    std::mutex mMtx;
+    std::unordered_map<std::string, uint64_t> mLastUse; ///< key -> value of mUseCounter at its last use
+    uint64_t mUseCounter = 0;
+    std::atomic<uint64_t> mHits = 0;
+    std::atomic<uint64_t> mMisses = 0;
+    std::atomic<uint64_t> mEvictions = 0;
+
+    static std::string toHex(uint64_t value)
+    {
+        std::ostringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << value;
+        return ss.str();
+    }
+
+    static void fingerprint(std::ostream& os, const std::filesystem::path& path)
+    {
+        std::error_code ec;
+        const auto status = std::filesystem::status(path, ec);
+        if (ec || !std::filesystem::exists(status)) {
+            os << path.string() << ":missing\n";
+            return;
+        }
+        if (std::filesystem::is_directory(status)) {
+            std::vector<std::filesystem::path> entries;
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path, ec)) {
+                if (entry.is_regular_file(ec)) {
+                    entries.push_back(entry.path());
+                }
+            }
+            std::sort(entries.begin(), entries.end());
+            for (const auto& entry : entries) {
+                fingerprint(os, entry);
+            }
+            return;
+        }
+        os << path.string() << ":" << std::filesystem::file_size(path, ec) << ":" << std::filesystem::last_write_time(path, ec).time_since_epoch().count() << "\n";
+    }
+
+    std::string makeKeyMaterial(const std::string& script) const
+    {
+        std::ostringstream ss;
+        ss << "script:" << script << "\n";
+        for (const auto& var : mEnvVars) {
+            const char* value = std::getenv(var.c_str());
+            ss << "env:" << var << (value ? toString("=", value) : std::string(":unset")) << "\n";
+        }
+        for (const auto& input : mInputs) {
+            fingerprint(ss, input);
+        }
+        return ss.str();
+    }
+
+    static std::optional<std::string> read(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return std::nullopt;
+        }
+        return std::string{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    }
+
+    static void write(const std::filesystem::path& path, const std::string& content)
+    {
+        const auto tmpPath = std::filesystem::path(path.string() + ".tmp" + uuid());
+        {
+            std::ofstream file(tmpPath, std::ios::binary);
+            if (!file || !(file << content) || !file.flush()) {
+                std::error_code ec;
+                std::filesystem::remove(tmpPath, ec);
+                throw std::runtime_error(toString("Failed to write ", std::quoted(tmpPath.string())));
+            }
+        }
+        std::filesystem::rename(tmpPath, path);
+    }
+
+    // precondition: mMtx is locked.
+    void evict()
+    {
+        // (last use by this cache, 0 if unused; modification time; path), least recently used first
+        std::vector<std::tuple<uint64_t, std::filesystem::file_time_type, std::filesystem::path>> outputs;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(mDir, ec)) {
+            if (entry.path().extension() == ".xml") {
+                const auto it = mLastUse.find(entry.path().stem().string());
+                outputs.emplace_back(it != mLastUse.end() ? it->second : 0, entry.last_write_time(ec), entry.path());
+            }
+        }
+        if (outputs.size() <= mMaxEntries) {
+            return;
+        }
+        std::sort(outputs.begin(), outputs.end());
+        for (size_t i = 0; i < outputs.size() - mMaxEntries; ++i) {
+            auto path = std::get<2>(outputs[i]);
+            mLastUse.erase(path.stem().string());
+            std::filesystem::remove(path, ec);
+            std::filesystem::remove(path.replace_extension(".key"), ec);
+            ++mEvictions;
+        }
+    }
+};
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYSCRIPTCACHE */
@@ -0,0 +1,153 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYSTATECOUNTERS
+#define ODC_TOPOLOGYSTATECOUNTERS
+
+#include <odc/TopologyDefs.h>
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+namespace odc::core
+{
+
+constexpr size_t kNumDeviceStates = static_cast<size_t>(DeviceState::Exiting) + 1;
+constexpr size_t kNumAggregatedStates = static_cast<size_t>(AggregatedState::Mixed) + 1;
+
+using DeviceStateCounts = std::array<uint32_t, kNumDeviceStates>;         ///< number of devices per DeviceState
+using AggregatedStateCounts = std::array<uint32_t, kNumAggregatedStates>; ///< number of collections per AggregatedState
+
+/// @brief Aggregate state from the per-state counts of the (non-ignored) devices
+/// Follows the same rules as AggregateState(const TopoState&): any device in Error makes the whole set Error,
+/// otherwise a homogeneous set returns the common state and everything else (including an empty set) is Mixed.
+inline AggregatedState AggregateState(const DeviceStateCounts& counts, uint32_t total)
+{
+    if (total == 0) {
+        return AggregatedState::Mixed;
+    }
+    if (counts[static_cast<size_t>(DeviceState::Error)] > 0) {
+        return AggregatedState::Error;
+    }
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == total) {
+            return static_cast<AggregatedState>(i);
+        }
+    }
+    return AggregatedState::Mixed;
+}
+
+/// @brief Summary of the topology state, as per-state counts of devices and collections
+struct TopoStateCounts
+{
+    DeviceStateCounts tasks{};                           ///< all devices (including ignored ones) per state
+    uint32_t numTasks = 0;                               ///< total number of devices
+    AggregatedStateCounts collections{};                 ///< collections per aggregated state
+    uint32_t numCollections = 0;                         ///< total number of collections
+    AggregatedState aggregated = AggregatedState::Mixed; ///< aggregated state of the non-ignored devices
+};
+
+/**
+ * @brief Incrementally maintained per-state counters for devices and collections
+ *
+ * Every modification of a device state that is tracked here must be wrapped as Remove(old) / Add(new),
+ * the aggregated states of the topology and of each collection are then available in O(1).
+ */
+class TopoStateCounters
+{
+  public:
+    void Add(const DeviceStatus& ds) { Apply(ds.state, ds.ignored, ds.collectionId, 1); }
+    void Remove(const DeviceStatus& ds) { Apply(ds.state, ds.ignored, ds.collectionId, -1); }
+    void Add(DeviceState state, bool ignored, DDSCollection::Id collectionId) { Apply(state, ignored, collectionId, 1); }
+    void Remove(DeviceState state, bool ignored, DDSCollection::Id collectionId) { Apply(state, ignored, collectionId, -1); }
+
+    /// @brief Remove a device that leaves the topology (not a state to be replaced), drops its collection with the last device
+    void Erase(DeviceState state, bool ignored, DDSCollection::Id collectionId)
+    {
+        Apply(state, ignored, collectionId, -1);
+        if (collectionId != 0) {
+            auto it = mCollections.find(collectionId);
+            if (it != mCollections.end() && it->second.numAll == 0) {
+                --mCollectionStates[static_cast<size_t>(it->second.state)];
+                mCollections.erase(it);
+            }
+        }
+    }
+
+    /// @brief Aggregated state of all non-ignored devices
+    AggregatedState Aggregated() const { return AggregateState(mActive, mNumActive); }
+
+    /// @brief Aggregated state of the non-ignored devices of a collection
+    AggregatedState CollectionAggregated(DDSCollection::Id id) const
+    {
+        auto it = mCollections.find(id);
+        return it == mCollections.end() ? AggregatedState::Mixed : it->second.state;
+    }
+
+    TopoStateCounts Counts() const
+    {
+        TopoStateCounts counts;
+        counts.tasks = mAll;
+        counts.numTasks = mNumAll;
+        counts.collections = mCollectionStates;
+        counts.numCollections = mCollections.size();
+        counts.aggregated = Aggregated();
+        return counts;
+    }
+
+  private:
+    struct CollectionCounters
+    {
+        DeviceStateCounts active{};
+        uint32_t numActive = 0;
+        uint32_t numAll = 0; ///< including ignored devices
+        AggregatedState state = AggregatedState::Mixed;
+    };
+
+    DeviceStateCounts mAll{};
+    uint32_t mNumAll = 0;
+    DeviceStateCounts mActive{};
+    uint32_t mNumActive = 0;
+    std::unordered_map<DDSCollection::Id, CollectionCounters> mCollections;
+    AggregatedStateCounts mCollectionStates{};
+
+    void Apply(DeviceState ds, bool ignored, DDSCollection::Id collectionId, int delta)
+    {
+        const auto state = static_cast<size_t>(ds);
+        mAll[state] += delta;
+        mNumAll += delta;
+        if (!ignored) {
+            mActive[state] += delta;
+            mNumActive += delta;
+        }
+
+        if (collectionId != 0) {
+            auto [it, inserted] = mCollections.try_emplace(collectionId);
+            CollectionCounters& col = it->second;
+            if (inserted) {
+                ++mCollectionStates[static_cast<size_t>(col.state)];
+            }
+            col.numAll += delta;
+            if (!ignored) {
+                col.active[state] += delta;
+                col.numActive += delta;
+                const AggregatedState newState = AggregateState(col.active, col.numActive);
+                if (newState != col.state) {
+                    --mCollectionStates[static_cast<size_t>(col.state)];
+                    ++mCollectionStates[static_cast<size_t>(newState)];
+                    col.state = newState;
+                }
+            }
+        }
+    }
+};
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYSTATECOUNTERS */
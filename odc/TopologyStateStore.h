@@ -0,0 +1,536 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYSTATESTORE
+#define ODC_TOPOLOGYSTATESTORE
+
+#include <odc/TopologyDefs.h>
+#include <odc/TopologyStateCounters.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace odc::core
+{
+
+/**
+ * @brief Growable bitset backed by 64-bit words
+ */
+class TopoBitset
+{
+  public:
+    void Reserve(size_t n) { mWords.reserve((n + 63) / 64); }
+    size_t Size() const { return mSize; }
+
+    void PushBack(bool value)
+    {
+        if (mSize % 64 == 0) {
+            mWords.push_back(0);
+        }
+        ++mSize;
+        Set(mSize - 1, value);
+    }
+
+    bool Test(size_t i) const { return (mWords[i / 64] >> (i % 64)) & 1; }
+
+    void Set(size_t i, bool value)
+    {
+        const uint64_t mask = uint64_t(1) << (i % 64);
+        if (value) {
+            mWords[i / 64] |= mask;
+        } else {
+            mWords[i / 64] &= ~mask;
+        }
+    }
+
+    /// @brief Number of set bits
+    size_t Count() const
+    {
+        size_t count = 0;
+        for (const uint64_t w : mWords) {
+            count += __builtin_popcountll(w);
+        }
+        return count;
+    }
+
+    size_t MemoryUsage() const { return mWords.capacity() * sizeof(uint64_t); }
+
+  private:
+    std::vector<uint64_t> mWords;
+    size_t mSize = 0;
+};
+
+/**
+ * @brief Open-addressing hash map from task id to the index of the task in the state arrays
+ *
+ * The slot table only stores indices, the keys are read from the task id array of the owning store.
+ * Linear probing, power-of-two capacity, load factor <= 0.5. Entries are never removed, TopoStateStore::Erase()
+ * rebuilds the table.
+ */
+class TopoTaskIndex
+{
+  public:
+    /// @brief Prepare the table for n entries
+    void Reserve(size_t n, const std::vector<DDSTask::Id>& taskIds)
+    {
+        size_t capacity = 16;
+        while (capacity < 2 * n) {
+            capacity *= 2;
+        }
+        if (capacity > mSlots.size()) {
+            Rehash(capacity, taskIds);
+        }
+    }
+
+    /// @brief Insert index for taskIds[index]
+    /// @return false if the task id is already present
+    bool Insert(const std::vector<DDSTask::Id>& taskIds, int index)
+    {
+        if (2 * (mSize + 1) > mSlots.size()) {
+            Rehash(std::max<size_t>(16, mSlots.size() * 2), taskIds);
+        }
+        const DDSTask::Id id = taskIds[index];
+        for (size_t slot = Hash(id) & mMask;; slot = (slot + 1) & mMask) {
+            if (mSlots[slot] < 0) {
+                mSlots[slot] = index;
+                ++mSize;
+                return true;
+            }
+            if (taskIds[mSlots[slot]] == id) {
+                return false;
+            }
+        }
+    }
+
+    /// @return index of the task, or -1 if the task id is unknown
+    int Find(const std::vector<DDSTask::Id>& taskIds, DDSTask::Id id) const
+    {
+        if (mSize == 0) {
+            return -1;
+        }
+        for (size_t slot = Hash(id) & mMask;; slot = (slot + 1) & mMask) {
+            const int index = mSlots[slot];
+            if (index < 0) {
+                return -1;
+            }
+            if (taskIds[index] == id) {
+                return index;
+            }
+        }
+    }
+
+    size_t Size() const { return mSize; }
+    size_t MemoryUsage() const { return mSlots.capacity() * sizeof(int32_t); }
+
+  private:
+    std::vector<int32_t> mSlots;
+    size_t mMask = 0;
+    size_t mSize = 0;
+
+    // DDS task ids are hashes already, but they are not guaranteed to be well distributed in the low bits
+    static size_t Hash(DDSTask::Id id)
+    {
+        id ^= id >> 33;
+        id *= 0xff51afd7ed558ccdULL;
+        id ^= id >> 33;
+        return static_cast<size_t>(id);
+    }
+
+    void Rehash(size_t capacity, const std::vector<DDSTask::Id>& taskIds)
+    {
+        std::vector<int32_t> old(capacity, -1);
+        old.swap(mSlots);
+        mMask = capacity - 1;
+        mSize = 0;
+        for (const int32_t index : old) {
+            if (index >= 0) {
+                Insert(taskIds, index);
+            }
+        }
+    }
+};
+
+/**
+ * @brief Immutable, versioned view of the device states of a topology
+ */
+struct TopoStateSnapshot
+{
+    uint64_t version = 0; ///< version of the TopoStateStore the snapshot was taken from
+    TopoState state;
+};
+
+using TopoStateSnapshotPtr = std::shared_ptr<const TopoStateSnapshot>;
+
+/**
+ * @brief Flat copy of the per-device arrays of a TopoStateStore
+ *
+ * Copying the arrays is cheap (a few contiguous copies), so readers take the copy while holding the topology lock and
+ * materialize the snapshot from it after releasing the lock.
+ */
+struct TopoStateColumns
+{
+    uint64_t version = 0;
+    std::vector<DDSTask::Id> taskIds;
+    std::vector<DDSCollection::Id> collectionIds;
+    std::vector<uint8_t> states;
+    std::vector<uint8_t> lastStates;
+    std::vector<int32_t> exitCodes;
+    std::vector<int32_t> signals;
+    TopoBitset ignored;
+    TopoBitset expendable;
+    TopoBitset subscribed;
+
+    TopoStateSnapshotPtr ToSnapshot() const
+    {
+        auto snapshot = std::make_shared<TopoStateSnapshot>();
+        snapshot->version = version;
+        snapshot->state.reserve(taskIds.size());
+        for (size_t i = 0; i < taskIds.size(); ++i) {
+            snapshot->state.emplace_back(ignored.Test(i),
+                                         expendable.Test(i),
+                                         subscribed.Test(i),
+                                         static_cast<DeviceState>(lastStates[i]),
+                                         static_cast<DeviceState>(states[i]),
+                                         taskIds[i],
+                                         collectionIds[i],
+                                         exitCodes[i],
+                                         signals[i]);
+        }
+        return snapshot;
+    }
+};
+
+/**
+ * @brief Struct-of-arrays storage of the device states of a topology
+ *
+ * Devices are addressed by their index (insertion order), which is also the index used by TopoTaskSet and the
+ * topology operations. States are stored as one byte per device, flags as bitsets. All modifications go through
+ * the setters, which keep the per-state counters (TopoStateCounters) up to date and bump the version.
+ */
+class TopoStateStore
+{
+  public:
+    void Reserve(size_t n)
+    {
+        mTaskIds.reserve(n);
+        mCollectionIds.reserve(n);
+        mStates.reserve(n);
+        mLastStates.reserve(n);
+        mExitCodes.reserve(n);
+        mSignals.reserve(n);
+        mIgnored.Reserve(n);
+        mExpendable.Reserve(n);
+        mSubscribed.Reserve(n);
+        mIndex.Reserve(n, mTaskIds);
+    }
+
+    /// @brief Add a device in the Undefined state
+    /// @return index of the new device
+    /// @throws std::runtime_error if the task id is already present
+    int Add(DDSTask::Id taskId, DDSCollection::Id collectionId, bool expendable)
+    {
+        const int index = static_cast<int>(mTaskIds.size());
+        mTaskIds.push_back(taskId);
+        if (!mIndex.Insert(mTaskIds, index)) {
+            mTaskIds.pop_back();
+            throw std::runtime_error("Duplicate task id " + std::to_string(taskId) + " in topology state");
+        }
+        mCollectionIds.push_back(collectionId);
+        mStates.push_back(static_cast<uint8_t>(DeviceState::Undefined));
+        mLastStates.push_back(static_cast<uint8_t>(DeviceState::Undefined));
+        mExitCodes.push_back(-1);
+        mSignals.push_back(-1);
+        mIgnored.PushBack(false);
+        mExpendable.PushBack(expendable);
+        mSubscribed.PushBack(false);
+        mCounters.Add(DeviceState::Undefined, false, collectionId);
+        ++mVersion;
+        return index;
+    }
+
+    /// @brief Compare the tracked devices with the tasks of an updated topology
+    /// @param taskIds all tasks of the updated topology
+    TopoDiff Diff(const std::vector<DDSTask::Id>& taskIds) const
+    {
+        TopoDiff diff;
+        std::vector<bool> kept(Size(), false);
+        for (const auto taskId : taskIds) {
+            if (const int index = Find(taskId); index < 0) {
+                diff.added.push_back(taskId);
+            } else {
+                kept[index] = true;
+            }
+        }
+        for (size_t i = 0; i < kept.size(); ++i) {
+            if (!kept[i]) {
+                diff.removed.push_back(mTaskIds[i]);
+            }
+        }
+        return diff;
+    }
+
+    /// @brief Remove the devices at the given indices, the remaining devices keep their relative order and state
+    /// The indices of the devices behind the first removed one change, index-based selections must be rebuilt.
+    void Erase(const std::vector<int>& indices)
+    {
+        if (indices.empty()) {
+            return;
+        }
+        std::vector<bool> erased(Size(), false);
+        for (const int i : indices) {
+            erased[i] = true;
+        }
+
+        TopoBitset ignored;
+        TopoBitset expendable;
+        TopoBitset subscribed;
+        size_t n = 0;
+        for (size_t i = 0; i < Size(); ++i) {
+            if (erased[i]) {
+                mCounters.Erase(State(i), Ignored(i), mCollectionIds[i]);
+                continue;
+            }
+            mTaskIds[n] = mTaskIds[i];
+            mCollectionIds[n] = mCollectionIds[i];
+            mStates[n] = mStates[i];
+            mLastStates[n] = mLastStates[i];
+            mExitCodes[n] = mExitCodes[i];
+            mSignals[n] = mSignals[i];
+            ignored.PushBack(Ignored(i));
+            expendable.PushBack(Expendable(i));
+            subscribed.PushBack(Subscribed(i));
+            ++n;
+        }
+        mTaskIds.resize(n);
+        mCollectionIds.resize(n);
+        mStates.resize(n);
+        mLastStates.resize(n);
+        mExitCodes.resize(n);
+        mSignals.resize(n);
+        mIgnored = std::move(ignored);
+        mExpendable = std::move(expendable);
+        mSubscribed = std::move(subscribed);
+
+        mIndex = TopoTaskIndex();
+        mIndex.Reserve(n, mTaskIds);
+        for (size_t i = 0; i < n; ++i) {
+            mIndex.Insert(mTaskIds, static_cast<int>(i));
+        }
+        ++mVersion;
+    }
+
+    size_t Size() const { return mTaskIds.size(); }
+
+    /// @return index of the task, or -1 if the task id is unknown
+    int Find(DDSTask::Id taskId) const { return mIndex.Find(mTaskIds, taskId); }
+
+    /// @return index of the task
+    /// @throws std::out_of_range if the task id is unknown
+    int At(DDSTask::Id taskId) const
+    {
+        const int index = Find(taskId);
+        if (index < 0) {
+            throw std::out_of_range("Unknown task id " + std::to_string(taskId));
+        }
+        return index;
+    }
+
+    DDSTask::Id TaskId(int i) const { return mTaskIds[i]; }
+    DDSCollection::Id CollectionId(int i) const { return mCollectionIds[i]; }
+    DeviceState State(int i) const { return static_cast<DeviceState>(mStates[i]); }
+    DeviceState LastState(int i) const { return static_cast<DeviceState>(mLastStates[i]); }
+    bool Ignored(int i) const { return mIgnored.Test(i); }
+    bool Expendable(int i) const { return mExpendable.Test(i); }
+    bool Subscribed(int i) const { return mSubscribed.Test(i); }
+    int ExitCode(int i) const { return mExitCodes[i]; }
+    int Signal(int i) const { return mSignals[i]; }
+
+    void SetState(int i, DeviceState lastState, DeviceState state)
+    {
+        mCounters.Remove(State(i), Ignored(i), mCollectionIds[i]);
+        mLastStates[i] = static_cast<uint8_t>(lastState);
+        mStates[i] = static_cast<uint8_t>(state);
+        mCounters.Add(state, Ignored(i), mCollectionIds[i]);
+        ++mVersion;
+    }
+
+    void SetIgnored(int i)
+    {
+        if (!Ignored(i)) {
+            mCounters.Remove(State(i), false, mCollectionIds[i]);
+            mIgnored.Set(i, true);
+            mCounters.Add(State(i), true, mCollectionIds[i]);
+            ++mVersion;
+        }
+    }
+
+    void SetSubscribed(int i, bool subscribed)
+    {
+        mSubscribed.Set(i, subscribed);
+        ++mVersion;
+    }
+
+    void SetExit(int i, int exitCode, int signal)
+    {
+        mExitCodes[i] = exitCode;
+        mSignals[i] = signal;
+        ++mVersion;
+    }
+
+    /// @brief Incremented on every modification
+    uint64_t Version() const { return mVersion; }
+
+    /// @brief Number of devices in the given state (including ignored ones), single pass over the state array
+    size_t CountState(DeviceState state) const
+    {
+        const auto s = static_cast<uint8_t>(state);
+        size_t count = 0;
+        for (const uint8_t v : mStates) {
+            count += (v == s);
+        }
+        return count;
+    }
+
+    size_t NumIgnored() const { return mIgnored.Count(); }
+    size_t NumSubscribed() const { return mSubscribed.Count(); }
+
+    /// @brief Devices that neither confirmed a state change subscription nor reported a state or an exit yet
+    std::vector<int> PendingSubscriptions() const
+    {
+        std::vector<int> pending;
+        for (size_t i = 0; i < Size(); ++i) {
+            const int index = static_cast<int>(i);
+            if (!Subscribed(index) && !Ignored(index) && State(index) == DeviceState::Undefined) {
+                pending.push_back(index);
+            }
+        }
+        return pending;
+    }
+
+    const TopoStateCounters& Counters() const { return mCounters; }
+
+    /// @brief Materialize the state of a single device
+    DeviceStatus Get(int i) const
+    {
+        return DeviceStatus(Ignored(i), Expendable(i), Subscribed(i), LastState(i), State(i), mTaskIds[i], mCollectionIds[i], mExitCodes[i], mSignals[i]);
+    }
+
+    /// @brief Materialize the state of all devices, in index order
+    TopoState ToTopoState() const
+    {
+        TopoState state;
+        state.reserve(Size());
+        for (size_t i = 0; i < Size(); ++i) {
+            state.push_back(Get(static_cast<int>(i)));
+        }
+        return state;
+    }
+
+    /// @brief Snapshot of the current state
+    /// The snapshot is built at most once per version and shared by all callers until the next modification.
+    /// Not thread-safe, the caller must serialize access to the store.
+    TopoStateSnapshotPtr Snapshot() const
+    {
+        if (!mSnapshot || mSnapshot->version != mVersion) {
+            auto snapshot = std::make_shared<TopoStateSnapshot>();
+            snapshot->version = mVersion;
+            snapshot->state = ToTopoState();
+            mSnapshot = std::move(snapshot);
+        }
+        return mSnapshot;
+    }
+
+    /// @brief Snapshot of the current state if one has already been built, nullptr otherwise
+    TopoStateSnapshotPtr CachedSnapshot() const { return (mSnapshot && mSnapshot->version == mVersion) ? mSnapshot : nullptr; }
+
+    /// @brief Copy of the per-device arrays, to build a snapshot without access to the store (see PublishSnapshot())
+    TopoStateColumns CopyColumns() const
+    {
+        return TopoStateColumns{ mVersion, mTaskIds, mCollectionIds, mStates, mLastStates, mExitCodes, mSignals, mIgnored, mExpendable, mSubscribed };
+    }
+
+    /// @brief Share a snapshot built from CopyColumns() with the following callers of Snapshot()
+    /// Ignored if the state has changed since the copy was taken.
+    void PublishSnapshot(TopoStateSnapshotPtr snapshot) const
+    {
+        if (snapshot->version == mVersion) {
+            mSnapshot = std::move(snapshot);
+        }
+    }
+
+    /// @brief Approximate heap memory used by the store in bytes (excluding the collection counters)
+    size_t MemoryUsage() const
+    {
+        return mTaskIds.capacity() * sizeof(DDSTask::Id)
+             + mCollectionIds.capacity() * sizeof(DDSCollection::Id)
+             + mStates.capacity() + mLastStates.capacity()
+             + mExitCodes.capacity() * sizeof(int32_t) + mSignals.capacity() * sizeof(int32_t)
+             + mIgnored.MemoryUsage() + mExpendable.MemoryUsage() + mSubscribed.MemoryUsage()
+             + mIndex.MemoryUsage();
+    }
+
+  private:
+    std::vector<DDSTask::Id> mTaskIds;
+    std::vector<DDSCollection::Id> mCollectionIds;
+    std::vector<uint8_t> mStates;
+    std::vector<uint8_t> mLastStates;
+    std::vector<int32_t> mExitCodes;
+    std::vector<int32_t> mSignals;
+    TopoBitset mIgnored;
+    TopoBitset mExpendable;
+    TopoBitset mSubscribed;
+    TopoTaskIndex mIndex;
+    TopoStateCounters mCounters;
+    uint64_t mVersion = 0;
+    mutable TopoStateSnapshotPtr mSnapshot; ///< last built snapshot, reused while the version is unchanged
+};
+
+/**
+ * @brief Selection of tasks (e.g. for a given path) with O(1) membership lookup
+ *
+ * Membership is stored as a dense bitset indexed by the position of the task in the TopoStateStore.
+ * Instances are immutable after construction and shared between operations on the same selection.
+ */
+struct TopoTaskSet
+{
+    /// @throws std::out_of_range if a task is not part of the store
+    TopoTaskSet(std::vector<DDSTask> tasks, const TopoStateStore& store)
+        : mTasks(std::move(tasks))
+        , mMembers(store.Size(), false)
+    {
+        mIndices.reserve(mTasks.size());
+        for (const auto& task : mTasks) {
+            const int index = store.At(task.GetId());
+            mMembers[index] = true;
+            mIndices.push_back(index);
+        }
+    }
+
+    /// @brief Check if the task at the given index in TopoStateStore is part of the selection
+    bool Contains(int index) const { return index >= 0 && static_cast<size_t>(index) < mMembers.size() && mMembers[index]; }
+    size_t Size() const { return mTasks.size(); }
+    bool Empty() const { return mTasks.empty(); }
+    const std::vector<DDSTask>& Tasks() const { return mTasks; }
+    /// @brief Indices of the selected tasks in TopoStateStore, in the same order as Tasks()
+    const std::vector<int>& Indices() const { return mIndices; }
+
+  private:
+    std::vector<DDSTask> mTasks;
+    std::vector<int> mIndices;
+    std::vector<bool> mMembers;
+};
+
+using TopoTaskSetPtr = std::shared_ptr<const TopoTaskSet>;
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYSTATESTORE */
@@ -0,0 +1,229 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYTIMERWHEEL
+#define ODC_TOPOLOGYTIMERWHEEL
+
+#include <odc/TopologyDefs.h>
+
+#include <boost/asio/steady_timer.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace odc::core
+{
+
+/**
+ * @brief Hierarchical timing wheel for the timeouts of topology operations
+ *
+ * All operations of a topology register their timeout here instead of arming a steady_timer each. Adding and
+ * cancelling a timeout is a hash map insert/erase; a single steady_timer wakes the wheel up at the next tick that has
+ * work (at most once per tick). Four levels of 64 slots cover 2^24 ticks (~46 hours at the default 10 ms tick),
+ * longer timeouts are parked in the last level and re-evaluated when it comes around.
+ *
+ * Timeouts fire at the first tick after their deadline, i.e. up to one tick late, never early.
+ * All member functions and the callbacks run with the topology mutex locked (on the strand in strand mode).
+ */
+class TopoTimerWheel
+{
+  public:
+    using Id = uint64_t;
+    using Callback = std::function<void()>;
+
+    /// @param ex executor to run the expired callbacks on
+    /// @param mutex locked while advancing the wheel and running the callbacks
+    /// @param tick resolution of the wheel
+    template<typename Executor>
+    TopoTimerWheel(const Executor& ex, TopoMutex& mutex, Duration tick = std::chrono::milliseconds(10))
+        : mTimer(ex)
+        , mMtx(mutex)
+        , mTick(tick)
+        , mStart(Clock::now())
+        , mSlots(kLevels * kSlots)
+    {}
+
+    TopoTimerWheel(const TopoTimerWheel&) = delete;
+    TopoTimerWheel& operator=(const TopoTimerWheel&) = delete;
+
+    /// @brief Register a callback to be called once the timeout expires
+    /// precondition: mMtx is locked.
+    Id Add(Duration timeout, Callback cb)
+    {
+        const Id id = ++mLastId;
+        const auto now = Clock::now();
+        if (mEntries.empty()) {
+            // the wheel is idle: catch up with the clock instead of stepping through the idle ticks later on
+            const uint64_t current = TickAt(now);
+            mNow = std::max(mNow, current > 0 ? current - 1 : 0);
+            if (mNumCancelled > kLevels * kSlots) {
+                for (auto& slot : mSlots) {
+                    slot.clear();
+                }
+                mNumCancelled = 0;
+            }
+        }
+        const uint64_t deadline = std::max(TickAt(now + timeout), mNow + 1);
+        mEntries.emplace(id, Entry{ deadline, std::move(cb) });
+        Insert(id, deadline);
+        Arm();
+        return id;
+    }
+
+    /// @brief Cancel a registered timeout, no-op if it already fired or was cancelled
+    /// precondition: mMtx is locked.
+    void Cancel(Id id)
+    {
+        // the slot entry is dropped when its slot comes around, the steady_timer is left armed
+        mNumCancelled += mEntries.erase(id);
+    }
+
+    /// precondition: mMtx is locked.
+    size_t Size() const { return mEntries.size(); }
+
+    Duration GetTick() const { return mTick; }
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr unsigned int kSlotBits = 6;
+    static constexpr uint64_t kSlots = uint64_t(1) << kSlotBits;
+    static constexpr unsigned int kLevels = 4;
+
+    struct Entry
+    {
+        uint64_t deadline; ///< tick
+        Callback cb;
+    };
+
+    boost::asio::steady_timer mTimer;
+    TopoMutex& mMtx;
+    Duration mTick;
+    Clock::time_point mStart;
+    uint64_t mNow = 0; ///< last processed tick
+    Id mLastId = 0;
+    size_t mNumCancelled = 0; ///< cancelled entries that may still sit in a slot
+    bool mArmed = false;
+    uint64_t mArmedTick = 0;
+    std::unordered_map<Id, Entry> mEntries;
+    std::vector<std::vector<Id>> mSlots; ///< kLevels * kSlots, level-major
+
+    /// @return first tick at or after t
+    uint64_t TickAt(Clock::time_point t) const
+    {
+        if (t <= mStart) {
+            return 0;
+        }
+        const auto elapsed = std::chrono::duration_cast<Duration>(t - mStart).count();
+        return static_cast<uint64_t>((elapsed + mTick.count() - 1) / mTick.count());
+    }
+
+    std::vector<Id>& Slot(unsigned int level, uint64_t tick) { return mSlots[level * kSlots + ((tick >> (level * kSlotBits)) & (kSlots - 1))]; }
+
+    /// @brief Place an entry at the lowest level on which its deadline shares all higher bits with mNow
+    void Insert(Id id, uint64_t deadline)
+    {
+        unsigned int level = 0;
+        while (level < kLevels && (deadline >> ((level + 1) * kSlotBits)) != (mNow >> ((level + 1) * kSlotBits))) {
+            ++level;
+        }
+        if (level == kLevels) {
+            // beyond the range of the wheel: park in the last slot of the top level to be reached
+            Slot(kLevels - 1, mNow + (kSlots - 1) * (uint64_t(1) << ((kLevels - 1) * kSlotBits))).push_back(id);
+        } else {
+            Slot(level, deadline).push_back(id);
+        }
+    }
+
+    /// @brief Process all ticks up to now
+    void Advance()
+    {
+        const uint64_t target = TickAt(Clock::now());
+        std::vector<Id> due;
+        while (mNow < target && !mEntries.empty()) {
+            ++mNow;
+            // cascade the higher levels whose slot starts at this tick, top-down
+            for (unsigned int level = kLevels - 1; level > 0; --level) {
+                if ((mNow & ((uint64_t(1) << (level * kSlotBits)) - 1)) == 0) {
+                    std::vector<Id> cascaded;
+                    cascaded.swap(Slot(level, mNow));
+                    for (const Id id : cascaded) {
+                        auto it = mEntries.find(id);
+                        if (it != mEntries.end()) {
+                            Insert(id, std::max(it->second.deadline, mNow));
+                        }
+                    }
+                }
+            }
+            due.clear();
+            due.swap(Slot(0, mNow));
+            for (const Id id : due) {
+                auto it = mEntries.find(id);
+                if (it == mEntries.end()) {
+                    continue; // cancelled
+                }
+                Callback cb = std::move(it->second.cb);
+                mEntries.erase(it);
+                cb();
+            }
+        }
+        if (mEntries.empty()) {
+            // nothing left to wait for, skip the idle ticks
+            mNow = std::max(mNow, target);
+            for (auto& slot : mSlots) {
+                slot.clear();
+            }
+            mNumCancelled = 0;
+        }
+    }
+
+    /// @return next tick that needs processing: the next non-empty level 0 slot, or the next cascade
+    uint64_t NextTick()
+    {
+        const uint64_t boundary = ((mNow >> kSlotBits) + 1) << kSlotBits;
+        for (uint64_t tick = mNow + 1; tick < boundary; ++tick) {
+            if (!Slot(0, tick).empty()) {
+                return tick;
+            }
+        }
+        return boundary;
+    }
+
+    void Arm()
+    {
+        if (mEntries.empty()) {
+            return;
+        }
+        const uint64_t next = NextTick();
+        if (mArmed && mArmedTick <= next) {
+            return;
+        }
+        mArmed = true;
+        mArmedTick = next;
+        mTimer.expires_at(mStart + std::chrono::duration_cast<Clock::duration>(mTick * next));
+        mTimer.async_wait([this](std::error_code ec) {
+            if (ec) {
+                return; // re-armed for an earlier tick, or destroyed
+            }
+            std::lock_guard<TopoMutex> lk(mMtx);
+            mArmed = false;
+            Advance();
+            Arm();
+        });
+    }
+};
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYTIMERWHEEL */
@@ -0,0 +1,167 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#ifndef ODC_TOPOLOGYWATCH
+#define ODC_TOPOLOGYWATCH
+
+#include <odc/Error.h>
+#include <odc/TopologyDefs.h>
+#include <odc/TopologyStateStore.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace odc::core
+{
+
+/// State change of a single device
+struct TopoStateDelta
+{
+    DDSTask::Id taskId;
+    DeviceState lastState;
+    DeviceState state;
+    uint64_t version; ///< version of the TopoStateStore after the change
+};
+
+using TopoStateDeltas = std::vector<TopoStateDelta>;
+
+using WatchStateHandlerSignature = void(std::error_code, TopoStateDeltas);
+
+/**
+ * @brief Stream of state changes of a selection of devices to one consumer
+ *
+ * Changes are pushed with the topology state locked and delivered in batches via the post function, one batch at a
+ * time: while the consumer handles a batch, further changes are coalesced to the latest change per device, so a slow
+ * consumer costs at most one pending delta per selected device. Cancel() delivers a final OperationCanceled.
+ */
+class TopoStateWatch : public std::enable_shared_from_this<TopoStateWatch>
+{
+  public:
+    using Handler = std::function<WatchStateHandlerSignature>;
+    using Post = std::function<void(std::function<void()>)>;
+
+    /// @param tasks watched devices
+    /// @param numDevices number of devices in the TopoStateStore
+    /// @param handler called with every batch, and once with OperationCanceled at the end
+    /// @param post runs a function on the executor of the handler
+    TopoStateWatch(TopoTaskSetPtr tasks, size_t numDevices, Handler handler, Post post)
+        : mTasks(std::move(tasks))
+        , mSlots(numDevices, -1)
+        , mHandler(std::move(handler))
+        , mPost(std::move(post))
+    {}
+
+    /// @param index index of the task in TopoStateStore
+    bool Contains(int index) const { return mTasks->Contains(index); }
+    const TopoTaskSetPtr& GetTaskSet() const { return mTasks; }
+
+    /// @brief Queue a change, replacing a pending change of the same device
+    /// @param index index of the task in TopoStateStore
+    void Push(int index, const TopoStateDelta& delta)
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        if (mCanceled) {
+            return;
+        }
+        int32_t& slot = mSlots[index];
+        if (slot >= 0) {
+            mPending[slot] = delta;
+        } else {
+            slot = static_cast<int32_t>(mPending.size());
+            mPending.push_back(delta);
+            mPendingIndices.push_back(index);
+        }
+    }
+
+    /// @brief Deliver the pending changes, unless the consumer is still busy with the previous batch
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lk(mMtx);
+        if (mBusy || mCanceled || mPending.empty()) {
+            return;
+        }
+        TopoStateDeltas batch;
+        batch.swap(mPending);
+        for (const int index : mPendingIndices) {
+            mSlots[index] = -1;
+        }
+        mPendingIndices.clear();
+        mBusy = true;
+        lk.unlock();
+
+        mPost([self = shared_from_this(), batch = std::move(batch)]() mutable {
+            self->mHandler(std::error_code(), std::move(batch));
+            self->Done();
+        });
+    }
+
+    /// @brief Drop the pending changes and deliver OperationCanceled once the consumer is idle
+    void Cancel()
+    {
+        std::unique_lock<std::mutex> lk(mMtx);
+        if (mCanceled) {
+            return;
+        }
+        mCanceled = true;
+        mPending.clear();
+        mPendingIndices.clear();
+        if (!mBusy) {
+            mBusy = true;
+            lk.unlock();
+            PostCanceled();
+        }
+    }
+
+    /// @brief Number of changes waiting for delivery
+    size_t NumPending() const
+    {
+        std::lock_guard<std::mutex> lk(mMtx);
+        return mPending.size();
+    }
+
+  private:
+    TopoTaskSetPtr mTasks;
+    mutable std::mutex mMtx;
+    std::vector<int32_t> mSlots;      ///< task index in TopoStateStore -> position in mPending, -1 if none
+    TopoStateDeltas mPending;         ///< coalesced changes, one per device
+    std::vector<int> mPendingIndices; ///< task indices of mPending
+    bool mBusy = false;               ///< a batch is being delivered
+    bool mCanceled = false;
+    Handler mHandler;
+    Post mPost;
+
+    void Done()
+    {
+        std::unique_lock<std::mutex> lk(mMtx);
+        mBusy = false;
+        if (mCanceled) {
+            mBusy = true;
+            lk.unlock();
+            PostCanceled();
+            return;
+        }
+        lk.unlock();
+        Flush();
+    }
+
+    void PostCanceled()
+    {
+        mPost([self = shared_from_this()]() { self->mHandler(MakeErrorCode(ErrorCode::OperationCanceled), TopoStateDeltas()); });
+    }
+};
+
+using TopoStateWatchPtr = std::shared_ptr<TopoStateWatch>;
+
+} // namespace odc::core
+
+#endif /* ODC_TOPOLOGYWATCH */
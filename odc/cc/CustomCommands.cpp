@@ -25,7 +25,7 @@ namespace odc::cc
 
     array<string, 2> resultNames = { { "Ok", "Failure" } };
 
-    array<string, 15> typeNames = { { "CheckState",
+    array<string, 16> typeNames = { { "CheckState",
                                       "ChangeState",
                                       "DumpConfig",
                                       "SubscribeToStateChange",
@@ -40,7 +40,9 @@ namespace odc::cc
                                       "StateChangeUnsubscription",
                                       "StateChange",
                                       "Properties",
-                                      "PropertiesSet" } };
+                                      "PropertiesSet",
+
+                                      "ChangeStateSequence" } };
 
     array<fair::mq::State, 16> fbStateToMQState = { { fair::mq::State::Undefined,
                                                       fair::mq::State::Ok,
@@ -102,7 +104,7 @@ namespace odc::cc
                                                              FBTransition_End,
                                                              FBTransition_ErrorFound } };
 
-    array<FBCmd, 15> typeToFBCmd = { { FBCmd::FBCmd_check_state,
+    array<FBCmd, 16> typeToFBCmd = { { FBCmd::FBCmd_check_state,
                                        FBCmd::FBCmd_change_state,
                                        FBCmd::FBCmd_dump_config,
                                        FBCmd::FBCmd_subscribe_to_state_change,
@@ -116,9 +118,10 @@ namespace odc::cc
                                        FBCmd::FBCmd_state_change_unsubscription,
                                        FBCmd::FBCmd_state_change,
                                        FBCmd::FBCmd_properties,
-                                       FBCmd::FBCmd_properties_set } };
+                                       FBCmd::FBCmd_properties_set,
+                                       FBCmd::FBCmd_change_state_sequence } };
 
-    array<Type, 15> fbCmdToType = { { Type::check_state,
+    array<Type, 16> fbCmdToType = { { Type::check_state,
                                       Type::change_state,
                                       Type::dump_config,
                                       Type::subscribe_to_state_change,
@@ -132,7 +135,8 @@ namespace odc::cc
                                       Type::state_change_unsubscription,
                                       Type::state_change,
                                       Type::properties,
-                                      Type::properties_set } };
+                                      Type::properties_set,
+                                      Type::change_state_sequence } };
 
     fair::mq::State GetMQState(const FBState state)
     {
@@ -197,6 +201,18 @@ namespace odc::cc
                     cmdBuilder->add_transition(GetFBTransition(static_cast<ChangeState&>(*cmd).GetTransition()));
                 }
                 break;
+                case Type::change_state_sequence:
+                {
+                    vector<int8_t> transitionsVector;
+                    for (const auto t : static_cast<ChangeStateSequence&>(*cmd).GetTransitions())
+                    {
+                        transitionsVector.push_back(GetFBTransition(t));
+                    }
+                    auto transitions = fbb.CreateVector(transitionsVector);
+                    cmdBuilder = make_unique<FBCommandBuilder>(fbb);
+                    cmdBuilder->add_transitions(transitions);
+                }
+                break;
                 case Type::dump_config:
                 {
                     cmdBuilder = make_unique<FBCommandBuilder>(fbb);
@@ -403,6 +419,17 @@ namespace odc::cc
                 case FBCmd_change_state:
                     fCmds.emplace_back(make<ChangeState>(GetMQTransition(cmdPtr.transition())));
                     break;
+                case FBCmd_change_state_sequence:
+                {
+                    std::vector<fair::mq::Transition> transitions;
+                    auto fbTransitions = cmdPtr.transitions();
+                    for (unsigned int j = 0; fbTransitions != nullptr && j < fbTransitions->size(); ++j)
+                    {
+                        transitions.push_back(GetMQTransition(static_cast<FBTransition>(fbTransitions->Get(j))));
+                    }
+                    fCmds.emplace_back(make<ChangeStateSequence>(std::move(transitions)));
+                }
+                break;
                 case FBCmd_dump_config:
                     fCmds.emplace_back(make<DumpConfig>());
                     break;
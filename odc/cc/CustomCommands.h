@@ -50,7 +50,9 @@ namespace odc::cc
         state_change_unsubscription, // args: { device_id, task_id, Result }
         state_change,                // args: { device_id, task_id, last_state, current_state }
         properties,                  // args: { device_id, task_id, request_id, Result, properties }
-        properties_set               // args: { device_id, task_id, request_id, Result }
+        properties_set,              // args: { device_id, task_id, request_id, Result }
+
+        change_state_sequence // args: { transitions }
     };
 
     struct Cmd
@@ -219,6 +221,29 @@ namespace odc::cc
         int64_t fInterval;
     };
 
+    /// Transitions to be applied one after another by the device itself, each one as soon as the previous one
+    /// reached its target state
+    struct ChangeStateSequence : Cmd
+    {
+        explicit ChangeStateSequence(std::vector<fair::mq::Transition> transitions)
+            : Cmd(Type::change_state_sequence)
+            , fTransitions(std::move(transitions))
+        {
+        }
+
+        const std::vector<fair::mq::Transition>& GetTransitions() const
+        {
+            return fTransitions;
+        }
+        void SetTransitions(std::vector<fair::mq::Transition> transitions)
+        {
+            fTransitions = std::move(transitions);
+        }
+
+      private:
+        std::vector<fair::mq::Transition> fTransitions;
+    };
+
     struct TransitionStatus : Cmd
     {
         explicit TransitionStatus(std::string deviceId,
@@ -46,6 +46,12 @@ class GrpcController final : public odc::ODC::Service
     void setHistoryDir(const std::string& dir) { mController.setHistoryDir(dir); }
     void setZoneCfgs(const std::vector<std::string>& zonesStr) { mController.setZoneCfgs(zonesStr); }
     void setRMS(const std::string& rms) { mController.setRMS(rms); }
+    void setFailFast(bool failFast) { mController.setFailFast(failFast); }
+    void setQuorum(bool quorum) { mController.setQuorum(quorum); }
+    void setSubmitConcurrency(size_t concurrency) { mController.setSubmitConcurrency(concurrency); }
+    void setAgentPool(const std::vector<std::string>& groups) { mController.setAgentPool(groups); }
+    void setSessionPoolSize(size_t size) { mController.setSessionPoolSize(size); }
+    void setTopoScriptCache(const std::string& dir, size_t maxEntries, const std::vector<std::string>& envVars, const std::vector<std::string>& inputs) { mController.setTopoScriptCache(dir, maxEntries, envVars, inputs); }
 
     void registerResourcePlugins(const core::PluginManager::PluginMap& pluginMap) { mController.registerResourcePlugins(pluginMap); }
     void restore(const std::string& restoreId, const std::string& restoreDir) { mController.restore(restoreId, restoreDir); }
@@ -37,6 +37,15 @@ int main(int argc, char** argv)
         PluginManager::PluginMap plugins;
         vector<string> zonesStr;
         string rms;
+        bool failFast;
+        bool quorum;
+        size_t submitConcurrency;
+        size_t sessionPoolSize;
+        vector<string> agentPool;
+        string topoScriptCacheDir;
+        size_t topoScriptCacheSize;
+        vector<string> topoScriptCacheEnv;
+        vector<string> topoScriptCacheInputs;
         string restoreId;
         string restoreDir;
         string historyDir;
@@ -51,6 +60,15 @@ int main(int argc, char** argv)
             ("rp", bpo::value<std::vector<std::string>>()->multitoken(), "Register resource plugins ( name1:cmd1 name2:cmd2 )")
             ("zones", bpo::value<vector<string>>(&zonesStr)->multitoken()->composing(), "Zones in <name>:<cfgFilePath>:<envFilePath> format")
             ("rms", bpo::value<string>(&rms)->default_value("localhost"), "Resource management system to be used by DDS (localhost/ssh/slurm)")
+            ("fail-fast", bpo::bool_switch(&failFast)->default_value(false), "Fail state change requests as soon as a device fails that is neither expendable nor covered by nMin, instead of waiting for the timeout")
+            ("quorum", bpo::bool_switch(&quorum)->default_value(false), "Complete state change requests once nMin collections of every collection with nMin reached the target state, ignoring the stragglers")
+            ("submit-concurrency", bpo::value<size_t>(&submitConcurrency)->default_value(4), "Maximum number of agent submissions to the RMS in flight at the same time (zones/agent groups are submitted concurrently)")
+            ("session-pool-size", bpo::value<size_t>(&sessionPoolSize)->default_value(0), "Number of pre-created idle DDS sessions kept for new partitions, refilled in the background (0 disables the pool)")
+            ("agent-pool", bpo::value<vector<string>>(&agentPool)->multitoken()->composing(), "Agents started in every idle session of the session pool, used by the Submit of the partition taking the session, in <zone>:<agentGroup>:<numAgents>:<numSlots>[:<numCores>] format")
+            ("topo-script-cache-dir", bpo::value<string>(&topoScriptCacheDir)->default_value(""), "Cache the output of topology generation scripts in this directory (disabled if empty)")
+            ("topo-script-cache-size", bpo::value<size_t>(&topoScriptCacheSize)->default_value(32), "Maximum number of cached topology script outputs (least recently used are evicted)")
+            ("topo-script-cache-env", bpo::value<vector<string>>(&topoScriptCacheEnv)->multitoken()->composing(), "Environment variables that influence the output of topology scripts (part of the cache key)")
+            ("topo-script-cache-inputs", bpo::value<vector<string>>(&topoScriptCacheInputs)->multitoken()->composing(), "Files/directories read by topology scripts; their size and modification time are part of the cache key")
             ("restore", bpo::value<std::string>(&restoreId)->default_value(""), "If set ODC will restore the sessions from file with specified ID")
             ("restore-dir", bpo::value<std::string>(&restoreDir)->default_value(smart_path(toString("$HOME/.ODC/restore/"))), "Directory where restore files are kept")
             ("history-dir", bpo::value<std::string>(&historyDir)->default_value(smart_path(toString("$HOME/.ODC/history/"))), "Directory where history file (timestamp, partitionId, sessionId) is kept");
@@ -90,6 +108,12 @@ int main(int argc, char** argv)
         controller.setHistoryDir(historyDir);
         controller.setZoneCfgs(zonesStr);
         controller.setRMS(rms);
+        controller.setFailFast(failFast);
+        controller.setQuorum(quorum);
+        controller.setSubmitConcurrency(submitConcurrency);
+        controller.setAgentPool(agentPool);
+        controller.setSessionPoolSize(sessionPoolSize);
+        controller.setTopoScriptCache(topoScriptCacheDir, topoScriptCacheSize, topoScriptCacheEnv, topoScriptCacheInputs);
         controller.registerResourcePlugins(plugins);
         if (!restoreId.empty()) {
             controller.restore(restoreId, restoreDir);
@@ -43,6 +43,8 @@ ODC::ODC(const string& name, const Plugin::Version version, const string& mainta
     , fDeviceTerminationRequested(false)
     , fUpdatesAllowed(false)
     , fWorkGuard(fWorkerQueue.get_executor())
+    , fConnectingChansReady(false)
+    , fSequenceWorkGuard(fSequenceQueue.get_executor())
 {
     try {
         TakeDeviceControl();
@@ -77,6 +79,7 @@ ODC::ODC(const string& name, const Plugin::Version version, const string& mainta
                     // Receive addresses of connecting channels from DDS
                     // and propagate addresses of bound channels to DDS.
                     FillChannelContainers();
+                    fConnectingChansReady = fConnectingChans.empty();
 
                     // allow updates from key value after channel containers are filled
                     {
@@ -95,10 +98,12 @@ ODC::ODC(const string& name, const Plugin::Version version, const string& mainta
                         fUpdatesAllowed = false;
                     }
 
+                    fConnectingChansReady = false;
                     EmptyChannelContainers();
                 } break;
                 case DeviceState::Exiting: {
                     fWorkGuard.reset();
+                    fSequenceWorkGuard.reset();
                     fDeviceTerminationRequested = true;
                     UnsubscribeFromDeviceStateChange();
                     ReleaseDeviceControl();
@@ -130,9 +135,14 @@ ODC::ODC(const string& name, const Plugin::Version version, const string& mainta
                     ++it;
                 }
             }
+
+            if (newState != DeviceState::Exiting) {
+                boost::asio::post(fSequenceQueue, [this]() { AdvanceTransitionSequence(); });
+            }
         });
 
         StartWorkerThread();
+        StartSequenceThread();
 
         fDDS.Start();
     } catch (PluginServices::DeviceControlError& e) {
@@ -153,6 +163,63 @@ void ODC::StartWorkerThread()
     fWorkerThread = thread([this]() { fWorkerQueue.run(); });
 }
 
+void ODC::StartSequenceThread()
+{
+    fSequenceThread = thread([this]() { fSequenceQueue.run(); });
+}
+
+// expected device state after a successful transition
+static const map<Transition, State> gTransitionTarget = {
+    { Transition::InitDevice,   State::InitializingDevice },
+    { Transition::CompleteInit, State::Initialized        },
+    { Transition::Bind,         State::Bound              },
+    { Transition::Connect,      State::DeviceReady        },
+    { Transition::InitTask,     State::Ready              },
+    { Transition::Run,          State::Running            },
+    { Transition::Stop,         State::Ready              },
+    { Transition::ResetTask,    State::DeviceReady        },
+    { Transition::ResetDevice,  State::Idle               },
+    { Transition::End,          State::Exiting            }
+};
+
+void ODC::AdvanceTransitionSequence()
+{
+    using namespace odc::cc;
+    lock_guard<mutex> lock(fSequenceMutex);
+
+    if (fSequence.fNext >= fSequence.fTransitions.size()) {
+        return;
+    }
+
+    DeviceState state = GetCurrentDeviceState();
+    if (state == DeviceState::Error || state == DeviceState::Exiting) {
+        LOG(warn) << "Aborting transition sequence, device is in " << state << " state";
+        fSequence = TransitionSequence();
+        return;
+    }
+    if (fSequence.fNext > 0 && state != fSequence.fAwaitedState) {
+        return; // previous transition still in progress
+    }
+
+    Transition transition = fSequence.fTransitions.at(fSequence.fNext);
+    if (transition == Transition::Connect && !fConnectingChansReady) {
+        LOG(debug) << "Transition sequence: waiting for the addresses of the connecting channels before " << transition;
+        return;
+    }
+
+    auto it = gTransitionTarget.find(transition);
+    fSequence.fAwaitedState = it != gTransitionTarget.end() ? it->second : DeviceState::Undefined;
+    ++fSequence.fNext;
+
+    if (!ChangeDeviceState(transition)) {
+        string id = GetProperty<string>("id");
+        LOG(error) << "Transition sequence: " << transition << " transition failed in " << GetCurrentDeviceState() << " state";
+        Cmds outCmds(make<TransitionStatus>(id, fDDSTaskId, Result::Failure, transition, GetCurrentDeviceState()));
+        fDDS.Send(outCmds.Serialize(), to_string(fSequence.fSenderId));
+        fSequence = TransitionSequence();
+    }
+}
+
 void ODC::FillChannelContainers()
 {
     try {
@@ -279,8 +346,11 @@ void ODC::SubscribeForConnectingChannels()
                     fConnectingChans.at(channelName).fDDSValues.insert({ senderTaskID, val.c_str() });
                 }
 
+                bool allChansReady = true;
                 for (const auto& mi : fConnectingChans) {
-                    if (mi.second.fNumSubChannels == mi.second.fDDSValues.size()) {
+                    if (mi.second.fNumSubChannels != mi.second.fDDSValues.size()) {
+                        allChansReady = false;
+                    } else {
                         int i = 0;
                         for (const auto& e : mi.second.fDDSValues) {
                             auto result = UpdateProperty<string>(string{ "chans." + mi.first + "." + to_string(i) + ".address" }, e.second);
@@ -293,6 +363,11 @@ void ODC::SubscribeForConnectingChannels()
                         }
                     }
                 }
+
+                if (allChansReady && !fConnectingChansReady) {
+                    fConnectingChansReady = true;
+                    boost::asio::post(fSequenceQueue, [this]() { AdvanceTransitionSequence(); });
+                }
             } catch (const exception& e) {
                 LOG(error) << "Error handling DDS property: key=" << key << ", value=" << value << ", senderTaskID=" << senderTaskID << ": " << e.what();
             }
@@ -337,6 +412,11 @@ void ODC::HandleCmd(const string& id, odc::cc::Cmd& cmd, const string& cond, uin
             fDDS.Send(cmds.Serialize(), to_string(senderId));
         } break;
         case Type::change_state: {
+            {
+                // an explicit transition request replaces any transition sequence in progress
+                lock_guard<mutex> lock(fSequenceMutex);
+                fSequence = TransitionSequence();
+            }
             Transition transition = static_cast<ChangeState&>(cmd).GetTransition();
             // LOG(info) << "Transition requested: '" << static_cast<ChangeState&>(cmd).GetTransition() << "'";
             if (ChangeDeviceState(transition)) {
@@ -348,6 +428,15 @@ void ODC::HandleCmd(const string& id, odc::cc::Cmd& cmd, const string& cond, uin
                 fDDS.Send(outCmds.Serialize(), to_string(senderId));
             }
         } break;
+        case Type::change_state_sequence: {
+            {
+                lock_guard<mutex> lock(fSequenceMutex);
+                fSequence = TransitionSequence();
+                fSequence.fTransitions = static_cast<ChangeStateSequence&>(cmd).GetTransitions();
+                fSequence.fSenderId = senderId;
+            }
+            boost::asio::post(fSequenceQueue, [this]() { AdvanceTransitionSequence(); });
+        } break;
         case Type::dump_config: {
             stringstream ss;
             for (const auto& pKey : GetPropertyKeys()) {
@@ -435,6 +524,11 @@ ODC::~ODC()
     if (fWorkerThread.joinable()) {
         fWorkerThread.join();
     }
+
+    fSequenceWorkGuard.reset();
+    if (fSequenceThread.joinable()) {
+        fSequenceThread.join();
+    }
 }
 
 } // namespace odc::plugins
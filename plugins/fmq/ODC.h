@@ -134,6 +134,7 @@ class ODC : public fair::mq::Plugin
 
   private:
     void StartWorkerThread();
+    void StartSequenceThread();
 
     void FillChannelContainers();
     void EmptyChannelContainers();
@@ -142,6 +143,7 @@ class ODC : public fair::mq::Plugin
     void PublishBoundChannels();
     void SubscribeForCustomCommands();
     void HandleCmd(const std::string& id, cc::Cmd& cmd, const std::string& cond, uint64_t senderId);
+    void AdvanceTransitionSequence();
 
     DDSSubscription fDDS;
     size_t fDDSTaskId;
@@ -166,6 +168,23 @@ class ODC : public fair::mq::Plugin
     std::thread fWorkerThread;
     boost::asio::io_context fWorkerQueue;
     boost::asio::executor_work_guard<boost::asio::executor> fWorkGuard;
+
+    // transition sequence requested via cc::ChangeStateSequence, advanced by the device itself on every state change
+    struct TransitionSequence
+    {
+        std::vector<fair::mq::Transition> fTransitions;
+        size_t fNext = 0;                                  // index of the next transition to request
+        DeviceState fAwaitedState = DeviceState::Undefined; // state the last requested transition leads to
+        uint64_t fSenderId = 0;                            // controller to report failures to
+    };
+    TransitionSequence fSequence;
+    std::mutex fSequenceMutex;
+    std::atomic<bool> fConnectingChansReady; // all connecting channels received their addresses
+
+    // separate from the worker queue, which blocks on channel updates until the device is Bound
+    std::thread fSequenceThread;
+    boost::asio::io_context fSequenceQueue;
+    boost::asio::executor_work_guard<boost::asio::executor> fSequenceWorkGuard;
 };
 
 inline fair::mq::Plugin::ProgOptions ODCPluginProgramOptions()
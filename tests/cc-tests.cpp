@@ -24,6 +24,7 @@ BOOST_AUTO_TEST_SUITE(format)
 BOOST_AUTO_TEST_CASE(construction)
 {
     auto const props(std::vector<std::pair<std::string, std::string>>({ { "k1", "v1" }, { "k2", "v2" } }));
+    auto const transitions(std::vector<Transition>({ Transition::InitDevice, Transition::CompleteInit, Transition::Bind }));
 
     Cmds checkStateCmds(make<CheckState>());
     Cmds changeStateCmds(make<ChangeState>(fair::mq::Transition::Stop));
@@ -40,6 +41,7 @@ BOOST_AUTO_TEST_CASE(construction)
     Cmds stateChangeCmds(make<StateChange>("somedeviceid", 123456, State::Running, State::Ready));
     Cmds propertiesCmds(make<Properties>("somedeviceid", 123456, 66, Result::Ok, props));
     Cmds propertiesSetCmds(make<PropertiesSet>("somedeviceid", 123456, 42, Result::Ok));
+    Cmds changeStateSequenceCmds(make<ChangeStateSequence>(transitions));
 
     BOOST_TEST(checkStateCmds.At(0).GetType() == Type::check_state);
 
@@ -103,6 +105,9 @@ BOOST_AUTO_TEST_CASE(construction)
     BOOST_TEST(static_cast<Properties&>(propertiesSetCmds.At(0)).GetTaskId() == 123456);
     BOOST_TEST(static_cast<PropertiesSet&>(propertiesSetCmds.At(0)).GetRequestId() == 42);
     BOOST_TEST(static_cast<PropertiesSet&>(propertiesSetCmds.At(0)).GetResult() == Result::Ok);
+
+    BOOST_TEST(changeStateSequenceCmds.At(0).GetType() == Type::change_state_sequence);
+    BOOST_TEST(static_cast<ChangeStateSequence&>(changeStateSequenceCmds.At(0)).GetTransitions() == transitions);
 }
 
 void fillCommands(Cmds& cmds)
@@ -124,14 +129,16 @@ void fillCommands(Cmds& cmds)
     cmds.Add<StateChange>("somedeviceid", 123456, State::Running, State::Ready);
     cmds.Add<Properties>("somedeviceid", 123456, 66, Result::Ok, props);
     cmds.Add<PropertiesSet>("somedeviceid", 123456, 42, Result::Ok);
+    cmds.Add<ChangeStateSequence>(std::vector<Transition>({ Transition::InitDevice, Transition::CompleteInit, Transition::Bind }));
 }
 
 void checkCommands(Cmds& cmds)
 {
-    BOOST_TEST(cmds.Size() == 15);
+    BOOST_TEST(cmds.Size() == 16);
 
     int count = 0;
     auto const props(std::vector<std::pair<std::string, std::string>>({ { "k1", "v1" }, { "k2", "v2" } }));
+    auto const transitions(std::vector<Transition>({ Transition::InitDevice, Transition::CompleteInit, Transition::Bind }));
 
     for (const auto& cmd : cmds) {
         switch (cmd->GetType()) {
@@ -213,13 +220,17 @@ void checkCommands(Cmds& cmds)
                 BOOST_TEST(static_cast<PropertiesSet&>(*cmd).GetRequestId() == 42);
                 BOOST_TEST(static_cast<PropertiesSet&>(*cmd).GetResult() == Result::Ok);
                 break;
+            case Type::change_state_sequence:
+                ++count;
+                BOOST_TEST(static_cast<ChangeStateSequence&>(*cmd).GetTransitions() == transitions);
+                break;
             default:
                 BOOST_TEST(false);
                 break;
         }
     }
 
-    BOOST_TEST(count == 15);
+    BOOST_TEST(count == 16);
 }
 
 BOOST_AUTO_TEST_CASE(serialization_binary)
@@ -14,6 +14,9 @@
 
 #include <array>
 #include <boost/asio.hpp>
+#include <chrono>
+#include <functional>
+#include <future>
 #include <thread>
 
 using namespace boost::unit_test;
@@ -138,6 +141,35 @@ BOOST_AUTO_TEST_CASE(construction2)
     Topology topo(f.mIoContext.get_executor(), f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
 }
 
+BOOST_AUTO_TEST_CASE(reconnects_to_added)
+{
+    BOOST_REQUIRE(framework::master_test_suite().argc >= 3);
+    BOOST_REQUIRE_EQUAL(framework::master_test_suite().argv[1], "--topo-file");
+    dds::topology_api::CTopology ddsTopo(framework::master_test_suite().argv[2]);
+
+    std::vector<DDSTask::Id> samplers;
+    std::vector<DDSTask::Id> processors;
+    std::vector<DDSTask::Id> all;
+    auto itPair = ddsTopo.getRuntimeTaskIterator(nullptr);
+    for (const auto& [id, task] : boost::make_iterator_range(itPair.first, itPair.second)) {
+        if (task.m_task->getName() == "Sampler") {
+            samplers.push_back(id);
+        } else if (task.m_task->getName() == "Processor") {
+            processors.push_back(id);
+        }
+        all.push_back(id);
+    }
+    BOOST_REQUIRE(!samplers.empty());
+    BOOST_REQUIRE(!processors.empty());
+
+    // the kept processors connect to the channel the added samplers bind
+    BOOST_TEST(Topology::ReconnectsToAdded(ddsTopo, samplers));
+    // the added processors connect to the kept samplers and sinks, which do not have to reconnect
+    BOOST_TEST(!Topology::ReconnectsToAdded(ddsTopo, processors));
+    BOOST_TEST(!Topology::ReconnectsToAdded(ddsTopo, all));
+    BOOST_TEST(!Topology::ReconnectsToAdded(ddsTopo, {}));
+}
+
 BOOST_AUTO_TEST_CASE(async_change_state)
 {
     BOOST_REQUIRE(framework::master_test_suite().argc >= 3);
@@ -146,7 +178,7 @@ BOOST_AUTO_TEST_CASE(async_change_state)
 
     SharedSemaphore blocker;
     Topology topo(f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
-    topo.AsyncChangeState(TopoTransition::InitDevice, [=](std::error_code ec, TopoState) mutable {
+    topo.AsyncChangeState(TopoTransition::InitDevice, [=](std::error_code ec, TopoStateSnapshotPtr) mutable {
         BOOST_TEST_MESSAGE(ec);
         BOOST_CHECK_EQUAL(ec, std::error_code());
         blocker.Signal();
@@ -161,7 +193,7 @@ BOOST_AUTO_TEST_CASE(async_change_state_with_executor)
     TopologyFixture f(framework::master_test_suite().argv[2]);
 
     Topology topo(f.mIoContext.get_executor(), f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
-    topo.AsyncChangeState(TopoTransition::InitDevice, [](std::error_code ec, TopoState) {
+    topo.AsyncChangeState(TopoTransition::InitDevice, [](std::error_code ec, TopoStateSnapshotPtr) {
         BOOST_TEST_MESSAGE(ec);
         BOOST_CHECK_EQUAL(ec, std::error_code());
     });
@@ -169,6 +201,68 @@ BOOST_AUTO_TEST_CASE(async_change_state_with_executor)
     f.mIoContext.run();
 }
 
+BOOST_AUTO_TEST_CASE(async_change_state_chained_on_strand)
+{
+    BOOST_REQUIRE(framework::master_test_suite().argc >= 3);
+    BOOST_REQUIRE_EQUAL(framework::master_test_suite().argv[1], "--topo-file");
+    TopologyFixture f(framework::master_test_suite().argv[2]);
+
+    Topology topo(f.mIoContext.get_executor(), f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr, false, TopoSerialization::Strand);
+
+    std::vector<TopoTransition> transitions;
+    full_device_lifecycle([&](TopoTransition transition) { transitions.push_back(transition); });
+
+    // every completion handler (running on the strand) starts a wait for the reached state and the next transition
+    size_t numChanges = 0;
+    size_t numWaits = 0;
+    std::function<void(size_t)> next = [&](size_t i) {
+        if (i == transitions.size()) {
+            return;
+        }
+        topo.AsyncChangeState(transitions[i], [&, i](std::error_code ec, TopoStateSnapshotPtr) {
+            BOOST_CHECK_EQUAL(ec, std::error_code());
+            if (ec) {
+                return;
+            }
+            ++numChanges;
+            if (transitions[i] != TopoTransition::End) {
+                topo.AsyncWaitForState(gExpectedState.at(transitions[i]), [&](std::error_code waitEc) {
+                    BOOST_CHECK_EQUAL(waitEc, std::error_code());
+                    ++numWaits;
+                });
+            }
+            next(i + 1);
+        });
+    };
+    next(0);
+
+    f.mIoContext.run();
+    BOOST_TEST(numChanges == transitions.size());
+    BOOST_TEST(numWaits == transitions.size() - 1);
+}
+
+BOOST_AUTO_TEST_CASE(subscribe_on_activation)
+{
+    BOOST_REQUIRE(framework::master_test_suite().argc >= 3);
+    BOOST_REQUIRE_EQUAL(framework::master_test_suite().argv[1], "--topo-file");
+    TopologyFixture f(framework::master_test_suite().argv[2]);
+
+    Topology topo(f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr, false, TopoSerialization::Mutex, true);
+    const TopoState initial = topo.GetCurrentState();
+    BOOST_REQUIRE(!initial.empty());
+    for (const auto& ds : initial) {
+        BOOST_TEST(!ds.subscribedToStateChanges);
+    }
+
+    // the devices run already: report one of them activated, FinishActivation() subscribes to the others by task id
+    topo.OnTaskActivated(initial.front().taskId);
+    topo.FinishActivation();
+    BOOST_REQUIRE_EQUAL(topo.WaitForState(DeviceState::Idle, "", std::chrono::seconds(30)), std::error_code());
+    for (const auto& ds : topo.GetCurrentState()) {
+        BOOST_TEST(ds.subscribedToStateChanges);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(async_change_state_future)
 {
     BOOST_REQUIRE(framework::master_test_suite().argc >= 3);
@@ -205,7 +299,7 @@ BOOST_AUTO_TEST_CASE(async_change_state_coroutine)
             auto executor = co_await boost::asio::this_coro::executor;
             Topology topo(executor, f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
             try {
-                TopoState state = co_await topo.AsyncChangeState(TopoTransition::InitDevice, asio::use_awaitable);
+                TopoStateSnapshotPtr state = co_await topo.AsyncChangeState(TopoTransition::InitDevice, asio::use_awaitable);
                 success = true;
             } catch (const std::system_error& ex) {
                 BOOST_TEST_MESSAGE(ex.what());
@@ -229,8 +323,8 @@ BOOST_AUTO_TEST_CASE(change_state)
     BOOST_TEST_MESSAGE(result.first);
 
     BOOST_CHECK_EQUAL(result.first, std::error_code());
-    BOOST_CHECK_NO_THROW(AggregateState(result.second));
-    BOOST_CHECK_EQUAL(StateEqualsTo(result.second, DeviceState::InitializingDevice), true);
+    BOOST_CHECK_NO_THROW(AggregateState(result.second->state));
+    BOOST_CHECK_EQUAL(StateEqualsTo(result.second->state, DeviceState::InitializingDevice), true);
     auto const currentState = topo.GetCurrentState();
     BOOST_CHECK_NO_THROW(AggregateState(currentState));
     BOOST_CHECK_EQUAL(StateEqualsTo(currentState, DeviceState::InitializingDevice), true);
@@ -247,8 +341,8 @@ BOOST_AUTO_TEST_CASE(mixed_state)
     BOOST_TEST_MESSAGE(result1.first);
 
     BOOST_CHECK_EQUAL(result1.first, std::error_code());
-    BOOST_CHECK_EQUAL(AggregateState(result1.second), AggregatedState::Mixed);
-    BOOST_CHECK_EQUAL(StateEqualsTo(result1.second, DeviceState::InitializingDevice), false);
+    BOOST_CHECK_EQUAL(AggregateState(result1.second->state), AggregatedState::Mixed);
+    BOOST_CHECK_EQUAL(StateEqualsTo(result1.second->state, DeviceState::InitializingDevice), false);
     auto const currentState1 = topo.GetCurrentState();
     BOOST_CHECK_EQUAL(AggregateState(currentState1), AggregatedState::Mixed);
     BOOST_CHECK_EQUAL(StateEqualsTo(currentState1, DeviceState::InitializingDevice), false);
@@ -257,8 +351,8 @@ BOOST_AUTO_TEST_CASE(mixed_state)
     BOOST_TEST_MESSAGE(result2.first);
 
     BOOST_CHECK_EQUAL(result2.first, std::error_code());
-    BOOST_CHECK_EQUAL(AggregateState(result2.second), AggregatedState::InitializingDevice);
-    BOOST_CHECK_EQUAL(StateEqualsTo(result2.second, DeviceState::InitializingDevice), true);
+    BOOST_CHECK_EQUAL(AggregateState(result2.second->state), AggregatedState::InitializingDevice);
+    BOOST_CHECK_EQUAL(StateEqualsTo(result2.second->state, DeviceState::InitializingDevice), true);
     auto const currentState2 = topo.GetCurrentState();
     BOOST_CHECK_EQUAL(AggregateState(currentState2), AggregatedState::InitializingDevice);
     BOOST_CHECK_EQUAL(StateEqualsTo(currentState2, DeviceState::InitializingDevice), true);
@@ -271,11 +365,11 @@ BOOST_AUTO_TEST_CASE(async_change_state_concurrent)
     TopologyFixture f(framework::master_test_suite().argv[2]);
 
     Topology topo(f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
-    topo.AsyncChangeState(TopoTransition::InitDevice, ".*/(Sampler|Sink).*", [](std::error_code ec, TopoState) mutable {
+    topo.AsyncChangeState(TopoTransition::InitDevice, ".*/(Sampler|Sink).*", [](std::error_code ec, TopoStateSnapshotPtr) mutable {
         BOOST_TEST_MESSAGE("ChangeState for Sampler|Sink: " << ec);
         BOOST_CHECK_EQUAL(ec, std::error_code());
     });
-    topo.AsyncChangeState(TopoTransition::InitDevice, ".*/Processor.*", [](std::error_code ec, TopoState) mutable {
+    topo.AsyncChangeState(TopoTransition::InitDevice, ".*/Processor.*", [](std::error_code ec, TopoStateSnapshotPtr) mutable {
         BOOST_TEST_MESSAGE("ChangeState for Processors: " << ec);
         BOOST_CHECK_EQUAL(ec, std::error_code());
     });
@@ -293,7 +387,7 @@ BOOST_AUTO_TEST_CASE(async_change_state_timeout)
     TopologyFixture f(framework::master_test_suite().argv[2]);
 
     Topology topo(f.mIoContext.get_executor(), f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
-    topo.AsyncChangeState(TopoTransition::InitDevice, std::chrono::milliseconds(1), [](std::error_code ec, TopoState) {
+    topo.AsyncChangeState(TopoTransition::InitDevice, std::chrono::milliseconds(1), [](std::error_code ec, TopoStateSnapshotPtr) {
         BOOST_TEST_MESSAGE(ec);
         BOOST_CHECK_EQUAL(ec, MakeErrorCode(ErrorCode::OperationTimeout));
     });
@@ -309,9 +403,9 @@ BOOST_AUTO_TEST_CASE(async_change_state_collection_view)
 
     SharedSemaphore blocker;
     Topology topo(f.mDDSTopo, f.mDDSSession, f.mExpendableTasks, f.mCollectionInfo, "", f.mLastRunNr);
-    topo.AsyncChangeState(TopoTransition::InitDevice, [=](std::error_code ec, TopoState state) mutable {
+    topo.AsyncChangeState(TopoTransition::InitDevice, [=](std::error_code ec, TopoStateSnapshotPtr state) mutable {
         BOOST_TEST_MESSAGE(ec);
-        TopoStateByCollection cstate(GroupByCollectionId(state));
+        TopoStateByCollection cstate(GroupByCollectionId(state->state));
         BOOST_TEST_MESSAGE("num collections: " << cstate.size());
         BOOST_REQUIRE_EQUAL(cstate.size(), 1);
         for (const auto& c : cstate) {
@@ -674,7 +768,7 @@ BOOST_AUTO_TEST_CASE(change_state_full_lifecycle_serial)
             ioContext.post([&f, &topos, i, transition]() {
                 auto [ec, state] = topos[i].ChangeState(transition);
                 BOOST_REQUIRE_EQUAL(ec, std::error_code());
-                BOOST_TEST_MESSAGE(f[i].mDDSSession.getSessionID() << ": " << AggregateState(state) << " -> " << ec);
+                BOOST_TEST_MESSAGE(f[i].mDDSSession.getSessionID() << ": " << AggregateState(state->state) << " -> " << ec);
             });
         });
     }
@@ -704,7 +798,7 @@ BOOST_AUTO_TEST_CASE(change_state_full_lifecycle_interleaved)
             ioContext.post([&f, &topos, i, transition]() {
                 auto [ec, state] = topos[i].ChangeState(transition);
                 BOOST_REQUIRE_EQUAL(ec, std::error_code());
-                BOOST_TEST_MESSAGE(f[i].mDDSSession.getSessionID() << ": " << AggregateState(state) << " -> " << ec);
+                BOOST_TEST_MESSAGE(f[i].mDDSSession.getSessionID() << ": " << AggregateState(state->state) << " -> " << ec);
             });
         }
     });
@@ -730,6 +824,70 @@ BOOST_AUTO_TEST_CASE(change_state_full_lifecycle_concurrent)
     t1.join();
 }
 
+/// Drive the full device lifecycle of several topologies concurrently on a shared thread pool
+/// @return elapsed time and the first error of each topology
+auto run_concurrent_lifecycles(TopoSerialization serialization)
+{
+    constexpr auto num(3);
+    std::array<TopologyFixture, num> f{ TopologyFixture(framework::master_test_suite().argv[2]),
+                                        TopologyFixture(framework::master_test_suite().argv[2]),
+                                        TopologyFixture(framework::master_test_suite().argv[2]) };
+
+    boost::asio::thread_pool pool(num);
+    std::vector<std::unique_ptr<Topology>> topos;
+    for (auto& fixture : f) {
+        topos.push_back(std::make_unique<Topology>(pool.get_executor(), fixture.mDDSTopo, fixture.mDDSSession, fixture.mExpendableTasks, fixture.mCollectionInfo, "", fixture.mLastRunNr, true, serialization));
+    }
+
+    std::vector<TopoTransition> transitions;
+    full_device_lifecycle([&](TopoTransition transition) { transitions.push_back(transition); });
+
+    std::array<std::error_code, num> errors;
+    std::atomic<int> remaining(num);
+    std::promise<void> done;
+    // each completion initiates the next transition of its topology
+    std::function<void(int, size_t)> next = [&](int t, size_t i) {
+        if (i == transitions.size() || errors[t]) {
+            if (--remaining == 0) {
+                done.set_value();
+            }
+            return;
+        }
+        topos[t]->AsyncChangeState(transitions[i], [&, t, i](std::error_code ec, TopoStateSnapshotPtr) {
+            errors[t] = ec;
+            next(t, i + 1);
+        });
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < num; ++t) {
+        next(t, 0);
+    }
+    done.get_future().wait();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    topos.clear();
+    pool.join();
+    return std::make_pair(elapsed, errors);
+}
+
+BOOST_AUTO_TEST_CASE(change_state_full_lifecycle_concurrent_mutex_vs_strand)
+{
+    BOOST_REQUIRE(framework::master_test_suite().argc >= 3);
+    BOOST_REQUIRE_EQUAL(framework::master_test_suite().argv[1], "--topo-file");
+
+    const auto [mutexTime, mutexErrors] = run_concurrent_lifecycles(TopoSerialization::Mutex);
+    for (const auto& ec : mutexErrors) {
+        BOOST_CHECK_EQUAL(ec, std::error_code());
+    }
+    const auto [strandTime, strandErrors] = run_concurrent_lifecycles(TopoSerialization::Strand);
+    for (const auto& ec : strandErrors) {
+        BOOST_CHECK_EQUAL(ec, std::error_code());
+    }
+
+    BOOST_TEST_MESSAGE("Concurrent full lifecycle of 3 topologies: mutex " << mutexTime.count() << " ms, strand " << strandTime.count() << " ms");
+}
+
 BOOST_AUTO_TEST_SUITE_END() // multiple_topologies
 
 int main(int argc, char* argv[]) { return boost::unit_test::unit_test_main(init_unit_test, argc, argv); }
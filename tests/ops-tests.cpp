@@ -0,0 +1,1102 @@
+/********************************************************************************
+ * Copyright (C) 2019-2022 GSI Helmholtzzentrum fuer Schwerionenforschung GmbH  *
+ *                                                                              *
+ *              This software is distributed under the terms of the             *
+ *              GNU Lesser General Public Licence (LGPL) version 3,             *
+ *                  copied verbatim in the file "LICENSE"                       *
+ ********************************************************************************/
+
+#define BOOST_TEST_MODULE(odc_topology_ops)
+#define BOOST_TEST_NO_MAIN
+#define BOOST_TEST_ALTERNATIVE_INIT_API
+#include <boost/test/included/unit_test.hpp>
+
+#include <odc/AsioBase.h>
+#include <odc/MPSCQueue.h>
+#include <odc/MiscUtils.h>
+#include <odc/TopologyAllocator.h>
+#include <odc/TopologyDefs.h>
+#include <odc/TopologyOpChangeState.h>
+#include <odc/TopologyOpGetProperties.h>
+#include <odc/TopologyPathIndex.h>
+#include <odc/TopologyStateCounters.h>
+#include <odc/TopologyStateStore.h>
+#include <odc/TopologyTimerWheel.h>
+#include <odc/TopologyWatch.h>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace boost::unit_test;
+using namespace odc::core;
+
+/// Number of global heap allocations of this process, see the replaced operator new below
+std::atomic<size_t> gNumAllocations{ 0 };
+
+void* operator new(std::size_t size)
+{
+    ++gNumAllocations;
+    if (void* p = std::malloc(size > 0 ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+/// Memory resource counting the allocations it forwards upstream
+struct CountingResource : std::pmr::memory_resource
+{
+    explicit CountingResource(std::pmr::memory_resource* upstream)
+        : mUpstream(upstream)
+    {}
+
+    size_t mNumAllocations = 0;
+
+  private:
+    std::pmr::memory_resource* mUpstream;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        ++mNumAllocations;
+        return mUpstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override { mUpstream->deallocate(p, bytes, alignment); }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+struct OpsFixture
+{
+    /// Builds a flat topology state of n tasks, every second task belongs to a collection
+    explicit OpsFixture(size_t n)
+    {
+        mStateData.Reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            const DDSTask::Id taskId = 1000000 + i * 7;
+            const DDSCollection::Id collectionId = (i % 2 == 0) ? 0 : 500000 + i / 2;
+            const int index = mStateData.Add(taskId, collectionId, false);
+            mStateData.SetState(index, DeviceState::Undefined, DeviceState::Idle);
+            mTasks.emplace_back(taskId, collectionId);
+        }
+    }
+
+    TopoTaskSetPtr MakeTaskSet() const { return std::make_shared<const TopoTaskSet>(mTasks, mStateData); }
+
+    boost::asio::io_context mIoContext;
+    TopoMutex mMtx;
+    TopoTimerWheel mTimers{ mIoContext.get_executor(), mMtx };
+    TopoStateStore mStateData;
+    std::vector<DDSTask> mTasks;
+};
+
+/// Runs a full InitDevice ChangeStateOp over all tasks and returns the time spent processing state updates
+/// @param numAllocations set to the number of heap allocations done while processing the state updates
+std::chrono::nanoseconds RunChangeState(OpsFixture& f, size_t& numAllocations)
+{
+    bool completed = false;
+    std::error_code result;
+    ChangeStateOp<DefaultExecutor, DefaultAllocator> op(1,
+                                                        TopoTransition::InitDevice,
+                                                        f.MakeTaskSet(),
+                                                        f.mStateData,
+                                                        Duration(0),
+                                                        f.mMtx,
+                                                        f.mTimers,
+                                                        f.mIoContext.get_executor(),
+                                                        DefaultAllocator(),
+                                                        [&](std::error_code ec, TopoStateSnapshotPtr) {
+                                                            completed = true;
+                                                            result = ec;
+                                                        });
+
+    const size_t startAllocations = gNumAllocations;
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<TopoMutex> lk(f.mMtx);
+        op.ResetCount(f.mStateData);
+        for (size_t i = 0; i < f.mStateData.Size(); ++i) {
+            const int index = static_cast<int>(i);
+            f.mStateData.SetState(index, f.mStateData.State(index), DeviceState::InitializingDevice);
+            op.Update(index, f.mStateData.TaskId(index), DeviceState::InitializingDevice, false);
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    numAllocations = gNumAllocations - startAllocations;
+
+    f.mIoContext.run();
+    f.mIoContext.restart();
+
+    BOOST_REQUIRE(completed);
+    BOOST_REQUIRE(!result);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed);
+}
+
+BOOST_AUTO_TEST_SUITE(task_set)
+
+BOOST_AUTO_TEST_CASE(membership)
+{
+    OpsFixture f(10);
+    std::vector<DDSTask> selection;
+    for (const auto& task : f.mTasks) {
+        if (task.GetCollectionId() != 0) {
+            selection.push_back(task);
+        }
+    }
+    TopoTaskSet set(selection, f.mStateData);
+
+    BOOST_TEST(set.Size() == 5);
+    BOOST_TEST(set.Indices().size() == 5);
+    for (size_t i = 0; i < f.mStateData.Size(); ++i) {
+        BOOST_TEST(set.Contains(static_cast<int>(i)) == (f.mStateData.CollectionId(i) != 0));
+    }
+    BOOST_TEST(!set.Contains(-1));
+    BOOST_TEST(!set.Contains(static_cast<int>(f.mStateData.Size())));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(change_state)
+
+BOOST_AUTO_TEST_CASE(completion_on_partial_selection)
+{
+    OpsFixture f(100);
+    std::vector<DDSTask> selection(f.mTasks.begin(), f.mTasks.begin() + 10);
+    bool completed = false;
+    ChangeStateOp<DefaultExecutor, DefaultAllocator> op(1,
+                                                        TopoTransition::InitDevice,
+                                                        std::make_shared<const TopoTaskSet>(selection, f.mStateData),
+                                                        f.mStateData,
+                                                        Duration(0),
+                                                        f.mMtx,
+                                                        f.mTimers,
+                                                        f.mIoContext.get_executor(),
+                                                        DefaultAllocator(),
+                                                        [&](std::error_code ec, TopoStateSnapshotPtr) {
+                                                            BOOST_TEST(!ec);
+                                                            completed = true;
+                                                        });
+    {
+        std::lock_guard<TopoMutex> lk(f.mMtx);
+        op.ResetCount(f.mStateData);
+        // updates of tasks outside of the selection must not count
+        for (int i = 10; i < 100; ++i) {
+            op.Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+        }
+        BOOST_TEST(!op.IsCompleted());
+        for (int i = 0; i < 10; ++i) {
+            op.Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+        }
+        BOOST_TEST(op.IsCompleted());
+    }
+    f.mIoContext.run();
+    BOOST_TEST(completed);
+}
+
+BOOST_AUTO_TEST_CASE(completion_callback)
+{
+    OpsFixture f(10);
+    std::vector<uint64_t> completedIds;
+    ChangeStateOp<DefaultExecutor, DefaultAllocator> op(42,
+                                                        TopoTransition::InitDevice,
+                                                        f.MakeTaskSet(),
+                                                        f.mStateData,
+                                                        Duration(0),
+                                                        f.mMtx,
+                                                        f.mTimers,
+                                                        f.mIoContext.get_executor(),
+                                                        DefaultAllocator(),
+                                                        [](std::error_code, TopoStateSnapshotPtr) {});
+    std::lock_guard<TopoMutex> lk(f.mMtx);
+    op.SetCompletionCallback([&](uint64_t id) { completedIds.push_back(id); });
+    op.ResetCount(f.mStateData);
+    for (int i = 0; i < 9; ++i) {
+        op.Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+    }
+    BOOST_TEST(completedIds.empty());
+    op.Update(9, f.mStateData.TaskId(9), DeviceState::Error, false);
+    BOOST_TEST(op.IsCompleted());
+    BOOST_TEST(completedIds.size() == 1);
+    BOOST_TEST(completedIds.front() == 42);
+}
+
+BOOST_AUTO_TEST_CASE(completion_callback_on_timeout)
+{
+    OpsFixture f(10);
+    std::vector<uint64_t> completedIds;
+    std::error_code result;
+    ChangeStateOp<DefaultExecutor, DefaultAllocator> op(7,
+                                                        TopoTransition::InitDevice,
+                                                        f.MakeTaskSet(),
+                                                        f.mStateData,
+                                                        std::chrono::milliseconds(10),
+                                                        f.mMtx,
+                                                        f.mTimers,
+                                                        f.mIoContext.get_executor(),
+                                                        DefaultAllocator(),
+                                                        [&](std::error_code ec, TopoStateSnapshotPtr) { result = ec; });
+    {
+        std::lock_guard<TopoMutex> lk(f.mMtx);
+        op.SetCompletionCallback([&](uint64_t id) { completedIds.push_back(id); });
+        op.ResetCount(f.mStateData);
+    }
+    f.mIoContext.run();
+    BOOST_TEST(op.IsCompleted());
+    BOOST_TEST(result == MakeErrorCode(ErrorCode::OperationTimeout));
+    BOOST_TEST(completedIds.size() == 1);
+    BOOST_TEST(completedIds.front() == 7);
+}
+
+BOOST_AUTO_TEST_CASE(fail_fast)
+{
+    for (const bool failFast : { false, true }) {
+        OpsFixture f(10);
+        std::error_code result;
+        ChangeStateOp<DefaultExecutor, DefaultAllocator> op(1,
+                                                            TopoTransition::InitDevice,
+                                                            f.MakeTaskSet(),
+                                                            f.mStateData,
+                                                            Duration(0),
+                                                            f.mMtx,
+                                                            f.mTimers,
+                                                            f.mIoContext.get_executor(),
+                                                            DefaultAllocator(),
+                                                            [&](std::error_code ec, TopoStateSnapshotPtr) { result = ec; });
+        {
+            std::lock_guard<TopoMutex> lk(f.mMtx);
+            op.SetFailFast(failFast);
+            op.ResetCount(f.mStateData);
+            // an ignorable (expendable or nMin-covered) failure never completes the op early
+            op.Update(0, f.mStateData.TaskId(0), DeviceState::Error, true);
+            BOOST_TEST(!op.IsCompleted());
+            op.Update(1, f.mStateData.TaskId(1), DeviceState::Error, false);
+            BOOST_TEST(op.IsCompleted() == failFast);
+            // a later ignorable failure must not hide the earlier one
+            op.Update(2, f.mStateData.TaskId(2), DeviceState::Exiting, true);
+            for (int i = 3; i < 10; ++i) {
+                op.Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+            }
+            BOOST_TEST(op.IsCompleted());
+        }
+        f.mIoContext.run();
+        BOOST_TEST(result == MakeErrorCode(ErrorCode::DeviceChangeStateFailed));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(quorum)
+{
+    OpsFixture f(10);
+    // every odd task is a collection of one task, three out of the five collections have to reach the target state
+    TopoQuorum quorum;
+    quorum.groups.push_back(TopoQuorum::Group{ 3, 0 });
+    for (int i = 1; i < 10; i += 2) {
+        quorum.collections.emplace(f.mStateData.CollectionId(i), TopoQuorum::Collection{ 0, 1, 0, false });
+    }
+    quorum.numOther = 5;
+
+    std::vector<DDSCollection::Id> stragglers;
+    std::error_code result;
+    ChangeStateOp<DefaultExecutor, DefaultAllocator> op(1,
+                                                        TopoTransition::InitDevice,
+                                                        f.MakeTaskSet(),
+                                                        f.mStateData,
+                                                        Duration(0),
+                                                        f.mMtx,
+                                                        f.mTimers,
+                                                        f.mIoContext.get_executor(),
+                                                        DefaultAllocator(),
+                                                        [&](std::error_code ec, TopoStateSnapshotPtr) { result = ec; });
+    {
+        std::lock_guard<TopoMutex> lk(f.mMtx);
+        op.SetQuorum(quorum, [&](const std::vector<DDSCollection::Id>& ids) { stragglers = ids; });
+        op.ResetCount(f.mStateData);
+        // collections reaching the target state do not complete the op while other tasks are pending
+        for (int i = 1; i <= 7; i += 2) {
+            op.Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+        }
+        // a collection that failed (and was ignored) does not count for the quorum
+        op.Update(9, f.mStateData.TaskId(9), DeviceState::Error, true);
+        for (int i = 0; i < 8; i += 2) {
+            op.Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+        }
+        BOOST_TEST(!op.IsCompleted());
+        op.Update(8, f.mStateData.TaskId(8), DeviceState::InitializingDevice, false);
+        BOOST_TEST(op.IsCompleted());
+        BOOST_TEST(stragglers.empty()); // all tasks have reported
+    }
+    f.mIoContext.run();
+    BOOST_TEST(!result);
+
+    OpsFixture g(10);
+    ChangeStateOp<DefaultExecutor, DefaultAllocator> op2(2,
+                                                         TopoTransition::InitDevice,
+                                                         g.MakeTaskSet(),
+                                                         g.mStateData,
+                                                         Duration(0),
+                                                         g.mMtx,
+                                                         g.mTimers,
+                                                         g.mIoContext.get_executor(),
+                                                         DefaultAllocator(),
+                                                         [&](std::error_code ec, TopoStateSnapshotPtr) { result = ec; });
+    {
+        std::lock_guard<TopoMutex> lk(g.mMtx);
+        op2.SetQuorum(quorum, [&](const std::vector<DDSCollection::Id>& ids) { stragglers = ids; });
+        op2.ResetCount(g.mStateData);
+        for (int i = 0; i < 10; i += 2) {
+            op2.Update(i, g.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+        }
+        op2.Update(1, g.mStateData.TaskId(1), DeviceState::InitializingDevice, false);
+        op2.Update(3, g.mStateData.TaskId(3), DeviceState::InitializingDevice, false);
+        BOOST_TEST(!op2.IsCompleted());
+        op2.Update(5, g.mStateData.TaskId(5), DeviceState::InitializingDevice, false);
+        BOOST_TEST(op2.IsCompleted());
+    }
+    g.mIoContext.run();
+    BOOST_TEST(!result);
+    std::sort(stragglers.begin(), stragglers.end());
+    BOOST_TEST(stragglers == std::vector<DDSCollection::Id>({ g.mStateData.CollectionId(7), g.mStateData.CollectionId(9) }));
+}
+
+BOOST_AUTO_TEST_CASE(completion_cost_scaling)
+{
+    const std::vector<size_t> sizes = { 1000, 10000, 100000 };
+    std::vector<double> nsPerTask;
+    std::vector<size_t> numAllocations;
+    for (const auto n : sizes) {
+        OpsFixture f(n);
+        // warm-up run, then the best of a few runs, to filter out the noise of a loaded machine
+        size_t warmUpAllocations = 0;
+        RunChangeState(f, warmUpAllocations);
+        std::chrono::nanoseconds best = std::chrono::nanoseconds::max();
+        numAllocations.push_back(0);
+        for (int run = 0; run < 3; ++run) {
+            for (size_t i = 0; i < f.mStateData.Size(); ++i) {
+                f.mStateData.SetState(i, DeviceState::Undefined, DeviceState::Idle);
+            }
+            best = std::min(best, RunChangeState(f, numAllocations.back()));
+        }
+        nsPerTask.push_back(static_cast<double>(best.count()) / n);
+        BOOST_TEST_MESSAGE("ChangeState completion for " << n << " tasks: " << best.count() / 1000 << " us (" << nsPerTask.back() << " ns/task), "
+                           << numAllocations.back() << " allocations");
+    }
+    // The cost per task must not grow with the number of tasks: a linear membership scan per update makes it grow
+    // ~100x from 1k to 100k tasks, the factor leaves room for cache effects and noise.
+    BOOST_TEST(nsPerTask.back() < 4 * nsPerTask.front());
+    // updates must not allocate, only the completion does, for any number of tasks
+    for (const auto n : numAllocations) {
+        BOOST_TEST(n == numAllocations.front());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(state_counters)
+
+BOOST_AUTO_TEST_CASE(aggregation_matches_full_scan)
+{
+    OpsFixture f(1000);
+    TopoState stateData = f.mStateData.ToTopoState();
+    TopoStateCounters counters;
+    for (const auto& ds : stateData) {
+        counters.Add(ds);
+    }
+    BOOST_TEST(counters.Aggregated() == AggregatedState::Idle);
+    BOOST_TEST(counters.Aggregated() == AggregateState(stateData));
+
+    const std::vector<DeviceState> states = { DeviceState::Idle, DeviceState::InitializingDevice, DeviceState::Ready, DeviceState::Error };
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> indexDist(0, stateData.size() - 1);
+    std::uniform_int_distribution<size_t> stateDist(0, states.size() - 1);
+    std::uniform_int_distribution<int> ignoreDist(0, 9);
+
+    for (int i = 0; i < 5000; ++i) {
+        auto& ds = stateData[indexDist(gen)];
+        counters.Remove(ds);
+        ds.state = states[stateDist(gen)];
+        if (ignoreDist(gen) == 0) {
+            ds.ignored = true;
+        }
+        counters.Add(ds);
+
+        const TopoStateCounts counts = counters.Counts();
+        BOOST_TEST(counts.numTasks == stateData.size());
+        BOOST_TEST(counts.aggregated == counters.Aggregated());
+        if (ds.collectionId != 0) {
+            std::vector<DeviceStatus> collection;
+            for (const auto& d : stateData) {
+                if (d.collectionId == ds.collectionId) {
+                    collection.push_back(d);
+                }
+            }
+            BOOST_TEST(counters.CollectionAggregated(ds.collectionId) == AggregateState(collection));
+        }
+    }
+
+    // bring all non-ignored devices to the same state
+    for (auto& ds : stateData) {
+        counters.Remove(ds);
+        ds.state = DeviceState::Ready;
+        counters.Add(ds);
+    }
+    BOOST_TEST(counters.Aggregated() == AggregatedState::Ready);
+    BOOST_TEST(counters.Aggregated() == AggregateState(stateData));
+
+    const TopoStateCounts counts = counters.Counts();
+    BOOST_TEST(counts.tasks[static_cast<size_t>(DeviceState::Ready)] == stateData.size());
+    BOOST_TEST(counts.numCollections == GroupByCollectionId(stateData).size());
+    uint32_t numCollections = 0;
+    for (const auto c : counts.collections) {
+        numCollections += c;
+    }
+    BOOST_TEST(numCollections == counts.numCollections);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(state_store)
+
+BOOST_AUTO_TEST_CASE(index_lookup)
+{
+    TopoStateStore store;
+    // no Reserve(): the index has to grow on its own
+    for (int i = 0; i < 10000; ++i) {
+        BOOST_TEST(store.Add(static_cast<DDSTask::Id>(i) << 32, 0, false) == i);
+    }
+    for (int i = 0; i < 10000; ++i) {
+        BOOST_TEST(store.Find(static_cast<DDSTask::Id>(i) << 32) == i);
+    }
+    BOOST_TEST(store.Find(12345) == -1);
+    BOOST_CHECK_THROW(store.At(12345), std::out_of_range);
+    BOOST_CHECK_THROW(store.Add(0, 0, false), std::runtime_error);
+    BOOST_TEST(store.Size() == 10000);
+}
+
+BOOST_AUTO_TEST_CASE(setters_update_counters)
+{
+    OpsFixture f(100);
+    TopoStateStore& store = f.mStateData;
+    store.SetState(3, DeviceState::Idle, DeviceState::Error);
+    BOOST_TEST(store.Counters().Aggregated() == AggregatedState::Error);
+    store.SetIgnored(3);
+    store.SetIgnored(3);
+    BOOST_TEST(store.Counters().Aggregated() == AggregatedState::Idle);
+    BOOST_TEST(store.NumIgnored() == 1);
+    BOOST_TEST(store.CountState(DeviceState::Idle) == 99);
+    BOOST_TEST(store.CountState(DeviceState::Error) == 1);
+
+    store.SetSubscribed(5, true);
+    store.SetExit(5, 1, 9);
+    const DeviceStatus ds = store.Get(5);
+    BOOST_TEST(ds.subscribedToStateChanges);
+    BOOST_TEST(ds.exitCode == 1);
+    BOOST_TEST(ds.signal == 9);
+    BOOST_TEST(ds.taskId == store.TaskId(5));
+    BOOST_TEST(store.NumSubscribed() == 1);
+
+    const TopoState state = store.ToTopoState();
+    BOOST_TEST(state.size() == 100);
+    BOOST_TEST(state[3].ignored);
+    BOOST_TEST(state[3].state == DeviceState::Error);
+    BOOST_TEST(store.Counters().Aggregated() == AggregateState(state));
+}
+
+BOOST_AUTO_TEST_CASE(snapshots)
+{
+    OpsFixture f(100);
+    TopoStateStore& store = f.mStateData;
+
+    const TopoStateSnapshotPtr s1 = store.Snapshot();
+    BOOST_TEST(s1->version == store.Version());
+    BOOST_TEST(s1->state.size() == 100);
+    // unchanged state: the same snapshot is shared
+    BOOST_TEST(store.Snapshot() == s1);
+
+    store.SetState(0, DeviceState::Idle, DeviceState::InitializingDevice);
+    const TopoStateSnapshotPtr s2 = store.Snapshot();
+    BOOST_TEST(s2 != s1);
+    BOOST_TEST(s2->version > s1->version);
+    // the old snapshot is immutable
+    BOOST_TEST(s1->state[0].state == DeviceState::Idle);
+    BOOST_TEST(s2->state[0].state == DeviceState::InitializingDevice);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_from_columns)
+{
+    OpsFixture f(100);
+    TopoStateStore& store = f.mStateData;
+    store.SetIgnored(3);
+    store.SetExit(3, 1, 9);
+    BOOST_TEST(store.CachedSnapshot() == nullptr);
+
+    const TopoStateSnapshotPtr s1 = store.CopyColumns().ToSnapshot();
+    const TopoState state = store.ToTopoState();
+    BOOST_TEST(s1->version == store.Version());
+    BOOST_REQUIRE(s1->state.size() == state.size());
+    for (size_t i = 0; i < state.size(); ++i) {
+        BOOST_TEST(s1->state[i].taskId == state[i].taskId);
+        BOOST_TEST(s1->state[i].state == state[i].state);
+        BOOST_TEST(s1->state[i].ignored == state[i].ignored);
+        BOOST_TEST(s1->state[i].exitCode == state[i].exitCode);
+    }
+    // a published snapshot is shared by the following readers
+    store.PublishSnapshot(s1);
+    BOOST_TEST(store.CachedSnapshot() == s1);
+    BOOST_TEST(store.Snapshot() == s1);
+
+    // a snapshot copied before a state change is not published
+    const TopoStateColumns columns = store.CopyColumns();
+    store.SetState(0, DeviceState::Idle, DeviceState::InitializingDevice);
+    store.PublishSnapshot(columns.ToSnapshot());
+    BOOST_TEST(store.CachedSnapshot() == nullptr);
+    BOOST_TEST(store.Snapshot()->state[0].state == DeviceState::InitializingDevice);
+}
+
+BOOST_AUTO_TEST_CASE(erase_keeps_remaining_states)
+{
+    OpsFixture f(100);
+    TopoStateStore& store = f.mStateData;
+    store.SetState(10, DeviceState::Idle, DeviceState::Ready);
+    store.SetIgnored(11);
+    const uint32_t numCollections = store.Counters().Counts().numCollections;
+
+    // tasks 1 and 3 are the only tasks of their collections
+    store.Erase({ 1, 2, 3 });
+    BOOST_TEST(store.Size() == 97);
+    BOOST_TEST(store.Find(f.mTasks[1].GetId()) == -1);
+    BOOST_TEST(store.Find(f.mTasks[2].GetId()) == -1);
+    BOOST_TEST(store.Find(f.mTasks[0].GetId()) == 0);
+    BOOST_TEST(store.Find(f.mTasks[10].GetId()) == 7);
+    BOOST_TEST(store.State(7) == DeviceState::Ready);
+    BOOST_TEST(store.Ignored(8));
+    BOOST_TEST(store.TaskId(8) == f.mTasks[11].GetId());
+    BOOST_TEST(store.Counters().Counts().numCollections == numCollections - 2);
+    BOOST_TEST(store.Counters().Counts().numTasks == 97);
+    BOOST_TEST(store.CountState(DeviceState::Idle) == 96);
+
+    // added devices are appended behind the remaining ones
+    BOOST_TEST(store.Add(f.mTasks[2].GetId(), 0, false) == 97);
+    BOOST_TEST(store.Counters().Aggregated() == AggregateState(store.ToTopoState()));
+}
+
+BOOST_AUTO_TEST_CASE(pending_subscriptions)
+{
+    TopoStateStore store;
+    for (int i = 0; i < 6; ++i) {
+        store.Add(static_cast<DDSTask::Id>(i + 1), 0, false);
+    }
+    BOOST_TEST(store.PendingSubscriptions() == std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+
+    // confirmed, reported a state, exited before subscribing and ignored devices are not pending
+    store.SetSubscribed(1, true);
+    store.SetState(2, DeviceState::Undefined, DeviceState::Idle);
+    store.SetExit(3, 1, 0);
+    store.SetState(3, DeviceState::Undefined, DeviceState::Error);
+    store.SetIgnored(4);
+    BOOST_TEST(store.PendingSubscriptions() == std::vector<int>({ 0, 5 }));
+
+    // an unsubscribed device that reported its state before is not subscribed again
+    store.SetSubscribed(1, false);
+    store.SetState(1, DeviceState::Undefined, DeviceState::Idle);
+    BOOST_TEST(store.PendingSubscriptions() == std::vector<int>({ 0, 5 }));
+}
+
+BOOST_AUTO_TEST_CASE(diff)
+{
+    OpsFixture f(10);
+    std::vector<DDSTask::Id> updated;
+    for (size_t i = 2; i < 10; ++i) {
+        updated.push_back(f.mTasks[i].GetId());
+    }
+    updated.push_back(42);
+    updated.push_back(43);
+
+    const TopoDiff diff = f.mStateData.Diff(updated);
+    BOOST_TEST(diff.removed == std::vector<DDSTask::Id>({ f.mTasks[0].GetId(), f.mTasks[1].GetId() }));
+    BOOST_TEST(diff.added == std::vector<DDSTask::Id>({ 42, 43 }));
+
+    // applying the diff (as BasicTopology::ApplyUpdate() does) leaves nothing to update
+    f.mStateData.Erase({ 0, 1 });
+    for (const auto taskId : diff.added) {
+        f.mStateData.Add(taskId, 0, false);
+    }
+    BOOST_TEST(f.mStateData.Diff(updated).Empty());
+    BOOST_TEST(f.mStateData.Size() == updated.size());
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_shared_by_completions)
+{
+    OpsFixture f(10);
+    std::vector<TopoStateSnapshotPtr> results;
+    auto makeOp = [&](uint64_t id) {
+        return std::make_unique<ChangeStateOp<DefaultExecutor, DefaultAllocator>>(id,
+                                                                                  TopoTransition::InitDevice,
+                                                                                  f.MakeTaskSet(),
+                                                                                  f.mStateData,
+                                                                                  Duration(0),
+                                                                                  f.mMtx,
+                                                                                  f.mTimers,
+                                                                                  f.mIoContext.get_executor(),
+                                                                                  DefaultAllocator(),
+                                                                                  [&](std::error_code, TopoStateSnapshotPtr state) { results.push_back(state); });
+    };
+    auto op1 = makeOp(1);
+    auto op2 = makeOp(2);
+    {
+        std::lock_guard<TopoMutex> lk(f.mMtx);
+        op1->ResetCount(f.mStateData);
+        op2->ResetCount(f.mStateData);
+        for (int i = 0; i < 10; ++i) {
+            f.mStateData.SetState(i, DeviceState::Idle, DeviceState::InitializingDevice);
+            op1->Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+            op2->Update(i, f.mStateData.TaskId(i), DeviceState::InitializingDevice, false);
+        }
+    }
+    f.mIoContext.run();
+    BOOST_REQUIRE(results.size() == 2);
+    BOOST_TEST(results[0] == results[1]);
+    BOOST_TEST(AggregateState(results[0]->state) == AggregatedState::InitializingDevice);
+}
+
+BOOST_AUTO_TEST_CASE(memory_per_device)
+{
+    const size_t n = 100000;
+    OpsFixture f(n);
+    const double perDevice = static_cast<double>(f.mStateData.MemoryUsage()) / n;
+    BOOST_TEST_MESSAGE("TopoStateStore: " << perDevice << " bytes/device for " << n << " devices, DeviceStatus alone: " << sizeof(DeviceStatus) << " bytes");
+    BOOST_TEST(perDevice < sizeof(DeviceStatus));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(mpsc_queue)
+
+BOOST_AUTO_TEST_CASE(fifo)
+{
+    MPSCQueue<std::unique_ptr<int>> queue;
+    std::unique_ptr<int> item;
+    BOOST_TEST(!queue.TryPop(item));
+    for (int i = 0; i < 100; ++i) {
+        queue.Push(std::make_unique<int>(i));
+    }
+    BOOST_TEST(queue.Size() == 100);
+    for (int i = 0; i < 100; ++i) {
+        BOOST_REQUIRE(queue.TryPop(item));
+        BOOST_TEST(*item == i);
+    }
+    BOOST_TEST(!queue.TryPop(item));
+    BOOST_TEST(queue.Size() == 0);
+    // leftovers are released by the destructor
+    queue.Push(std::make_unique<int>(42));
+}
+
+BOOST_AUTO_TEST_CASE(multiple_producers)
+{
+    const int numProducers = 4;
+    const int perProducer = 100000;
+    MPSCQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < numProducers; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < perProducer; ++i) {
+                queue.Push({ p, i });
+            }
+        });
+    }
+
+    // single consumer: every producer's elements must come out complete and in order
+    std::vector<int> next(numProducers, 0);
+    int popped = 0;
+    std::pair<int, int> item;
+    while (popped < numProducers * perProducer) {
+        if (queue.TryPop(item)) {
+            BOOST_REQUIRE(item.second == next[item.first]);
+            ++next[item.first];
+            ++popped;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : producers) {
+        t.join();
+    }
+    BOOST_TEST(queue.Size() == 0);
+    BOOST_TEST(!queue.TryPop(item));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(path_index)
+
+BOOST_AUTO_TEST_CASE(selection_pattern)
+{
+    // main/Group_<g>/Collection_<c>/Task_<t>, plus tasks directly in main
+    std::vector<TopoSelectedTask> tasks;
+    std::unordered_map<uint64_t, size_t> collectionSizes;
+    for (int g = 0; g < 3; ++g) {
+        for (int c = 0; c < 2; ++c) {
+            const std::string collectionPath = "main/Group_" + std::to_string(g) + "/Collection_" + std::to_string(c);
+            const uint64_t collectionId = 1 + g * 2 + c;
+            for (int t = 0; t < 4; ++t) {
+                tasks.push_back(TopoSelectedTask{ collectionPath + "/Task_" + std::to_string(t), collectionId, collectionPath });
+                ++collectionSizes[collectionId];
+            }
+        }
+    }
+    tasks.push_back(TopoSelectedTask{ "main/Sampler.0", 0, "" });
+    tasks.push_back(TopoSelectedTask{ "main/SamplerX0", 0, "" });
+
+    TopoPathIndex index;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        index.Add(tasks[i].path, static_cast<int>(i));
+    }
+    index.Build();
+
+    auto pattern = [&](const std::vector<int>& selected) {
+        std::vector<TopoSelectedTask> selectedTasks;
+        for (const int i : selected) {
+            selectedTasks.push_back(tasks[i]);
+        }
+        return TopoSelectionPattern(selectedTasks, collectionSizes);
+    };
+    auto select = [&](const std::string& p) {
+        TopoPathSelection selection = index.Select(p);
+        std::sort(selection.begin(), selection.end());
+        return selection;
+    };
+
+    // a completely selected collection collapses into its path
+    const std::vector<int> collection = { 8, 9, 10, 11 };
+    BOOST_TEST(pattern(collection) == "main/Group_1/Collection_0/.*");
+    BOOST_TEST(select(pattern(collection)) == collection);
+
+    // tasks of partially selected collections are matched by their escaped paths
+    const std::vector<int> mixed = { 0, 1, 8, 9, 10, 11, 24 };
+    BOOST_TEST(pattern(mixed) == "main/Sampler\\.0|main/Group_0/Collection_0/Task_0|main/Group_0/Collection_0/Task_1|main/Group_1/Collection_0/.*");
+    BOOST_TEST(select(pattern(mixed)) == mixed);
+
+    // a collection missing from the sizes is never collapsed
+    collectionSizes.erase(3);
+    BOOST_TEST(pattern(collection) == "main/Group_1/Collection_0/Task_0|main/Group_1/Collection_0/Task_1|main/Group_1/Collection_0/Task_2|main/Group_1/Collection_0/Task_3");
+}
+
+BOOST_AUTO_TEST_CASE(matches_regex_scan)
+{
+    // main/Group_<g>/Collection_<c>/Task_<t>, plus tasks directly in main
+    std::vector<std::string> paths;
+    for (int g = 0; g < 12; ++g) {
+        for (int c = 0; c < 3; ++c) {
+            for (int t = 0; t < 4; ++t) {
+                paths.push_back("main/Group_" + std::to_string(g) + "/Collection_" + std::to_string(c) + "/Task_" + std::to_string(t));
+            }
+        }
+    }
+    paths.push_back("main/Sampler_0");
+    paths.push_back("main/Sink_0");
+
+    TopoPathIndex index;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        index.Add(paths[i], static_cast<int>(i));
+    }
+    index.Build();
+    BOOST_CHECK_EQUAL(index.Size(), paths.size());
+
+    for (const std::string& pattern : { "main/Group_1/Collection_2/Task_3", // literal task path
+                                        "main/Group_1/Collection_2",        // literal, not a task
+                                        "main/Group_1/.*",                  // subtree
+                                        "main/Group_1.*",                   // prefix of sibling names (Group_1, Group_10, Group_11)
+                                        "main/S.*",
+                                        "main/.*",
+                                        ".*",
+                                        "main/Nope/.*",
+                                        "main/Group_[23]/Collection_0/.*",  // general regex
+                                        ".*/Task_0" }) {
+        TopoPathSelection expected;
+        const std::regex re(pattern);
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (std::regex_match(paths[i], re)) {
+                expected.push_back(static_cast<int>(i));
+            }
+        }
+        TopoPathSelection selected = index.Select(pattern);
+        std::sort(selected.begin(), selected.end());
+        BOOST_TEST_INFO("pattern: " << pattern);
+        BOOST_CHECK_EQUAL_COLLECTIONS(selected.begin(), selected.end(), expected.begin(), expected.end());
+    }
+
+    TopoPathSelection all = index.Select("");
+    BOOST_CHECK_EQUAL(all.size(), paths.size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(timer_wheel)
+
+BOOST_AUTO_TEST_CASE(expiry_order)
+{
+    using namespace std::chrono;
+    boost::asio::io_context ioContext;
+    TopoMutex mtx;
+    // 64 ticks per level: 3.2 ms on level 0, 204.8 ms on level 1, beyond that level 2
+    TopoTimerWheel wheel(ioContext.get_executor(), mtx, microseconds(50));
+
+    const auto start = steady_clock::now();
+    std::vector<std::pair<int, steady_clock::duration>> fired;
+    const std::vector<milliseconds> timeouts = { milliseconds(250), milliseconds(1), milliseconds(20), milliseconds(3), milliseconds(10) };
+    std::vector<TopoTimerWheel::Id> ids;
+    {
+        std::lock_guard<TopoMutex> lk(mtx);
+        for (size_t i = 0; i < timeouts.size(); ++i) {
+            ids.push_back(wheel.Add(timeouts[i], [&, i]() { fired.emplace_back(i, steady_clock::now() - start); }));
+        }
+        wheel.Cancel(ids[4]);
+        wheel.Cancel(ids[4]); // no-op
+        BOOST_TEST(wheel.Size() == 4);
+    }
+    ioContext.run();
+
+    BOOST_TEST(wheel.Size() == 0);
+    BOOST_REQUIRE(fired.size() == 4);
+    const std::vector<int> order = { 1, 3, 2, 0 };
+    for (size_t i = 0; i < fired.size(); ++i) {
+        BOOST_TEST(fired[i].first == order[i]);
+        BOOST_TEST(duration_cast<microseconds>(fired[i].second).count() >= duration_cast<microseconds>(timeouts[fired[i].first]).count()); // never early
+    }
+}
+
+BOOST_AUTO_TEST_CASE(churn_vs_steady_timer)
+{
+    using namespace std::chrono;
+    // one second of a client polling properties at 10k ops/s: every op arms a timeout and cancels it on completion
+    const size_t numOps = 10000;
+    const auto timeout = seconds(30);
+
+    boost::asio::io_context ioContext;
+    const auto timerStart = steady_clock::now();
+    {
+        std::vector<std::unique_ptr<boost::asio::steady_timer>> timers;
+        timers.reserve(numOps);
+        for (size_t i = 0; i < numOps; ++i) {
+            timers.push_back(std::make_unique<boost::asio::steady_timer>(ioContext.get_executor()));
+            timers.back()->expires_after(timeout);
+            timers.back()->async_wait([](std::error_code) {});
+            timers.back()->cancel();
+        }
+        ioContext.run(); // the cancelled handlers
+    }
+    const auto timerTime = duration_cast<microseconds>(steady_clock::now() - timerStart);
+
+    ioContext.restart();
+    TopoMutex mtx;
+    TopoTimerWheel wheel(ioContext.get_executor(), mtx);
+    size_t numFired = 0;
+    const auto wheelStart = steady_clock::now();
+    {
+        std::lock_guard<TopoMutex> lk(mtx);
+        for (size_t i = 0; i < numOps; ++i) {
+            const TopoTimerWheel::Id id = wheel.Add(timeout, [&]() { ++numFired; });
+            wheel.Cancel(id);
+        }
+    }
+    // nothing to run: cancelling leaves the single wheel timer armed, no handler per op
+    const auto wheelTime = duration_cast<microseconds>(steady_clock::now() - wheelStart);
+
+    BOOST_TEST(numFired == 0);
+    BOOST_TEST(wheel.Size() == 0);
+    // timings are only reported, wall-clock comparisons are not reliable on loaded machines
+    BOOST_TEST_MESSAGE("Timeout churn for " << numOps << " ops: steady_timer per op: " << timerTime.count() << " us, shared timer wheel: " << wheelTime.count() << " us");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(allocator)
+
+/// Runs 2 * numCalls GetProperties operations on all tasks, the way BasicTopology does, and returns the global heap
+/// allocations per operation of the second half
+template<typename Allocator>
+double GetPropertiesAllocations(OpsFixture& f, const TopoTaskSetPtr& tasks, const Allocator& alloc, size_t numCalls)
+{
+    using Op = GetPropertiesOp<DefaultExecutor, Allocator>;
+    std::unordered_map<uint64_t, Op, std::hash<uint64_t>, std::equal_to<uint64_t>, TopoRebindAlloc<Allocator, std::pair<const uint64_t, Op>>> ops(alloc);
+    const DefaultExecutor ex(boost::asio::system_executor{});
+    size_t numCompleted = 0;
+    size_t start = 0;
+    for (uint64_t id = 0; id < 2 * numCalls; ++id) {
+        if (id == numCalls) {
+            start = gNumAllocations;
+        }
+        std::lock_guard<TopoMutex> lk(f.mMtx);
+        auto [it, inserted] = ops.try_emplace(id, id, tasks, Duration(0), f.mMtx, f.mTimers, ex, alloc, [&](std::error_code ec, GetPropertiesResult result) {
+            if (!ec && result.devices.size() == tasks->Size() && result.failed.empty()) {
+                ++numCompleted;
+            }
+        });
+        for (const auto& task : tasks->Tasks()) {
+            it->second.Update(task.GetId(), odc::cc::Result::Ok, DeviceProperties());
+        }
+        ops.erase(it);
+    }
+    const size_t end = gNumAllocations;
+    BOOST_TEST(numCompleted == 2 * numCalls);
+    return static_cast<double>(end - start) / numCalls;
+}
+
+BOOST_AUTO_TEST_CASE(get_properties_steady_state)
+{
+    const size_t n = 100;
+    const size_t numCalls = 1000;
+    OpsFixture f(n);
+    const TopoTaskSetPtr tasks = f.MakeTaskSet();
+
+    const double heapDefault = GetPropertiesAllocations(f, tasks, DefaultAllocator(), numCalls);
+
+    CountingResource upstream(std::pmr::new_delete_resource());
+    std::pmr::unsynchronized_pool_resource pool(&upstream);
+    GetPropertiesAllocations(f, tasks, TopoPoolAllocator(&pool), numCalls);
+    const size_t poolWarm = upstream.mNumAllocations;
+    const double heapPooled = GetPropertiesAllocations(f, tasks, TopoPoolAllocator(&pool), numCalls);
+
+    BOOST_TEST_MESSAGE("Heap allocations per GetProperties on " << n << " devices: " << heapDefault << " with DefaultAllocator, " << heapPooled
+                       << " with TopoPoolAllocator (the result handed to the caller)");
+    // the op storage, handler and device sets come from the warm pool
+    BOOST_TEST(upstream.mNumAllocations == poolWarm);
+    BOOST_TEST(heapPooled < heapDefault);
+    // what remains is the result: one node per device plus the bucket array, and asio wrapping the handler for dispatch
+    BOOST_TEST(heapPooled <= n + 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(request_id)
+
+BOOST_AUTO_TEST_CASE(unique_across_threads_and_generators)
+{
+    RequestIdGenerator generator;
+    const size_t numThreads = 4;
+    const size_t numIds = 100000;
+    std::vector<std::vector<uint64_t>> ids(numThreads);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&, t]() {
+            ids[t].reserve(numIds);
+            for (size_t i = 0; i < numIds; ++i) {
+                ids[t].push_back(generator.Next());
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    std::vector<uint64_t> all;
+    for (const auto& v : ids) {
+        BOOST_TEST(std::is_sorted(v.begin(), v.end())); // monotonic per thread
+        all.insert(all.end(), v.begin(), v.end());
+    }
+    std::sort(all.begin(), all.end());
+    BOOST_TEST((std::adjacent_find(all.begin(), all.end()) == all.end()));
+    BOOST_TEST(all.front() != 0);
+    for (const uint64_t id : all) {
+        BOOST_REQUIRE(id >> 40 == generator.GetEpoch());
+    }
+
+    // a restarted controller gets a new epoch (a collision has a chance of 2^-24)
+    RequestIdGenerator restarted;
+    BOOST_TEST(restarted.GetEpoch() != generator.GetEpoch());
+    BOOST_TEST(restarted.Next() != generator.Next());
+}
+
+BOOST_AUTO_TEST_CASE(cost_vs_uuid_hash)
+{
+    using namespace std::chrono;
+    const size_t n = 100000;
+    uint64_t sum = 0;
+    auto start = steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += uuidHash();
+    }
+    const auto uuidTime = duration_cast<nanoseconds>(steady_clock::now() - start);
+
+    RequestIdGenerator generator;
+    start = steady_clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        sum += generator.Next();
+    }
+    const auto generatorTime = duration_cast<nanoseconds>(steady_clock::now() - start);
+
+    // timings are only reported, wall-clock comparisons are not reliable on loaded machines
+    BOOST_TEST_MESSAGE("Request id generation: uuidHash() " << uuidTime.count() / n << " ns/id, RequestIdGenerator " << generatorTime.count() / n << " ns/id (" << sum % 2 << ")");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(state_watch)
+
+BOOST_AUTO_TEST_CASE(coalesces_while_busy)
+{
+    OpsFixture f(10);
+    std::vector<TopoStateDeltas> batches;
+    std::vector<std::error_code> results;
+    auto watch = std::make_shared<TopoStateWatch>(
+        f.MakeTaskSet(),
+        f.mStateData.Size(),
+        [&](std::error_code ec, TopoStateDeltas deltas) {
+            results.push_back(ec);
+            batches.push_back(std::move(deltas));
+        },
+        [&](std::function<void()> fn) { boost::asio::post(f.mIoContext, std::move(fn)); });
+
+    auto change = [&](int index, DeviceState state) {
+        f.mStateData.SetState(index, f.mStateData.State(index), state);
+        watch->Push(index, { f.mStateData.TaskId(index), f.mStateData.LastState(index), state, f.mStateData.Version() });
+    };
+
+    change(0, DeviceState::InitializingDevice);
+    watch->Flush();
+    // the first batch is not consumed yet: these are coalesced to one delta per device
+    change(0, DeviceState::Initialized);
+    change(1, DeviceState::InitializingDevice);
+    change(0, DeviceState::Binding);
+    watch->Flush();
+    BOOST_TEST(watch->NumPending() == 2);
+
+    f.mIoContext.run();
+    f.mIoContext.restart();
+    BOOST_REQUIRE(batches.size() == 2);
+    BOOST_TEST(batches[0].size() == 1);
+    BOOST_TEST(batches[1].size() == 2);
+    BOOST_TEST(batches[1][0].taskId == f.mStateData.TaskId(0));
+    BOOST_TEST(batches[1][0].lastState == DeviceState::Initialized);
+    BOOST_TEST(batches[1][0].state == DeviceState::Binding);
+    BOOST_TEST(batches[1][0].version == f.mStateData.Version());
+    BOOST_TEST(batches[1][1].taskId == f.mStateData.TaskId(1));
+    BOOST_TEST(batches[1][0].version > batches[1][1].version);
+    BOOST_TEST(watch->NumPending() == 0);
+
+    watch->Cancel();
+    change(2, DeviceState::InitializingDevice); // dropped
+    watch->Flush();
+    f.mIoContext.run();
+    BOOST_REQUIRE(results.size() == 3);
+    BOOST_TEST(!results[0]);
+    BOOST_TEST(!results[1]);
+    BOOST_TEST(results[2] == MakeErrorCode(ErrorCode::OperationCanceled));
+    BOOST_TEST(batches[2].empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+int main(int argc, char* argv[]) { return boost::unit_test::unit_test_main(init_unit_test, argc, argv); }
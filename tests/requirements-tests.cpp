@@ -15,8 +15,14 @@
 #include <odc/Controller.h>
 #include <odc/MiscUtils.h>
 #include <odc/Session.h>
+#include <odc/TopologyCache.h>
+#include <odc/TopologyScriptCache.h>
+
+#include <boost/filesystem.hpp>
 
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
@@ -302,4 +308,109 @@ BOOST_AUTO_TEST_CASE(epn_2)
 
 BOOST_AUTO_TEST_SUITE_END()
 
+BOOST_AUTO_TEST_SUITE(topology_cache)
+
+BOOST_AUTO_TEST_CASE(keyed_by_content)
+{
+    auto copyTopo = [](const string& suffix, const string& extra) {
+        const string path = toString(boost::filesystem::temp_directory_path().string(), "/odc_topo_cache_", uuid(), suffix, ".xml");
+        std::ifstream src(kODCDataDir + "/ex-topo-infinite.xml", std::ios::binary);
+        std::ofstream dst(path, std::ios::binary);
+        dst << src.rdbuf() << extra;
+        return path;
+    };
+    const string topoA = copyTopo("_a", "");
+    const string topoB = copyTopo("_b", "");             // same content, different file
+    const string topoC = copyTopo("_c", "<!-- c -->\n"); // different content
+
+    size_t numParsed = 0;
+    TopologyCache::Parser parse = [&](const string& path, ParsedTopology& p) {
+        ++numParsed;
+        p.mDDSTopo = std::make_shared<dds::topology_api::CTopology>(path);
+    };
+
+    TopologyCache cache(2);
+    bool hit = true;
+    auto a = cache.get(topoA, parse, hit);
+    BOOST_TEST(!hit);
+    BOOST_TEST(numParsed == 1);
+    BOOST_TEST((cache.get(topoA, parse, hit) == a));
+    BOOST_TEST(hit);
+    BOOST_TEST((cache.get(topoB, parse, hit) == a));
+    BOOST_TEST(hit);
+    BOOST_TEST(numParsed == 1);
+
+    auto c = cache.get(topoC, parse, hit);
+    BOOST_TEST(!hit);
+    BOOST_TEST((c != a));
+    BOOST_TEST(numParsed == 2);
+    BOOST_TEST(cache.size() == 2);
+
+    // the least recently used entry (a) is dropped beyond the capacity
+    std::ofstream(topoB, std::ios::app) << "<!-- b -->\n";
+    cache.get(topoB, parse, hit);
+    BOOST_TEST(!hit);
+    BOOST_TEST(cache.size() == 2);
+    cache.get(topoC, parse, hit);
+    BOOST_TEST(hit);
+    cache.get(topoA, parse, hit);
+    BOOST_TEST(!hit);
+    BOOST_TEST(numParsed == 4);
+
+    for (const auto& path : { topoA, topoB, topoC }) {
+        boost::filesystem::remove(path);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(script_output_lru)
+{
+    const auto dir = boost::filesystem::temp_directory_path() / ("odc_topo_script_cache_" + uuid());
+    const auto input = dir.string() + "_input.txt";
+    std::ofstream(input) << "v1";
+
+    TopologyScriptCache cache(dir.string(), 2, { "ODC_TOPO_SCRIPT_CACHE_TEST" }, { input });
+    size_t numRuns = 0;
+    auto run = [&](const string& out) {
+        return [&numRuns, out]() {
+            ++numRuns;
+            return out;
+        };
+    };
+
+    bool hit = true;
+    BOOST_TEST(cache.get("script a", run("a"), hit) == "a");
+    BOOST_TEST(!hit);
+    BOOST_TEST(cache.get("script a", run("x"), hit) == "a");
+    BOOST_TEST(hit);
+    BOOST_TEST(numRuns == 1);
+
+    // the relevant environment and the inputs are part of the key
+    setenv("ODC_TOPO_SCRIPT_CACHE_TEST", "1", 1);
+    BOOST_TEST(cache.get("script a", run("a1"), hit) == "a1");
+    BOOST_TEST(!hit);
+    std::ofstream(input) << "v2 (different size)";
+    BOOST_TEST(cache.get("script a", run("a2"), hit) == "a2");
+    BOOST_TEST(!hit);
+    BOOST_TEST(numRuns == 3);
+
+    // failures are not cached
+    BOOST_CHECK_THROW(cache.get("script b", []() -> string { throw std::runtime_error("failed"); }, hit), std::runtime_error);
+    BOOST_TEST(cache.get("script b", run("b"), hit) == "b");
+    BOOST_TEST(!hit);
+
+    // bounded to 2 entries, the least recently used ones are evicted
+    const auto stats = cache.getStats();
+    BOOST_TEST(stats.hits == 1);
+    BOOST_TEST(stats.misses == 5);
+    BOOST_TEST(stats.evictions == 2);
+    BOOST_TEST(cache.get("script a", run("a2"), hit) == "a2");
+    BOOST_TEST(hit);
+
+    unsetenv("ODC_TOPO_SCRIPT_CACHE_TEST");
+    boost::filesystem::remove_all(dir);
+    boost::filesystem::remove(input);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
 int main(int argc, char* argv[]) { return boost::unit_test::unit_test_main(init_unit_test, argc, argv); }